@@ -5,11 +5,33 @@
 				"auto.gypi"
 			],
 			"sources": [
+				"lib/ContentModel.cc",
+				"lib/EntityTable.cc",
+				"lib/Inflater.cc",
+				"lib/Interner.cc",
+				"lib/JsonWriter.cc",
 				"lib/Patricia.cc",
 				"lib/PatriciaCursor.cc",
 				"lib/Namespace.cc",
 				"lib/ParserConfig.cc",
-				"lib/Parser.cc"
+				"lib/Parser.cc",
+				"lib/ParserPool.cc",
+				"lib/RecordExtractor.cc",
+				"lib/OutputBuffer.cc",
+				"lib/TokenDecoder.cc",
+				"lib/XmlWriter.cc"
+			],
+			"conditions": [
+				["asmjs==1", {
+					"cflags": [ "-O3", "-msimd128", "-s USE_ZLIB=1" ],
+					"ldflags": [
+						"-O3",
+						"-msimd128",
+						"-s WASM=1",
+						"-s USE_ZLIB=1",
+						"-s ALLOW_MEMORY_GROWTH=1"
+					]
+				}]
 			]
 		}
 	],
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "Interner.h"
+
+/** Attributes seen in the current start tag, for rejecting duplicates.
+  * Entries are stamped with a generation number incremented for every tag,
+  * so clearing never touches the tables and memory is only allocated when
+  * more names appear than ever before. */
+
+class AttributeSet {
+
+public:
+
+	/** Forget all attributes before a new start tag. */
+	void clear() {
+		if(!++generation) reset();
+		nameLen = 0;
+		nameCount = 0;
+	}
+
+	/** Add an attribute found in a trie. Unprefixed attributes are distinct
+	  * from prefixed ones with the same token, like in XML namespaces.
+	  * @return False if it was already added. */
+	bool insert(uint32_t idToken, bool isPrefixInherited) {
+		const uint32_t key = (idToken << 1) | isPrefixInherited;
+
+		if(key >= stampList.size()) stampList.resize(key + 1, 0);
+		if(stampList[key] == generation) return(false);
+
+		stampList[key] = generation;
+		return(true);
+	}
+
+	/** Add a namespace declaration by the ID of the prefix it binds,
+	  * with the empty prefix for a default namespace.
+	  * @return False if it was already added. */
+	bool insertPrefix(uint32_t idPrefix) {
+		if(idPrefix >= prefixStampList.size()) prefixStampList.resize(idPrefix + 1, 0);
+		if(prefixStampList[idPrefix] == generation) return(false);
+
+		prefixStampList[idPrefix] = generation;
+		return(true);
+	}
+
+	/** Add an unknown attribute by its namespace and local name, or by its
+	  * qualified name if idNamespace is 0 because the prefix is unbound.
+	  * @return False if it was already added. */
+	bool insert(uint32_t idNamespace, const unsigned char *data, size_t len);
+
+private:
+
+	struct Slot {
+		uint32_t generation;
+		uint32_t hash;
+		uint32_t idNamespace;
+		/** Offset of the name in nameBuffer. */
+		uint32_t offset;
+		uint32_t len;
+	};
+
+	/** Start generations again after the counter wraps around. */
+	void reset() {
+		std::fill(stampList.begin(), stampList.end(), 0);
+		std::fill(prefixStampList.begin(), prefixStampList.end(), 0);
+		for(Slot &slot : slotList) slot.generation = 0;
+		generation = 1;
+	}
+
+	/** Place a slot from the current generation into a table
+	  * without comparing names. */
+	void place(std::vector<Slot> &list, const Slot &slot) {
+		const size_t mask = list.size() - 1;
+		size_t num = slot.hash & mask;
+
+		while(list[num].generation == generation) num = (num + 1) & mask;
+		list[num] = slot;
+	}
+
+	/** Double number of slots, keeping names of the current tag. */
+	void grow();
+
+	/** Generation of the latest tag with each known attribute key. */
+	std::vector<uint32_t> stampList;
+	/** Generation of the latest tag declaring each namespace prefix. */
+	std::vector<uint32_t> prefixStampList;
+
+	/** Open addressing table of unknown names with linear probing.
+	  * Size is a power of 2. */
+	std::vector<Slot> slotList;
+	/** Contents of unknown names in the current tag. */
+	std::vector<unsigned char> nameBuffer;
+	size_t nameLen = 0;
+	uint32_t nameCount = 0;
+
+	uint32_t generation = 1;
+
+};
+
+inline void AttributeSet :: grow() {
+	std::vector<Slot> list(slotList.size() ? slotList.size() * 2 : 16, Slot { 0, 0, 0, 0, 0 });
+
+	for(const Slot &slot : slotList) {
+		if(slot.generation == generation) place(list, slot);
+	}
+
+	slotList.swap(list);
+}
+
+inline bool AttributeSet :: insert(uint32_t idNamespace, const unsigned char *data, size_t len) {
+	if((nameCount + 1) * 2 > slotList.size()) grow();
+
+	const uint32_t hash = Interner :: hash(idNamespace, data, len);
+	const size_t mask = slotList.size() - 1;
+	size_t num = hash & mask;
+
+	while(1) {
+		const Slot &slot = slotList[num];
+
+		if(slot.generation != generation) break;
+
+		if(
+			slot.hash == hash &&
+			slot.idNamespace == idNamespace &&
+			slot.len == len &&
+			!std::memcmp(nameBuffer.data() + slot.offset, data, len)
+		) {
+			return(false);
+		}
+
+		num = (num + 1) & mask;
+	}
+
+	if(nameLen + len > nameBuffer.size()) nameBuffer.resize((nameLen + len) * 2);
+	std::memcpy(nameBuffer.data() + nameLen, data, len);
+
+	slotList[num] = Slot { generation, hash, idNamespace, static_cast<uint32_t>(nameLen), static_cast<uint32_t>(len) };
+	nameLen += len;
+	++nameCount;
+
+	return(true);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#elif defined(__wasm_simd128__)
+#	include <wasm_simd128.h>
+#endif
+
+/** Small set of bytes needing special handling when serializing text,
+  * with a fast scan for runs of other bytes that can be copied as is. */
+
+class ByteSet {
+
+public:
+
+	static constexpr unsigned int maxCount = 8;
+
+	/** @param chars Up to maxCount bytes in the set.
+	  * @param controls Also include all bytes below 0x20.
+	  * @param high Also include all bytes above this. */
+	ByteSet(const char *chars, bool controls = false, unsigned char high = 0xff) :
+		controls(controls), high(high)
+	{
+		std::memset(tbl, 0, sizeof(tbl));
+
+		if(controls) std::memset(tbl, 1, 0x20);
+		if(high < 0xff) std::memset(tbl + high + 1, 1, 0xff - high);
+
+		while(*chars && count < maxCount) {
+			unsigned char c = static_cast<unsigned char>(*chars++);
+			tbl[c] = 1;
+			charList[count++] = c;
+		}
+
+#		if defined(__SSE2__)
+			for(unsigned int num = 0; num < count; ++num) {
+				splatList[num] = _mm_set1_epi8(static_cast<char>(charList[num]));
+			}
+#		elif defined(__wasm_simd128__)
+			for(unsigned int num = 0; num < count; ++num) {
+				splatList[num] = wasm_i8x16_splat(static_cast<char>(charList[num]));
+			}
+#		endif
+	}
+
+	inline bool has(unsigned char c) const { return(tbl[c] != 0); }
+
+	/** Count initial bytes not in the set. */
+	inline size_t skip(const unsigned char *p, size_t len) const {
+		size_t pos = 0;
+
+#		if defined(__SSE2__)
+			const __m128i controlMax = _mm_set1_epi8(0x1f);
+			const __m128i highMin = _mm_set1_epi8(static_cast<char>(high + 1));
+
+			while(pos + 16 <= len) {
+				__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + pos));
+				__m128i hit = _mm_setzero_si128();
+
+				if(controls) {
+					// Unsigned chunk <= 0x1f.
+					hit = _mm_cmpeq_epi8(_mm_min_epu8(chunk, controlMax), chunk);
+				}
+
+				if(high < 0xff) {
+					// Unsigned chunk > high.
+					hit = _mm_or_si128(hit, _mm_cmpeq_epi8(_mm_max_epu8(chunk, highMin), chunk));
+				}
+
+				for(unsigned int num = 0; num < count; ++num) {
+					hit = _mm_or_si128(hit, _mm_cmpeq_epi8(chunk, splatList[num]));
+				}
+
+				int mask = _mm_movemask_epi8(hit);
+				if(mask) return(pos + __builtin_ctz(mask));
+
+				pos += 16;
+			}
+#		elif defined(__wasm_simd128__)
+			const v128_t controlMax = wasm_i8x16_splat(0x1f);
+			const v128_t highMax = wasm_i8x16_splat(static_cast<char>(high));
+
+			while(pos + 16 <= len) {
+				v128_t chunk = wasm_v128_load(p + pos);
+				v128_t hit = wasm_i8x16_splat(0);
+
+				if(controls) hit = wasm_u8x16_le(chunk, controlMax);
+				if(high < 0xff) hit = wasm_v128_or(hit, wasm_u8x16_gt(chunk, highMax));
+
+				for(unsigned int num = 0; num < count; ++num) {
+					hit = wasm_v128_or(hit, wasm_i8x16_eq(chunk, splatList[num]));
+				}
+
+				uint32_t mask = wasm_i8x16_bitmask(hit);
+				if(mask) return(pos + __builtin_ctz(mask));
+
+				pos += 16;
+			}
+#		endif
+
+		while(pos < len && !tbl[p[pos]]) ++pos;
+
+		return(pos);
+	}
+
+private:
+
+	unsigned char tbl[256];
+	unsigned char charList[maxCount];
+	unsigned int count = 0;
+	bool controls;
+	unsigned char high;
+
+#	if defined(__SSE2__)
+		__m128i splatList[maxCount];
+#	elif defined(__wasm_simd128__)
+		v128_t splatList[maxCount];
+#	endif
+
+};
@@ -0,0 +1,56 @@
+#include "ContentModel.h"
+
+bool ContentModel :: setData(const uint32_t *data, size_t len) {
+	const uint32_t *end = data + len;
+	std::vector<State> stateList;
+	std::vector<Transition> transitionList;
+
+	this->stateList.clear();
+	this->transitionList.clear();
+	this->root = unvalidated;
+
+	if(len < 2) return(false);
+
+	const uint32_t stateCount = *data++;
+	const uint32_t root = *data++;
+
+	if(root >= stateCount) return(false);
+
+	for(uint32_t num = 0; num < stateCount; ++num) {
+		if(end - data < 2) return(false);
+
+		State state;
+		state.isAccepting = *data++ != 0;
+		state.count = *data++;
+		state.first = transitionList.size();
+
+		if(static_cast<size_t>(end - data) / 3 < state.count) return(false);
+
+		for(uint32_t count = state.count; count; --count) {
+			Transition transition;
+			transition.idElement = *data++;
+			transition.next = *data++;
+			transition.child = *data++;
+
+			// Check target states and ordering for the binary search.
+			if(transition.next >= stateCount) return(false);
+			if(transition.child >= stateCount && transition.child != unvalidated) return(false);
+			if(
+				count < state.count &&
+				transitionList.back().idElement >= transition.idElement
+			) return(false);
+
+			transitionList.push_back(transition);
+		}
+
+		stateList.push_back(state);
+	}
+
+	if(data != end) return(false);
+
+	this->stateList.swap(stateList);
+	this->transitionList.swap(transitionList);
+	this->root = root;
+
+	return(true);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/** Content models of complex types compiled in JavaScript into a single
+  * table of deterministic automata over element name token IDs.
+  * Each state of an element tells which children may follow. */
+
+class ContentModel {
+
+public:
+
+	/** State of elements whose children are not validated. */
+	static constexpr uint32_t unvalidated = ~0u;
+
+	/** Load automata serialized as 32-bit words:
+	  * state count, root state, then for each state an accepting flag,
+	  * transition count and transitions as triples of element ID,
+	  * next state and initial state of the child element's own content.
+	  * Transitions must be sorted by element ID.
+	  * Returns false and stays empty if the data is malformed. */
+	bool setData(const uint32_t *data, size_t len);
+
+	/** Initial state for top-level elements of the document. */
+	uint32_t getRoot() const { return(root); }
+
+	uint32_t getStateCount() const { return(stateList.size()); }
+
+	bool isAccepting(uint32_t state) const {
+		return(state == unvalidated || stateList[state].isAccepting);
+	}
+
+	/** Advance state past a child element, also returning the child's
+	  * initial state. Returns false if the child is not allowed. */
+	inline bool step(uint32_t &state, uint32_t idElement, uint32_t &childState) const {
+		if(state == unvalidated) {
+			childState = unvalidated;
+			return(true);
+		}
+
+		const State &item = stateList[state];
+		const Transition *first = transitionList.data() + item.first;
+		uint32_t count = item.count;
+
+		// Binary search for the element ID.
+		while(count) {
+			uint32_t half = count >> 1;
+
+			if(first[half].idElement < idElement) {
+				first += half + 1;
+				count -= half + 1;
+			} else count = half;
+		}
+
+		if(first == transitionList.data() + item.first + item.count || first->idElement != idElement) {
+			return(false);
+		}
+
+		state = first->next;
+		childState = first->child;
+		return(true);
+	}
+
+private:
+
+	struct State {
+		uint32_t first;
+		uint32_t count;
+		bool isAccepting;
+	};
+
+	struct Transition {
+		uint32_t idElement;
+		uint32_t next;
+		uint32_t child;
+	};
+
+	std::vector<State> stateList;
+	std::vector<Transition> transitionList;
+	uint32_t root = unvalidated;
+
+};
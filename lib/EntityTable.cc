@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cstring>
+
+#include "EntityTable.h"
+
+static inline bool isWhite(unsigned char c) {
+	return(c == ' ' || c == '\t' || c == '\n' || c == '\r');
+}
+
+void EntityTable :: addDeclaration(const unsigned char *p, size_t len) {
+	const unsigned char *end = p + len;
+	const unsigned char *nameStart;
+	unsigned char quote;
+
+	if(len < 6 || std::memcmp(p, "ENTITY", 6)) return;
+	p += 6;
+
+	if(p >= end || !isWhite(*p)) return;
+	while(p < end && isWhite(*p)) ++p;
+
+	// Parameter entities are only used inside the DTD.
+	if(p >= end || *p == '%') return;
+
+	nameStart = p;
+	while(p < end && !isWhite(*p) && *p != '"' && *p != '\'') ++p;
+	if(p == nameStart) return;
+
+	std::string name(nameStart, p);
+
+	while(p < end && isWhite(*p)) ++p;
+
+	// External entities have SYSTEM or PUBLIC identifiers instead.
+	if(p >= end || (*p != '"' && *p != '\'')) return;
+
+	quote = *p++;
+	const unsigned char *valueStart = p;
+	const unsigned char *valueEnd = static_cast<const unsigned char *>(
+		std::memchr(p, quote, end - p)
+	);
+
+	if(!valueEnd) return;
+
+	if(name.size() > maxNameLen) maxNameLen = name.size();
+	tbl.emplace(std::move(name), std::string(valueStart, valueEnd));
+}
+
+EntityTable :: Status EntityTable :: expand(
+	const unsigned char *p,
+	size_t len,
+	unsigned char *out,
+	size_t &pos
+) {
+	size_t startPos = pos;
+	size_t startTotal = total;
+	bool isExpanded = false;
+
+	if(!expandRecursive(p, len, 0, out, pos, isExpanded)) return(Status :: LIMIT);
+
+	if(!isExpanded) {
+		pos = startPos;
+		total = startTotal;
+		return(Status :: UNCHANGED);
+	}
+
+	return(Status :: EXPANDED);
+}
+
+bool EntityTable :: expandRecursive(
+	const unsigned char *p,
+	size_t len,
+	uint32_t depth,
+	unsigned char *out,
+	size_t &pos,
+	bool &isExpanded
+) {
+	const unsigned char *end = p + len;
+	const unsigned char *ref;
+	const unsigned char *refEnd;
+	size_t copyLen;
+
+	while(p < end) {
+		ref = static_cast<const unsigned char *>(std::memchr(p, '&', end - p));
+		if(!ref) ref = end;
+
+		// Copy text before the reference, and the ampersand unless the
+		// reference gets replaced.
+		copyLen = ref - p + (ref < end);
+		refEnd = ref < end ? static_cast<const unsigned char *>(std::memchr(
+			ref,
+			';',
+			std::min(static_cast<size_t>(end - ref), maxNameLen + 2)
+		)) : nullptr;
+
+		auto entity = refEnd ? tbl.find(std::string(ref + 1, refEnd)) : tbl.end();
+		if(entity != tbl.end()) --copyLen;
+
+		// Fail as soon as output would exceed the limit. In a batch, pos may
+		// exceed total because documents share the buffer.
+		if(copyLen > maxBytes - total || copyLen > maxBytes - pos) return(false);
+		std::memcpy(out + pos, p, copyLen);
+		pos += copyLen;
+		total += copyLen;
+
+		if(entity == tbl.end()) {
+			p += copyLen;
+			continue;
+		}
+
+		if(depth >= maxDepth) return(false);
+
+		const std::string &value = entity->second;
+		if(!expandRecursive(
+			reinterpret_cast<const unsigned char *>(value.data()),
+			value.size(),
+			depth + 1,
+			out,
+			pos,
+			isExpanded
+		)) return(false);
+
+		isExpanded = true;
+		p = refEnd + 1;
+	}
+
+	return(true);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+/** General entities declared in a DOCTYPE internal subset, expanded with
+  * limits on nesting depth and total output to stop expansion blow-ups. */
+
+class EntityTable {
+
+public:
+
+	enum class Status : uint32_t {
+		/** Text had no references to declared entities. */
+		UNCHANGED,
+		EXPANDED,
+		/** Nesting depth or total output exceeded its limit. */
+		LIMIT
+	};
+
+	void setLimits(uint32_t maxDepth, size_t maxBytes) {
+		this->maxDepth = maxDepth;
+		this->maxBytes = maxBytes;
+	}
+
+	/** Forget all entities and reset output total for a new document. */
+	void clear() {
+		tbl.clear();
+		maxNameLen = 0;
+		total = 0;
+	}
+
+	bool empty() { return(tbl.empty()); }
+
+	/** Store an internal entity from a markup declaration, given its contents
+	  * between <! and >. Other declarations, parameter entities and external
+	  * entities are ignored. The first declaration of a name is binding. */
+	void addDeclaration(const unsigned char *p, size_t len);
+
+	/** Copy text to out starting from pos, replacing references to declared
+	  * entities recursively. Other references are copied as is. Unless
+	  * the text was expanded, pos and the output total are unchanged.
+	  * Output never extends past maxBytes from the start of out. */
+	Status expand(const unsigned char *p, size_t len, unsigned char *out, size_t &pos);
+
+private:
+
+	bool expandRecursive(
+		const unsigned char *p,
+		size_t len,
+		uint32_t depth,
+		unsigned char *out,
+		size_t &pos,
+		bool &isExpanded
+	);
+
+	std::unordered_map<std::string, std::string> tbl;
+	/** Length of the longest declared name, to bound searching for
+	  * the end of a reference. */
+	size_t maxNameLen = 0;
+
+	uint32_t maxDepth = 0;
+	/** Limit for output bytes in a document, also the output buffer size. */
+	size_t maxBytes = 0;
+	size_t total = 0;
+
+};
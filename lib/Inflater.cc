@@ -0,0 +1,78 @@
+#include <climits>
+#include <cstring>
+
+#include "Inflater.h"
+
+Inflater :: ~Inflater() {
+	if(isReady) inflateEnd(&stream);
+}
+
+bool Inflater :: setInput(const unsigned char *data, size_t len) {
+	if(!isReady) {
+		std::memset(&stream, 0, sizeof(stream));
+
+		// Window size 15 bits, + 32 enables automatic gzip / zlib detection.
+		if(inflateInit2(&stream, 15 + 32) != Z_OK) return(false);
+		isReady = true;
+	}
+
+	input = data;
+	inputLen = len;
+
+	return(true);
+}
+
+Inflater :: Status Inflater :: inflate(unsigned char *out, size_t outLen, size_t &written) {
+	Status status = Status :: OK;
+	int result;
+
+	stream.next_out = out;
+	stream.avail_out = static_cast<uInt>(outLen < UINT_MAX ? outLen : UINT_MAX);
+
+	while(stream.avail_out) {
+		if(!stream.avail_in) {
+			if(!inputLen) {
+				status = Status :: NEED_INPUT;
+				break;
+			}
+
+			uInt len = static_cast<uInt>(inputLen < UINT_MAX ? inputLen : UINT_MAX);
+
+			stream.next_in = const_cast<unsigned char *>(input);
+			stream.avail_in = len;
+			input += len;
+			inputLen -= len;
+		}
+
+		if(isEnded) {
+			// More input after the end of a stream starts another gzip member.
+			inflateReset(&stream);
+			isEnded = false;
+		}
+
+		isStarted = true;
+		result = ::inflate(&stream, Z_NO_FLUSH);
+
+		if(result == Z_STREAM_END) {
+			isEnded = true;
+		} else if(result != Z_OK && result != Z_BUF_ERROR) {
+			status = Status :: ERROR;
+			break;
+		}
+	}
+
+	written = stream.next_out - out;
+
+	return(status);
+}
+
+void Inflater :: reset() {
+	if(isReady) inflateReset(&stream);
+
+	stream.avail_in = 0;
+	input = nullptr;
+	inputLen = 0;
+
+	isStarted = false;
+	isEnded = false;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <zlib.h>
+
+/** Streaming gzip or zlib decompressor, detecting the format from a header.
+  * Concatenated gzip members are decompressed as one stream. */
+class Inflater {
+
+public:
+
+	enum class Status : uint32_t {
+		/** Output buffer is full. */
+		OK,
+		/** All input was consumed. */
+		NEED_INPUT,
+		/** Input is corrupted. */
+		ERROR
+	};
+
+	Inflater() {}
+	~Inflater();
+
+	Inflater(const Inflater &) = delete;
+	Inflater &operator=(const Inflater &) = delete;
+
+	/** Set next block of compressed input. Previous input must be consumed. */
+	bool setInput(const unsigned char *data, size_t len);
+
+	/** Decompress as much input as fits in the output buffer.
+	  * @param written Number of bytes stored in out. */
+	Status inflate(unsigned char *out, size_t outLen, size_t &written);
+
+	/** Forget any partial stream to start decompressing a new one. */
+	void reset();
+
+	/** Check if a stream was started but has not ended. */
+	bool isTruncated() { return(isStarted && !isEnded); }
+
+private:
+
+	z_stream stream;
+
+	/** Remaining input not yet passed to zlib (its counters are 32-bit). */
+	const unsigned char *input = nullptr;
+	size_t inputLen = 0;
+
+	bool isReady = false;
+	bool isStarted = false;
+	bool isEnded = false;
+
+};
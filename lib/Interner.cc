@@ -0,0 +1,96 @@
+#include <cstring>
+
+#include "Interner.h"
+
+/** Hash 8 bytes at a time, mixing with multiplies and shifts. */
+uint32_t Interner :: hash(uint32_t tag, const unsigned char *data, size_t len) {
+	uint64_t h = (tag + 1) * 0x9e3779b97f4a7c15ULL ^ len;
+	uint64_t word;
+
+	while(len >= 8) {
+		std::memcpy(&word, data, 8);
+		h = (h ^ word) * 0xff51afd7ed558ccdULL;
+		h ^= h >> 32;
+
+		data += 8;
+		len -= 8;
+	}
+
+	word = 0;
+	std::memcpy(&word, data, len);
+	h = (h ^ word) * 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 29;
+
+	return(static_cast<uint32_t>(h));
+}
+
+uint32_t Interner :: find(
+	uint32_t tag,
+	const unsigned char *data,
+	size_t len,
+	bool insert,
+	bool &isNew
+) {
+	isNew = false;
+
+	if(slotList.empty()) {
+		if(!insert) return(notFound);
+		slotList.resize(64, Slot { notFound, 0, 0, 0, 0 });
+	}
+
+	const uint32_t h = hash(tag, data, len);
+	const size_t mask = slotList.size() - 1;
+	size_t num = h & mask;
+
+	while(1) {
+		Slot &slot = slotList[num];
+
+		if(slot.id == notFound) break;
+
+		if(
+			slot.hash == h &&
+			slot.tag == tag &&
+			slot.len == len &&
+			!std::memcmp(textBuffer.data() + slot.offset, data, len)
+		) {
+			return(slot.id);
+		}
+
+		num = (num + 1) & mask;
+	}
+
+	if(!insert) return(notFound);
+
+	const uint32_t id = count++;
+
+	slotList[num] = Slot { id, h, tag, static_cast<uint32_t>(len), textBuffer.size() };
+	textBuffer.insert(textBuffer.end(), data, data + len);
+	isNew = true;
+
+	// Keep load factor under 1/2 so probe sequences remain short.
+	if(count * 2 > slotList.size()) grow();
+
+	return(id);
+}
+
+void Interner :: grow() {
+	std::vector<Slot> oldList(slotList.size() * 2, Slot { notFound, 0, 0, 0, 0 });
+	oldList.swap(slotList);
+
+	const size_t mask = slotList.size() - 1;
+
+	for(const Slot &slot : oldList) {
+		if(slot.id == notFound) continue;
+
+		size_t num = slot.hash & mask;
+		while(slotList[num].id != notFound) num = (num + 1) & mask;
+
+		slotList[num] = slot;
+	}
+}
+
+void Interner :: clear() {
+	slotList.clear();
+	textBuffer.clear();
+	count = 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/** Hash table assigning sequential IDs to byte strings, so repeated strings
+  * only need to be decoded once. Strings with different tags are distinct. */
+
+class Interner {
+
+public:
+
+	static constexpr uint32_t notFound = ~0U;
+
+	/** Look up a string. If not found and insert is true, copy it and assign
+	  * the next free ID, setting isNew.
+	  * @return String ID or notFound. */
+	uint32_t find(
+		uint32_t tag,
+		const unsigned char *data,
+		size_t len,
+		bool insert,
+		bool &isNew
+	);
+
+	/** Remove all strings. Next ID will be zero again. */
+	void clear();
+
+	uint32_t getCount() { return(count); }
+
+	/** Hash a string, also used for other tables of names. */
+	static uint32_t hash(uint32_t tag, const unsigned char *data, size_t len);
+
+private:
+
+	struct Slot {
+		uint32_t id;
+		uint32_t hash;
+		uint32_t tag;
+		uint32_t len;
+		/** Offset of string contents in textBuffer. */
+		size_t offset;
+	};
+
+	/** Double number of slots and reinsert all strings. */
+	void grow();
+
+	/** Open addressing table with linear probing. Size is a power of 2. */
+	std::vector<Slot> slotList;
+
+	/** Contents of all inserted strings. */
+	std::vector<unsigned char> textBuffer;
+
+	uint32_t count = 0;
+
+};
@@ -0,0 +1,185 @@
+#include "ByteSet.h"
+#include "JsonWriter.h"
+
+namespace {
+
+/** Bytes needing escapes in JSON strings, and line breaks to normalize. */
+const ByteSet jsonSpecial("\"\\", true);
+
+const char hexDigitList[] = "0123456789abcdef";
+
+}
+
+void JsonWriter :: writeIndent(uint32_t depth) {
+	output.put('\n');
+	for(uint32_t num = 0; num < depth && num < 255; ++num) output.put('\t');
+}
+
+void JsonWriter :: writeEscaped(const Span &span) {
+	const unsigned char *p = span.data;
+	const unsigned char *end = p + span.len;
+
+	while(p < end) {
+		size_t len = jsonSpecial.skip(p, end - p);
+
+		output.write(p, len);
+		p += len;
+		if(p >= end) break;
+
+		unsigned char c = *p++;
+
+		switch(c) {
+			case '"': output.write("\\\""); break;
+			case '\\': output.write("\\\\"); break;
+			case '\t': output.write("\\t"); break;
+			case '\b': output.write("\\b"); break;
+			case '\f': output.write("\\f"); break;
+
+			case '\r':
+			case '\n':
+
+				// Like the JavaScript parser, turn \r\n, \n\r and \r into \n.
+				if(p < end && (*p ^ c) == ('\r' ^ '\n')) ++p;
+				output.write("\\n");
+				break;
+
+			default:
+
+				output.write("\\u00");
+				output.put(hexDigitList[c >> 4]);
+				output.put(hexDigitList[c & 15]);
+				break;
+		}
+	}
+}
+
+void JsonWriter :: openElement(const Span &prefix, const Span &name) {
+	isValuePending = false;
+
+	// Processing instructions are not elements.
+	if(isPrefix(prefix, '?')) {
+		skippedState = state;
+		state = State :: SKIP;
+		return;
+	}
+
+	if(isStarted) {
+		output.put(',');
+		writeIndent(depth);
+	}
+
+	isStarted = true;
+
+	output.write("[ \"");
+	writeEscaped(name);
+	output.put('"');
+
+	++depth;
+	state = State :: ELEMENT;
+}
+
+void JsonWriter :: attribute(const Span &prefix, const Span &name, uint32_t idNamespace) {
+	if(state != State :: ELEMENT) return;
+
+	output.write(", [ \"$");
+	writeEscaped(name);
+	output.put('"');
+	isValuePending = true;
+}
+
+void JsonWriter :: xmlns(const Span &prefix) {
+	// Namespace declarations are omitted.
+	isValuePending = false;
+}
+
+void JsonWriter :: value(const Span &value) {
+	if(!isValuePending) return;
+
+	output.write(", \"");
+	writeEscaped(value);
+	output.write("\" ]");
+
+	isValuePending = false;
+}
+
+void JsonWriter :: startTagEnd(bool isClosed) {
+	isValuePending = false;
+
+	if(state == State :: SKIP) {
+		state = skippedState;
+		return;
+	}
+
+	if(state != State :: ELEMENT) return;
+
+	if(isClosed) {
+		--depth;
+		output.write(" ]");
+	}
+
+	state = State :: TEXT;
+}
+
+void JsonWriter :: closeElement(const Span &prefix, const Span &name) {
+	if(!depth) return;
+
+	--depth;
+
+	if(state == State :: TEXT) {
+		writeIndent(depth);
+		output.put(']');
+	} else {
+		output.write(" ]");
+	}
+
+	state = State :: TEXT;
+}
+
+void JsonWriter :: text(const Span &text) {
+	if(!depth || sgmlNesting) return;
+
+	output.write(", [ \"$\", \"");
+	writeEscaped(text);
+	output.write("\" ]");
+
+	state = State :: AFTER_TEXT;
+}
+
+void JsonWriter :: cdata(const Span &text) {
+	JsonWriter :: text(text);
+}
+
+void JsonWriter :: sgmlNested(bool isStart) {
+	if(isStart) ++sgmlNesting;
+	else if(sgmlNesting) --sgmlNesting;
+}
+
+void JsonWriter :: documentEnd() {
+	if(isStarted) output.put('\n');
+
+	state = State :: TEXT;
+	isValuePending = false;
+	depth = 0;
+	sgmlNesting = 0;
+	isStarted = false;
+}
+
+void JsonWriter :: end() {
+	if(isStarted) documentEnd();
+
+	output.flush();
+}
+
+#include <nbind/nbind.h>
+
+#ifdef NBIND_CLASS
+
+NBIND_CLASS(JsonWriter) {
+	inherit(TokenDecoder);
+	construct<>();
+
+	method(setOutputBuffer);
+	method(end);
+}
+
+#endif
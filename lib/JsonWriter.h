@@ -0,0 +1,71 @@
+#pragma once
+
+#include "OutputBuffer.h"
+#include "TokenDecoder.h"
+
+/** Transcode XML straight from parser code buffers to JSON, in the same
+  * format as JsonWriter in JavaScript. Elements become arrays starting
+  * with their name, followed by [ "$name", "value" ] for attributes,
+  * [ "$", "text" ] for text and nested arrays for child elements. */
+
+class JsonWriter : public TokenDecoder {
+
+public:
+
+	void setOutputBuffer(nbind::Buffer buffer, nbind::cbFunction &flushOutput) {
+		output.setBuffer(buffer, flushOutput);
+	}
+
+	/** Finish output after all input was parsed. */
+	void end();
+
+protected:
+
+	void openElement(const Span &prefix, const Span &name) override;
+	void attribute(const Span &prefix, const Span &name, uint32_t idNamespace) override;
+	void xmlns(const Span &prefix) override;
+	void value(const Span &value) override;
+	void startTagEnd(bool isClosed) override;
+	void closeElement(const Span &prefix, const Span &name) override;
+	void text(const Span &text) override;
+	void cdata(const Span &text) override;
+	void comment(const Span &text) override {}
+	void sgml(const Span &prefix, const Span &name) override {}
+	void sgmlText(const Span &text) override {}
+	void sgmlNested(bool isStart) override;
+	void sgmlEnd() override {}
+	void documentEnd() override;
+
+private:
+
+	enum class State : uint32_t {
+		/** Inside an element, after a child element or at the start. */
+		TEXT,
+		/** Inside an element, after its attributes or text. */
+		AFTER_TEXT,
+		ELEMENT,
+		/** Inside a processing instruction, omitted from output. */
+		SKIP
+	};
+
+	/** Write a line break and indentation. */
+	void writeIndent(uint32_t depth);
+
+	/** Write string contents escaped and with line breaks normalized. */
+	void writeEscaped(const Span &span);
+
+	OutputBuffer output;
+
+	State state = State :: TEXT;
+	/** State to restore after a processing instruction. */
+	State skippedState = State :: TEXT;
+	bool isValuePending = false;
+
+	/** Number of open elements. */
+	uint32_t depth = 0;
+	/** Nesting depth of SGML declarations, where text is ignored. */
+	uint32_t sgmlNesting = 0;
+
+	bool isStarted = false;
+
+};
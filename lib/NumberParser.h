@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+/** Conversion of decimal numbers in text to binary, without copying
+  * or locale lookups in the common case. Runs of 8 digits are converted
+  * at once as a single 64-bit word, and doubles with up to 19 digits
+  * and small exponents are exact using a single multiplication or
+  * division. Other syntax like INF and NaN falls back to strtod. */
+
+class NumberParser {
+
+public:
+
+	/** Longest number passed to strtod, longer ones are invalid. */
+	static constexpr size_t maxFallbackLen = 63;
+
+	/** Parse a whole span as a decimal integer with an optional sign. */
+	static bool parseInt32(const unsigned char *p, size_t len, int32_t &result) {
+		const unsigned char *end = p + len;
+		bool isNegative = false;
+		bool isExact = true;
+		uint64_t value = 0;
+
+		if(p < end && (*p == '-' || *p == '+')) isNegative = (*p++ == '-');
+
+		if(!readDigits(p, end, value, isExact) || p != end || !isExact) return(false);
+		if(value > static_cast<uint64_t>(std::numeric_limits<int32_t>::max()) + isNegative) return(false);
+
+		result = static_cast<int32_t>(isNegative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value));
+		return(true);
+	}
+
+	/** Parse a whole span as a floating point number. */
+	static bool parseFloat64(const unsigned char *p, size_t len, double &result) {
+		const unsigned char *start = p;
+		const unsigned char *end = p + len;
+		bool isNegative = false;
+		bool isExact = true;
+		uint64_t mantissa = 0;
+		int32_t exponent = 0;
+
+		if(p < end && (*p == '-' || *p == '+')) isNegative = (*p++ == '-');
+
+		uint32_t count = readDigits(p, end, mantissa, isExact);
+
+		if(p < end && *p == '.') {
+			uint32_t fractionCount = readDigits(++p, end, mantissa, isExact);
+
+			count += fractionCount;
+			exponent = -static_cast<int32_t>(fractionCount);
+		}
+
+		if(p < end && (*p == 'e' || *p == 'E')) {
+			bool isExponentNegative = false;
+			uint64_t value = 0;
+
+			if(++p < end && (*p == '-' || *p == '+')) isExponentNegative = (*p++ == '-');
+
+			if(readDigits(p, end, value, isExact) && value <= 9999) {
+				exponent += isExponentNegative ? -static_cast<int32_t>(value) : static_cast<int32_t>(value);
+			} else isExact = false;
+		}
+
+		if(
+			count && isExact && p == end &&
+			mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22
+		) {
+			// Both operands are exact, so the result is correctly rounded.
+			double value = static_cast<double>(mantissa);
+
+			if(exponent < 0) value /= getPow10(-exponent);
+			else value *= getPow10(exponent);
+
+			result = isNegative ? -value : value;
+			return(true);
+		}
+
+		return(parseFallback(start, len, result));
+	}
+
+private:
+
+	/** Read decimal digits at p into value, advancing p. Clears isExact
+	  * if value would overflow.
+	  * @return Number of digits. */
+	static inline uint32_t readDigits(
+		const unsigned char *&p,
+		const unsigned char *end,
+		uint64_t &value,
+		bool &isExact
+	) {
+		const unsigned char *start = p;
+
+#		if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+			uint64_t word;
+
+			// Another 8 digits fit if value stays below 10^19.
+			while(end - p >= 8 && value < 100000000000ULL) {
+				std::memcpy(&word, p, 8);
+				if(!isEightDigits(word)) break;
+
+				value = value * 100000000 + parseEightDigits(word);
+				p += 8;
+			}
+#		endif
+
+		while(p < end && static_cast<unsigned char>(*p - '0') <= 9) {
+			if(value < 1000000000000000000ULL) value = value * 10 + (*p - '0');
+			else isExact = false;
+
+			++p;
+		}
+
+		return(static_cast<uint32_t>(p - start));
+	}
+
+	/** Check if all bytes of a little endian word are ASCII digits. */
+	static inline bool isEightDigits(uint64_t word) {
+		return((
+			(word & 0xf0f0f0f0f0f0f0f0ULL) |
+			(((word + 0x0606060606060606ULL) & 0xf0f0f0f0f0f0f0f0ULL) >> 4)
+		) == 0x3333333333333333ULL);
+	}
+
+	/** Convert 8 ASCII digits in a little endian word, combining
+	  * pairs of neighbours with a multiplication in each step. */
+	static inline uint32_t parseEightDigits(uint64_t word) {
+		word = ((word & 0x0f0f0f0f0f0f0f0fULL) * 2561) >> 8;
+		word = ((word & 0x00ff00ff00ff00ffULL) * 6553601) >> 16;
+		return(static_cast<uint32_t>(((word & 0x0000ffff0000ffffULL) * 42949672960001ULL) >> 32));
+	}
+
+	/** Powers of ten exactly representable as doubles, up to 22. */
+	static inline double getPow10(int32_t exponent) {
+		static const double pow10Tbl[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		return(pow10Tbl[exponent]);
+	}
+
+	static bool parseFallback(const unsigned char *p, size_t len, double &result) {
+		char buffer[maxFallbackLen + 1];
+
+		if(!len || len > maxFallbackLen) return(false);
+
+		std::memcpy(buffer, p, len);
+		buffer[len] = 0;
+
+		char *parsedEnd;
+		result = std::strtod(buffer, &parsedEnd);
+
+		return(parsedEnd == buffer + len);
+	}
+
+};
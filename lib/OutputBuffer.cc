@@ -0,0 +1,23 @@
+#include "OutputBuffer.h"
+
+void OutputBuffer :: setBuffer(nbind::Buffer buffer, nbind::cbFunction &flushOutput) {
+	this->flushOutput = std::unique_ptr<nbind::cbFunction>(new nbind::cbFunction(flushOutput));
+	this->buffer = buffer;
+
+	// An empty buffer could never be filled, so discard output instead.
+	start = buffer.length() ? buffer.data() : nullptr;
+	pos = start;
+	end = start ? start + buffer.length() : nullptr;
+}
+
+void OutputBuffer :: flush() {
+	if(pos == start || !flushOutput) return;
+
+#	ifdef __EMSCRIPTEN__
+		// JavaScript only sees a copy of the buffer.
+		buffer.commit();
+#	endif
+
+	(*flushOutput)(static_cast<uint32_t>(pos - start));
+	pos = start;
+}
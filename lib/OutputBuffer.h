@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+#include <nbind/api.h>
+
+/** Fixed size output buffer shared with JavaScript, which receives the
+  * number of valid bytes through a callback every time it fills up. */
+
+class OutputBuffer {
+
+public:
+
+	void setBuffer(nbind::Buffer buffer, nbind::cbFunction &flushOutput);
+
+	/** Pass any buffered output to JavaScript. */
+	void flush();
+
+	inline void put(unsigned char c) {
+		if(pos >= end) {
+			// Discard output if no buffer was set.
+			if(!start) return;
+			flush();
+		}
+		*pos++ = c;
+	}
+
+	inline void write(const unsigned char *data, size_t len) {
+		size_t room = end - pos;
+		if(!start) return;
+
+		while(len > room) {
+			std::memcpy(pos, data, room);
+			pos += room;
+			data += room;
+			len -= room;
+
+			flush();
+			room = end - pos;
+		}
+
+		std::memcpy(pos, data, len);
+		pos += len;
+	}
+
+	inline void write(const char *text, size_t len) {
+		write(reinterpret_cast<const unsigned char *>(text), len);
+	}
+
+	template <size_t len>
+	inline void write(const char (&text)[len]) {
+		write(reinterpret_cast<const unsigned char *>(text), len - 1);
+	}
+
+private:
+
+	nbind::Buffer buffer;
+	std::unique_ptr<nbind::cbFunction> flushOutput;
+
+	unsigned char *start = nullptr;
+	unsigned char *pos = nullptr;
+	unsigned char *end = nullptr;
+
+};
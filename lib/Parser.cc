@@ -1,19 +1,88 @@
+#include <algorithm>
+#include <cstddef>
 #include <cstring>
 #include <cstdio>
+#include <limits>
 
+#include "ByteSet.h"
+#include "NumberParser.h"
 #include "Parser.h"
 
 #ifndef DEBUG_PARTIAL_NAME_RECOVERY
 #	define DEBUG_PARTIAL_NAME_RECOVERY 0
 #endif
 
+// Compile with -DPARSER_DIRECT_THREADING=1 to jump directly between states
+// using labels as values (a GCC extension also supported by Clang) instead
+// of a central switch statement.
+#ifndef PARSER_DIRECT_THREADING
+#	define PARSER_DIRECT_THREADING 0
+#endif
+
+#if PARSER_DIRECT_THREADING && !defined(__GNUC__)
+#	error "PARSER_DIRECT_THREADING requires GCC or Clang"
+#endif
+
+#if PARSER_DIRECT_THREADING
+	// Change state without consuming input.
+#	define PARSER_CONTINUE goto *stateLabelTbl[static_cast<uint32_t>(state)]
+	// Consume a byte of input and change state.
+#	define PARSER_BREAK do { \
+		if(!consumeChar<trackPosition, validateUtf8>(c)) goto INVALID_UTF8; \
+		if(!--len) return(ErrorType :: OK); \
+		c = *p++; \
+		if(tokenPtr > tokenSuspendPtr) goto SUSPEND; \
+		PARSER_CONTINUE; \
+	} while(0)
+	// Label only needed as a jump target for direct threading.
+#	define PARSER_LABEL(name) name:
+#else
+#	define PARSER_CONTINUE continue
+#	define PARSER_BREAK break
+#	define PARSER_LABEL(name)
+#endif
+
 unsigned char whiteCharTbl[256];
 unsigned char valueCharTbl[256];
 unsigned char xmlNameStartCharTbl[256];
 unsigned char xmlNameCharTbl[256];
 unsigned char dtdNameCharTbl[256];
 
+/** Bytes in text ending a run of valueCharTbl entries or needing checks.
+  * Whitespace other than spaces is also included, but handled quickly. */
+const ByteSet valueSpecial("\"'&<>]\x7f", true, 0xf7);
+
+/** Bytes possibly ending a number in a list. */
+const ByteSet numberEnd(" \t\n\r<\"'");
+
 Parser :: Parser(const ParserConfig &config) : config(config) {
+	reset();
+	resetStats();
+}
+
+void Parser :: reset() {
+	// Restore namespace prefix bindings in reverse order. Unlike when closing
+	// an element, also undefine prefixes to match a freshly created parser.
+	while(!prefixStack.empty()) {
+		const PrefixDefinition &old = prefixStack.back();
+
+		config.namespacePrefixTbl[old.idPrefix] = std::make_pair(
+			old.idNamespace,
+			config.namespaceList[old.idNamespace].get()
+		);
+
+		prefixStack.pop_back();
+	}
+
+	elementStack.clear();
+
+	contentModel = config.contentModel;
+	documentState = contentModel ? contentModel->getRoot() : ContentModel :: unvalidated;
+
+	elementPrefix = PrefixDefinition();
+	attributePrefix = PrefixDefinition();
+	memberPrefix = &attributePrefix;
+
 	state = State :: MATCH;
 	nameCharTbl = xmlNameCharTbl;
 	nameStartCharTbl = xmlNameStartCharTbl;
@@ -25,6 +94,363 @@ Parser :: Parser(const ParserConfig &config) : config(config) {
 	row = 0;
 	col = 0;
 	sgmlNesting = 0;
+
+	utf8Pending = 0;
+	utf8Min = 0x80;
+	utf8Max = 0xbf;
+	errorOffset = 0;
+
+	isSuspended = false;
+	isNamespaceStale = false;
+
+	entityTbl.clear();
+	isEntityDeclaration = false;
+	declBuffer.clear();
+	hasEntityRef = false;
+	textBuffer.clear();
+	spanFlags.clear();
+	attributeStart = nullptr;
+	textNumberType = NumberListType :: NONE;
+	valueNumberType = NumberListType :: NONE;
+	numberType = NumberListType :: NONE;
+	numberText.clear();
+	attributeSet.clear();
+
+	inflater.reset();
+}
+
+namespace {
+
+/** Identifies snapshot data and its layout version. */
+constexpr uint32_t snapshotMagic = 0x70736d78;
+constexpr uint32_t snapshotVersion = 4;
+
+/** Literals matched in State :: MATCH, stored by index. */
+const char *const snapshotPatternList[] = { "\xef\xbb\xbf", "=\"", "CDATA[" };
+
+/** Tries a Patricia cursor can point into. */
+enum class SnapshotTrie : uint32_t {
+	NONE,
+	URI,
+	PREFIX,
+	ELEMENT,
+	ATTRIBUTE,
+	COUNT
+};
+
+/** Bounds checked reader for snapshot data. After any invalid input,
+  * all further reads return zero. */
+class SnapshotReader {
+
+public:
+
+	SnapshotReader(const unsigned char *data, size_t len) : p(data), end(data + len) {}
+
+	/** Read a value, which must be less than limit. */
+	uint32_t read(uint32_t limit = ~0U) {
+		uint32_t value;
+
+		if(!isValid || end - p < 4) {
+			isValid = false;
+			return(0);
+		}
+
+		memcpy(&value, p, 4);
+		p += 4;
+
+		if(value >= limit) {
+			isValid = false;
+			return(0);
+		}
+
+		return(value);
+	}
+
+	/** Read a value, which must equal the expected one. */
+	bool expect(uint32_t expected) {
+		if(read() != expected) isValid = false;
+		return(isValid);
+	}
+
+	bool isValid = true;
+
+private:
+
+	const unsigned char *p;
+	const unsigned char *end;
+
+};
+
+}
+
+uint32_t Parser :: snapshot(nbind::Buffer buffer) {
+	// Decompressor state, suspended chunks, entities, skipped records
+	// and number lists in progress are not serialized.
+	if(
+		inflater.isTruncated() || isSuspended ||
+		!entityTbl.empty() || isEntityDeclaration ||
+		state == State :: SKIP_RECORD || state == State :: NUMBER_LIST
+	) return(0);
+
+	unsigned char *const charTblList[] = { xmlNameCharTbl, xmlNameStartCharTbl, dtdNameCharTbl };
+	std::vector<uint32_t> data;
+	SnapshotTrie trieKind = SnapshotTrie :: NONE;
+	uint32_t idNamespace = 0;
+	uint32_t ptrOffset = 0;
+	uint32_t foundOffset = 0;
+	uint32_t cursorLen = 0;
+	uint32_t patternNum = 0;
+	uint32_t nameCharNum = 0;
+	uint32_t nameStartCharNum = 0;
+
+	// Store the cursor position relative to whichever trie it is in.
+	if(cursor.getOffsets(config.uriTrie, ptrOffset, foundOffset, cursorLen)) {
+		trieKind = SnapshotTrie :: URI;
+	} else if(cursor.getOffsets(config.prefixTrie, ptrOffset, foundOffset, cursorLen)) {
+		trieKind = SnapshotTrie :: PREFIX;
+	} else {
+		for(idNamespace = 0; idNamespace < config.namespaceList.size(); ++idNamespace) {
+			const Namespace *ns = config.namespaceList[idNamespace].get();
+			if(!ns) continue;
+
+			if(cursor.getOffsets(ns->elementTrie, ptrOffset, foundOffset, cursorLen)) {
+				trieKind = SnapshotTrie :: ELEMENT;
+				break;
+			}
+
+			if(cursor.getOffsets(ns->attributeTrie, ptrOffset, foundOffset, cursorLen)) {
+				trieKind = SnapshotTrie :: ATTRIBUTE;
+				break;
+			}
+		}
+	}
+
+	if(trieKind == SnapshotTrie :: NONE) {
+		// JavaScript may have replaced the trie after the cursor entered it.
+		if(isCursorActive()) return(0);
+		idNamespace = 0;
+	}
+
+	// Lists have 3 entries, so anything else must match the last one.
+	while(patternNum < 2 && strcmp(pattern, snapshotPatternList[patternNum])) ++patternNum;
+	while(nameCharNum < 2 && nameCharTbl != charTblList[nameCharNum]) ++nameCharNum;
+	while(nameStartCharNum < 2 && nameStartCharTbl != charTblList[nameStartCharNum]) ++nameStartCharNum;
+
+	data.push_back(snapshotMagic);
+	data.push_back(snapshotVersion);
+	data.push_back(config.features);
+
+	for(State item : {
+		state, matchState, noMatchState, partialMatchState, afterNameState,
+		afterTextState, afterMatchTrieState, nextState, otherState, afterValueState
+	}) data.push_back(static_cast<uint32_t>(item));
+
+	data.push_back(knownName);
+	data.push_back(static_cast<uint32_t>(tagType));
+	data.push_back(static_cast<uint32_t>(matchTarget));
+	data.push_back(textEndChar);
+	data.push_back(expected);
+	data.push_back(pos);
+	data.push_back(row);
+	data.push_back(col);
+	data.push_back(idToken);
+	data.push_back(idPrefix);
+	data.push_back(idElement);
+	data.push_back(sgmlNesting);
+	data.push_back(utf8Pending);
+	data.push_back(utf8Min);
+	data.push_back(utf8Max);
+
+	data.push_back(static_cast<uint32_t>(nameTokenType));
+	data.push_back(static_cast<uint32_t>(textTokenType));
+	data.push_back(static_cast<uint32_t>(valueTokenType));
+	data.push_back(static_cast<uint32_t>(textNumberType));
+	data.push_back(static_cast<uint32_t>(valueNumberType));
+
+	data.push_back(elementPrefix.idPrefix);
+	data.push_back(elementPrefix.idNamespace);
+	data.push_back(attributePrefix.idPrefix);
+	data.push_back(attributePrefix.idNamespace);
+	data.push_back(memberPrefix == &elementPrefix);
+	data.push_back(isPrefixInherited);
+
+	// Pointers are stored as indices and offsets.
+
+	data.push_back(nameCharNum);
+	data.push_back(nameStartCharNum);
+	data.push_back(patternNum);
+	data.push_back(trie == &Namespace :: attributeTrie);
+
+	data.push_back(static_cast<uint32_t>(trieKind));
+	data.push_back(idNamespace);
+	data.push_back(ptrOffset);
+	data.push_back(foundOffset);
+	data.push_back(cursorLen);
+
+	// Prefix bindings are stored as namespace IDs.
+	for(uint32_t num = 0; num < namespacePrefixTblSize; ++num) {
+		data.push_back(config.namespacePrefixTbl[num].first);
+	}
+
+	data.push_back(prefixStack.size());
+
+	for(const PrefixDefinition &item : prefixStack) {
+		data.push_back(item.idPrefix);
+		data.push_back(item.idNamespace);
+	}
+
+	data.push_back(elementStack.size());
+
+	// Content model states are stored plus one, so unvalidated becomes 0.
+	data.push_back(documentState + 1);
+
+	for(const Element &item : elementStack) {
+		data.push_back(item.prefixStackOffset);
+		data.push_back(item.crc32);
+		data.push_back(item.state + 1);
+	}
+
+	uint32_t byteLen = data.size() * 4;
+
+	if(buffer.length() >= byteLen) memcpy(buffer.data(), data.data(), byteLen);
+
+	return(byteLen);
+}
+
+bool Parser :: restore(nbind::Buffer buffer) {
+	SnapshotReader reader(buffer.data(), buffer.length());
+	unsigned char *const charTblList[] = { xmlNameCharTbl, xmlNameStartCharTbl, dtdNameCharTbl };
+	const uint32_t namespaceCount = config.namespaceList.size();
+	uint32_t prefixTbl[namespacePrefixTblSize];
+	std::vector<PrefixDefinition> prefixStack;
+	std::vector<Element> elementStack;
+	const Patricia *cursorTrie = nullptr;
+	const Namespace *ns;
+
+	// Undo prefix bindings before overwriting them.
+	reset();
+
+	// Interned IDs from before the snapshot are unknown to JavaScript.
+	interner.clear();
+	internNameCount = 0;
+	internValueCount = 0;
+
+	if(
+		!reader.expect(snapshotMagic) ||
+		!reader.expect(snapshotVersion) ||
+		!reader.expect(config.features)
+	) return(false);
+
+	for(State *item : {
+		&state, &matchState, &noMatchState, &partialMatchState, &afterNameState,
+		&afterTextState, &afterMatchTrieState, &nextState, &otherState, &afterValueState
+	}) *item = static_cast<State>(reader.read(stateCount));
+
+	knownName = reader.read(2);
+	tagType = static_cast<TagType>(reader.read(static_cast<uint32_t>(TagType :: PROCESSING) + 1));
+	matchTarget = static_cast<MatchTarget>(reader.read(static_cast<uint32_t>(MatchTarget :: ATTRIBUTE_NAMESPACE) + 1));
+	textEndChar = reader.read(256);
+	expected = reader.read(256);
+	pos = reader.read();
+	row = reader.read();
+	col = reader.read();
+	idToken = reader.read();
+	idPrefix = reader.read(namespacePrefixTblSize);
+	idElement = reader.read();
+	sgmlNesting = reader.read();
+	utf8Pending = reader.read(4);
+	utf8Min = reader.read(256);
+	utf8Max = reader.read(256);
+
+	nameTokenType = static_cast<TokenType>(reader.read(tokenKindCount));
+	textTokenType = static_cast<TokenType>(reader.read(tokenKindCount));
+	valueTokenType = static_cast<TokenType>(reader.read(tokenKindCount));
+	textNumberType = static_cast<NumberListType>(reader.read(static_cast<uint32_t>(NumberListType :: FLOAT64) + 1));
+	valueNumberType = static_cast<NumberListType>(reader.read(static_cast<uint32_t>(NumberListType :: FLOAT64) + 1));
+
+	elementPrefix.idPrefix = reader.read(inheritedPrefixFlag);
+	elementPrefix.idNamespace = reader.read(namespaceCount);
+	attributePrefix.idPrefix = reader.read(inheritedPrefixFlag);
+	attributePrefix.idNamespace = reader.read(namespaceCount);
+	memberPrefix = reader.read(2) ? &elementPrefix : &attributePrefix;
+	isPrefixInherited = reader.read(2);
+
+	nameCharTbl = charTblList[reader.read(3)];
+	nameStartCharTbl = charTblList[reader.read(3)];
+	pattern = snapshotPatternList[reader.read(3)];
+	trie = reader.read(2) ? &Namespace :: attributeTrie : &Namespace :: elementTrie;
+
+	if(state == State :: SKIP_RECORD || state == State :: NUMBER_LIST) reader.isValid = false;
+
+	// Only the current literal pattern may be partially matched.
+	if((state == State :: MATCH || state == State :: MATCH_SPARSE) && pos > strlen(pattern)) {
+		reader.isValid = false;
+	}
+
+	SnapshotTrie trieKind = static_cast<SnapshotTrie>(reader.read(static_cast<uint32_t>(SnapshotTrie :: COUNT)));
+	ns = config.namespaceList[reader.read(namespaceCount)].get();
+
+	switch(trieKind) {
+		case SnapshotTrie :: URI: cursorTrie = &config.uriTrie; break;
+		case SnapshotTrie :: PREFIX: cursorTrie = &config.prefixTrie; break;
+		case SnapshotTrie :: ELEMENT: if(ns) cursorTrie = &ns->elementTrie; break;
+		case SnapshotTrie :: ATTRIBUTE: if(ns) cursorTrie = &ns->attributeTrie; break;
+		default: break;
+	}
+
+	uint32_t ptrOffset = reader.read();
+	uint32_t foundOffset = reader.read();
+	uint32_t cursorLen = reader.read();
+
+	if(cursorTrie) {
+		if(!cursor.setOffsets(*cursorTrie, ptrOffset, foundOffset, cursorLen)) reader.isValid = false;
+	} else {
+		cursor = PatriciaCursor();
+		if(trieKind != SnapshotTrie :: NONE || isCursorActive()) reader.isValid = false;
+	}
+
+	for(uint32_t num = 0; num < namespacePrefixTblSize; ++num) {
+		prefixTbl[num] = reader.read(namespaceCount);
+	}
+
+	for(uint32_t count = reader.read(); count && reader.isValid; --count) {
+		uint32_t idPrefix = reader.read(namespacePrefixTblSize);
+		prefixStack.emplace_back(idPrefix, reader.read(namespaceCount));
+	}
+
+	size_t prefixStackOffset = 0;
+	const uint32_t modelStateCount = contentModel ? contentModel->getStateCount() : 0;
+	uint32_t documentState = reader.read(modelStateCount + 1) - 1;
+
+	for(uint32_t count = reader.read(); count && reader.isValid; --count) {
+		// Elements must restore prefix bindings in stack order.
+		prefixStackOffset = reader.read(prefixStack.size() + 1);
+		if(!elementStack.empty() && prefixStackOffset < elementStack.back().prefixStackOffset) {
+			reader.isValid = false;
+		}
+
+		uint32_t crc32 = reader.read();
+		elementStack.emplace_back(prefixStackOffset, crc32, reader.read(modelStateCount + 1) - 1);
+	}
+
+	if(!reader.isValid) {
+		reset();
+		cursor = PatriciaCursor();
+		return(false);
+	}
+
+	for(uint32_t num = 0; num < namespacePrefixTblSize; ++num) {
+		config.namespacePrefixTbl[num] = std::make_pair(
+			prefixTbl[num],
+			config.namespaceList[prefixTbl[num]].get()
+		);
+	}
+
+	this->prefixStack.swap(prefixStack);
+	this->elementStack.swap(elementStack);
+	this->documentState = documentState;
+
+	return(true);
 }
 
 /** Branchless cursor position update based on UTF-8 input byte. Assumes
@@ -48,46 +474,617 @@ inline void Parser :: updateRowCol(unsigned char c) {
 	row += (c == '\n');
 }
 
+/** Check the next byte of a UTF-8 sequence against Unicode Table 3-7
+  * (rejecting overlong forms, surrogates and codepoints over U+10FFFF). */
+inline bool Parser :: validateUtf8Byte(unsigned char c) {
+	if(!utf8Pending) {
+		// Lead byte.
+		if(c < 0xc2 || c > 0xf4) return(false);
+
+		utf8Pending = 1 + (c >= 0xe0) + (c >= 0xf0);
+		utf8Min = (c == 0xe0) ? 0xa0 : (c == 0xf0) ? 0x90 : 0x80;
+		utf8Max = (c == 0xed) ? 0x9f : (c == 0xf4) ? 0x8f : 0xbf;
+
+		return(true);
+	}
+
+	// Continuation byte.
+	if(c < utf8Min || c > utf8Max) return(false);
+
+	--utf8Pending;
+	utf8Min = 0x80;
+	utf8Max = 0xbf;
+
+	return(true);
+}
+
+inline const unsigned char *Parser :: validateUtf8Span(const unsigned char *p, const unsigned char *end) {
+	uint64_t word;
+
+	while(p < end) {
+		if(!utf8Pending && end - p >= 8) {
+			std::memcpy(&word, p, 8);
+
+			if(!(word & 0x8080808080808080ULL)) {
+				p += 8;
+				continue;
+			}
+		}
+
+		if((*p >= 0x80 || utf8Pending) && !validateUtf8Byte(*p)) return(p);
+		++p;
+	}
+
+	return(end);
+}
+
+inline bool Parser :: validateSkipped(const unsigned char *&p, size_t skipLen) {
+	const unsigned char *end = p - 1 + skipLen;
+	const unsigned char *invalid = validateUtf8Span(p - 1, end);
+
+	if(invalid == end) return(true);
+
+	p = invalid + 1;
+	return(false);
+}
+
+template <bool trackPosition, bool validateUtf8>
+inline bool Parser :: consumeChar(unsigned char c) {
+	// ASCII outside multibyte sequences needs only this one test.
+	if(validateUtf8 && (c >= 0x80 || utf8Pending) && !validateUtf8Byte(c)) {
+		return(false);
+	}
+
+	if(trackPosition) updateRowCol(c);
+
+#if PARSER_STATS
+	++stats.stateBytes[static_cast<uint32_t>(state)];
+
+	if(state != stats.prevState) {
+		++stats.stateTransitions;
+		stats.prevState = state;
+	}
+#endif
+
+	return(true);
+}
+
+template <bool namespaces, bool dtd>
+inline bool Parser :: isNameChar(unsigned char c) {
+	// Without namespaces, colons are just part of a name.
+	return((dtd ? nameCharTbl : xmlNameCharTbl)[c] || (!namespaces && c == ':'));
+}
+
+template <bool namespaces, bool dtd>
+inline bool Parser :: isNameStartChar(unsigned char c) {
+	return((dtd ? nameStartCharTbl : xmlNameStartCharTbl)[c] || (!namespaces && c == ':'));
+}
+
+std::vector<double> Parser :: getStats() {
+	std::vector<double> result;
+
+#if PARSER_STATS
+	const double *data = reinterpret_cast<const double *>(&stats);
+
+	result.push_back(stateCount);
+	result.push_back(tokenKindCount);
+	result.push_back(static_cast<uint32_t>(FlushCause :: COUNT));
+	result.push_back(static_cast<uint32_t>(TrieKind :: COUNT));
+
+	result.insert(result.end(), data, data + offsetof(Stats, prevState) / sizeof(double));
+#endif
+
+	return(result);
+}
+
+void Parser :: resetStats() {
+#if PARSER_STATS
+	memset(&stats, 0, sizeof(stats));
+	stats.prevState = state;
+#endif
+}
+
 Parser :: ErrorType Parser :: destroy() {
-	uint32_t *tokenPtr = tokenList + 1;
+	uint32_t *tokenPtr;
+	ErrorType status = ErrorType :: OK;
+
+	clearTokens(tokenPtr);
 
-	tokenList[0] = 0;
+	// Input must not end in the middle of a UTF-8 sequence.
+	if(utf8Pending) status = ErrorType :: INVALID_UTF8;
+	else if(inflater.isTruncated()) status = ErrorType :: INVALID_COMPRESSED_DATA;
 
-	switch(state) {
+	if(status == ErrorType :: OK) switch(state) {
 
 		case State :: TEXT:
 
 			writeToken(static_cast<TokenType>(static_cast<uint32_t>(textTokenType) + 1), 0, tokenPtr);
 			break;
 
+		case State :: NUMBER_LIST:
+
+			if(!endNumberList(tokenPtr)) status = ErrorType :: INVALID_CHAR;
+			break;
+
 		default:
 
 			break;
 
 	}
 
+	// Release the flush callback also after errors.
+	commitTokens();
 	flushTokens.reset();
 
-	return(ErrorType :: OK);
+	return(status);
 }
 
-/** Parse a chunk of incoming data.
-  * For security from buffer overflow attacks, memory writes are only done in
-  * writeToken which should be foolproof. */
-
 Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
-	size_t len = chunk.length();
-	size_t ahead;
+	if(isPullMode) {
+		pullChunk = chunk;
+		isSuspended = false;
+
+		return(parsePulled(0, chunk.length()));
+	}
+
+	// Indicate that no tokens inside the chunk were found yet.
+	uint32_t *tokenPtr;
+	clearTokens(tokenPtr);
+
+	PARSER_PROBE2(parse__start, this, chunk.length());
+
+	ErrorType status = parseRange(chunk.data(), 0, chunk.length(), tokenPtr);
+	commitTokens();
+
+	PARSER_PROBE3(parse__done, this, chunk.length(), static_cast<int32_t>(status));
+
+	return(status);
+}
+
+Parser :: ErrorType Parser :: resume() {
+	if(!isSuspended) return(ErrorType :: OK);
+
+	if(isNamespaceStale) {
+		// JavaScript has now bound any prefix to the unknown URI.
+		elementPrefix.idNamespace = config.namespacePrefixTbl[elementPrefix.idPrefix].first;
+		isNamespaceStale = false;
+	}
+
+	return(parsePulled(pullOffset, pullLen));
+}
+
+Parser :: ErrorType Parser :: parsePulled(size_t offset, size_t len) {
+	uint32_t *tokenPtr;
+	clearTokens(tokenPtr);
+
+	// Leave room for tokens written before checking the limit again.
+	// With a tiny buffer, flushTokens is still called when it fills up,
+	// so ParserPool refuses those.
+	tokenSuspendPtr = (
+		static_cast<size_t>(tokenBufferEnd - tokenList) > pullReserve + 1 ?
+		tokenBufferEnd - pullReserve : tokenBufferEnd
+	);
+	isPulling = true;
+
+	PARSER_PROBE2(parse__start, this, len);
+
+	ErrorType status = parseRange(pullChunk.data(), offset, len, tokenPtr);
+
+	tokenSuspendPtr = tokenBufferEnd;
+	isPulling = false;
+	commitTokens();
+
+	PARSER_PROBE3(parse__done, this, len, static_cast<int32_t>(status));
+
+	return(status);
+}
+
+Parser :: ErrorType Parser :: parseBatch(nbind::Buffer chunk, nbind::Buffer ends) {
 	const unsigned char *chunkBuffer = chunk.data();
-	const unsigned char *p = chunkBuffer;
+	const uint32_t *endList = reinterpret_cast<const uint32_t *>(ends.data());
+	size_t count = ends.length() / 4;
+	size_t len = chunk.length();
+	size_t start = 0;
+	size_t end;
+	ErrorType status;
+	ErrorType batchStatus = ErrorType :: OK;
+	// Largest value fitting in a token.
+	const uint32_t maxValue = (1U << (32 - TOKEN_SHIFT)) - 1;
+
+	// Offsets inside the batch must fit in tokens.
+	if(len > maxValue) return(ErrorType :: OTHER);
+
+	uint32_t *tokenPtr;
+	clearTokens(tokenPtr);
+
+	PARSER_PROBE2(parse__start, this, len);
+
+	for(size_t num = 0; num < count; ++num) {
+		end = endList[num];
+
+		if(end < start || end > len) {
+			// Documents before the invalid offset are still reported.
+			batchStatus = ErrorType :: OTHER;
+			break;
+		}
+
+		reset();
+		status = parseRange(chunkBuffer, start, end - start, tokenPtr);
+		if(status == ErrorType :: OK && utf8Pending) status = ErrorType :: INVALID_UTF8;
+
+		if(status == ErrorType :: OK && state == State :: TEXT) {
+			writeToken(
+				static_cast<TokenType>(static_cast<uint32_t>(textTokenType) + 1),
+				end,
+				tokenPtr
+			);
+		}
+
+		if(status == ErrorType :: OK && state == State :: NUMBER_LIST && !endNumberList(tokenPtr)) {
+			status = ErrorType :: INVALID_CHAR;
+		}
+
+		if(status != ErrorType :: OK) {
+			// Position of the error, tracked with TRACK_POSITION.
+			writeToken(TokenType :: DOCUMENT_ERROR_ROW, std::min(row, maxValue), tokenPtr);
+			writeToken(TokenType :: DOCUMENT_ERROR_COL, std::min(col, maxValue), tokenPtr);
+		}
+
+		writeToken(TokenType :: DOCUMENT_END, static_cast<uint32_t>(status), tokenPtr);
+		start = end;
+	}
+
+	reset();
+	commitTokens();
+
+	PARSER_PROBE3(parse__done, this, len, static_cast<int32_t>(batchStatus));
+
+	return(batchStatus);
+}
+
+Parser :: ErrorType Parser :: parseCompressed(nbind::Buffer compressed, nbind::Buffer window) {
+	unsigned char *windowBuffer = window.data();
+	size_t windowLen = window.length();
+	size_t len;
+	Inflater :: Status inflateStatus;
+	ErrorType status = ErrorType :: OK;
+
+	// Offsets inside the window must fit in tokens.
+	if(!windowLen || windowLen >= (1U << (32 - TOKEN_SHIFT))) return(ErrorType :: OTHER);
+
+	uint32_t *tokenPtr;
+	clearTokens(tokenPtr);
+
+	if(!inflater.setInput(compressed.data(), compressed.length())) {
+		return(ErrorType :: OTHER);
+	}
+
+	PARSER_PROBE2(parse__start, this, compressed.length());
+
+	do {
+		inflateStatus = inflater.inflate(windowBuffer, windowLen, len);
+		if(inflateStatus == Inflater :: Status :: ERROR) {
+			status = ErrorType :: INVALID_COMPRESSED_DATA;
+			break;
+		}
+
+#		ifdef __EMSCRIPTEN__
+			// JavaScript reads strings from its own copy of the window.
+			if(len) window.commit();
+#		endif
+
+		if(len) {
+			status = parseRange(windowBuffer, 0, len, tokenPtr);
+			if(status != ErrorType :: OK) break;
+
+			// Let JavaScript code read strings from the window
+			// before overwriting it.
+			writeToken(TokenType :: CHUNK_END, len, tokenPtr);
+			flush(tokenPtr, FlushCause :: INPUT_WINDOW);
+		}
+	} while(inflateStatus == Inflater :: Status :: OK);
+
+	commitTokens();
+
+	PARSER_PROBE3(parse__done, this, compressed.length(), static_cast<int32_t>(status));
+
+	return(status);
+}
+
+void Parser :: setInterning(uint32_t nameLimit, uint32_t valueLimit, uint32_t valueMaxLen) {
+	// IDs must fit in tokens.
+	const uint32_t maxLimit = 1U << (32 - TOKEN_SHIFT - 1);
+
+	internNameLimit = nameLimit < maxLimit ? nameLimit : maxLimit;
+	internValueLimit = valueLimit < maxLimit ? valueLimit : maxLimit;
+	internValueMaxLen = valueMaxLen;
+}
+
+void Parser :: setEntityExpansion(nbind::Buffer buffer, uint32_t maxDepth) {
+	// Offsets in the buffer must fit in tokens.
+	size_t len = std::min(buffer.length(), static_cast<size_t>(1U << (32 - TOKEN_SHIFT)) - 1);
+
+	entityBuffer = buffer;
+	entityTbl.setLimits(maxDepth, len);
+	isEntityExpansion = len != 0;
+}
+
+void Parser :: setNumberBuffer(nbind::Buffer buffer) {
+	// Offsets in the buffer must fit in tokens, and lists start 8-byte aligned.
+	size_t len = std::min(buffer.length(), static_cast<size_t>(1U << (32 - TOKEN_SHIFT)) - 1);
+
+	numberBuffer = buffer;
+	numberBufferLen = len & ~static_cast<size_t>(7);
+	numberPos = 0;
+	numberStart = 0;
+	isNumberListEnabled = numberBufferLen != 0;
+
+	if(!isNumberListEnabled) {
+		textNumberType = NumberListType :: NONE;
+		valueNumberType = NumberListType :: NONE;
+	}
+}
+
+inline bool Parser :: reserveNumber(uint32_t *&tokenPtr) {
+	size_t size = numberType == NumberListType :: INT32 ? sizeof(int32_t) : sizeof(double);
+
+	if(numberPos + size <= numberBufferLen) return(true);
+
+	writeNumberOffset(TokenType :: NUMBER_LIST_PART_OFFSET, tokenPtr);
+
+	// JavaScript copies the part out, so nothing moves when clearing.
+	numberStart = numberPos;
+	flushNow(tokenPtr, FlushCause :: NUMBER_BUFFER);
+
+	return(!isPulling);
+}
+
+inline void Parser :: appendNumberText(const unsigned char *p, size_t len) {
+	// Longer numbers are invalid anyway, so keep only enough to tell.
+	size_t room = NumberParser :: maxFallbackLen + 1 - numberText.size();
+
+	numberText.append(reinterpret_cast<const char *>(p), std::min(len, room));
+}
+
+inline bool Parser :: storeNumber(const unsigned char *p, size_t len) {
+	unsigned char *dest = numberBuffer.data() + numberPos;
+
+	if(!numberText.empty()) {
+		if(len) appendNumberText(p, len);
+		p = reinterpret_cast<const unsigned char *>(numberText.data());
+		len = numberText.size();
+	}
+
+	bool isValid;
+
+	if(numberType == NumberListType :: INT32) {
+		int32_t number;
+		isValid = NumberParser :: parseInt32(p, len, number);
+		if(!isValid) number = 0;
+
+		memcpy(dest, &number, sizeof(number));
+		numberPos += sizeof(number);
+	} else {
+		double number;
+		isValid = NumberParser :: parseFloat64(p, len, number);
+		if(!isValid) number = std::numeric_limits<double>::quiet_NaN();
+
+		memcpy(dest, &number, sizeof(number));
+		numberPos += sizeof(number);
+	}
+
+	bool hasNonsense = false;
+
+	if(!isValid) {
+		// Invalid numbers are stored as NaN or 0, but nonsense bytes
+		// are still disallowed like in other text.
+		while(len--) {
+			unsigned char c = *p++;
+			if(c < ' ' || c == 0x7f || c > 0xf7) hasNonsense = true;
+		}
+	}
+
+	numberText.clear();
+	return(!hasNonsense);
+}
+
+inline bool Parser :: endNumberList(uint32_t *&tokenPtr) {
+	bool isValid = true;
+
+	if(!numberText.empty()) {
+		// Not pulling here, so a full number buffer is flushed at once.
+		reserveNumber(tokenPtr);
+		isValid = storeNumber(nullptr, 0);
+	}
+
+	writeNumberOffset(TokenType :: NUMBER_LIST_END_OFFSET, tokenPtr);
+	numberType = NumberListType :: NONE;
+
+	return(isValid);
+}
+
+inline void Parser :: addEntityDeclaration(const unsigned char *end) {
+	const unsigned char *start = declStart ? declStart : rangeStart;
+
+	if(declBuffer.empty()) {
+		entityTbl.addDeclaration(start, end - start);
+	} else {
+		declBuffer.append(start, end);
+		entityTbl.addDeclaration(
+			reinterpret_cast<const unsigned char *>(declBuffer.data()),
+			declBuffer.size()
+		);
+		declBuffer.clear();
+	}
+
+	isEntityDeclaration = false;
+}
+
+inline bool Parser :: writeExpansion(const unsigned char *end, uint32_t *&tokenPtr) {
+	const unsigned char *start = spanStart ? spanStart : rangeStart;
+	EntityTable :: Status status;
+
+	hasEntityRef = false;
+
+	if(textBuffer.empty()) {
+		status = entityTbl.expand(start, end - start, entityBuffer.data(), entityPos);
+	} else {
+		textBuffer.append(start, end);
+		status = entityTbl.expand(
+			reinterpret_cast<const unsigned char *>(textBuffer.data()),
+			textBuffer.size(),
+			entityBuffer.data(),
+			entityPos
+		);
+		textBuffer.clear();
+	}
+
+	if(status == EntityTable :: Status :: LIMIT) return(false);
+
+	if(status == EntityTable :: Status :: EXPANDED) {
+		writeToken(TokenType :: EXPANDED_END_OFFSET, entityPos, tokenPtr);
+	}
+
+	return(true);
+}
+
+inline void Parser :: writeInternable(
+	TokenType endTokenType,
+	TokenType internedTokenType,
+	bool isValue,
+	const unsigned char *chunkBuffer,
+	const unsigned char *end,
+	uint32_t *&tokenPtr
+) {
+	const uint32_t limit = isValue ? internValueLimit : internNameLimit;
+	uint32_t &count = isValue ? internValueCount : internNameCount;
+
+	// Strings continuing from a previous chunk are not interned.
+	if(limit && spanStart && !(isValue && static_cast<size_t>(end - spanStart) > internValueMaxLen)) {
+		bool isNew;
+		uint32_t id = interner.find(
+			static_cast<uint32_t>(internedTokenType),
+			spanStart,
+			end - spanStart,
+			count < limit,
+			isNew
+		);
+
+		if(id != Interner :: notFound) {
+			if(!isNew) {
+				writeToken(internedTokenType, id, tokenPtr);
+				return;
+			}
+
+			++count;
+			writeToken(endTokenType, end - chunkBuffer, tokenPtr);
+			writeToken(TokenType :: INTERN_ID, id, tokenPtr);
+			return;
+		}
+	}
+
+	writeToken(endTokenType, end - chunkBuffer, tokenPtr);
+}
+
+Parser :: ErrorType Parser :: parseRange(
+	const unsigned char *chunkBuffer,
+	size_t offset,
+	size_t len,
+	uint32_t *&tokenPtr
+) {
+	typedef ErrorType (Parser :: *ParseFunction)(
+		const unsigned char *chunkBuffer,
+		size_t offset,
+		size_t len,
+		uint32_t *&tokenPtr
+	);
+
+	// Parsers specialized for every combination of features.
+	static const ParseFunction parseTbl[] = {
+		&Parser :: parseSpecialized<0>,  &Parser :: parseSpecialized<1>,
+		&Parser :: parseSpecialized<2>,  &Parser :: parseSpecialized<3>,
+		&Parser :: parseSpecialized<4>,  &Parser :: parseSpecialized<5>,
+		&Parser :: parseSpecialized<6>,  &Parser :: parseSpecialized<7>,
+		&Parser :: parseSpecialized<8>,  &Parser :: parseSpecialized<9>,
+		&Parser :: parseSpecialized<10>, &Parser :: parseSpecialized<11>,
+		&Parser :: parseSpecialized<12>, &Parser :: parseSpecialized<13>,
+		&Parser :: parseSpecialized<14>, &Parser :: parseSpecialized<15>
+	};
+
+	static_assert(
+		sizeof(parseTbl) / sizeof(*parseTbl) == static_cast<uint32_t>(ParserConfig :: Feature :: ALL) + 1,
+		"Parse function table must cover every combination of features"
+	);
+
+	const uint32_t features = config.features & static_cast<uint32_t>(ParserConfig :: Feature :: ALL);
+
+	// A suspended range continues from its original start.
+	if(!isSuspended) rangeStart = chunkBuffer + offset;
+
+	ErrorType status = (this->*parseTbl[features])(chunkBuffer, offset, len, tokenPtr);
+
+	if(status != ErrorType :: OK && status != ErrorType :: BUFFER_FULL) {
+		// Row and column are only tracked with TRACK_POSITION.
+		PARSER_PROBE4(error, this, static_cast<int32_t>(status), row, col);
+	}
+
+	if(status == ErrorType :: OK && isEntityExpansion) {
+		const unsigned char *rangeEnd = chunkBuffer + offset + len;
+
+		// Store parts of declarations and text continuing in the next chunk.
+		if(isEntityDeclaration) {
+			declBuffer.append(declStart ? declStart : rangeStart, rangeEnd);
+			declStart = nullptr;
+		} else if(
+			state == State :: TEXT &&
+			textTokenType != TokenType :: SGML_TEXT_START_OFFSET &&
+			!entityTbl.empty()
+		) {
+			textBuffer.append(spanStart ? spanStart : rangeStart, rangeEnd);
+		}
+	}
+
+	return(status);
+}
+
+/** Parse a chunk of incoming data.
+  * For security from buffer overflow attacks, tokens are only written in
+  * writeToken which should be foolproof. See its comment for other writes.
+  * Template arguments allow compiling out support for unused features. */
+
+template <uint32_t features>
+Parser :: ErrorType Parser :: parseSpecialized(
+	const unsigned char *chunkBuffer,
+	size_t offset,
+	size_t len,
+	uint32_t *&tokenPtr
+) {
+	typedef ParserConfig :: Feature Feature;
+
+	constexpr bool trackPosition = ParserConfig :: hasFeature(features, Feature :: TRACK_POSITION);
+	constexpr bool namespaces = ParserConfig :: hasFeature(features, Feature :: NAMESPACES);
+	constexpr bool dtd = ParserConfig :: hasFeature(features, Feature :: DTD);
+	constexpr bool validateUtf8 = ParserConfig :: hasFeature(features, Feature :: VALIDATE_UTF8);
+	// Text can be skipped in bulk if consuming bytes has no side effects
+	// other than UTF-8 validation, which then checks the skipped bytes.
+	constexpr bool skipText = !trackPosition && !PARSER_STATS;
+
+	size_t ahead = 0;
+	const unsigned char *p = chunkBuffer + offset;
 	unsigned char c, d = 0;
 	const Namespace *ns;
+	ErrorType status;
 
-	// Indicate that no tokens inside the chunk were found yet.
-	tokenList[0] = 0;
-	uint32_t *tokenPtr = tokenList + 1;
+	if(!len) return(ErrorType :: OK);
 
-	tokenStart = p;
+	if(isSuspended) {
+		// Names and values in progress continue in the same chunk.
+		isSuspended = false;
+	} else {
+		tokenStart = p;
+		spanStart = nullptr;
+		attributeStart = nullptr;
+	}
 
 	// Read a byte of input.
 	c = *p++;
@@ -103,8 +1100,40 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 
 		Some duplicated states are avoided using the after<Name>State variables,
 		which allow execution to jump to a common state and back again.
+
+		With PARSER_DIRECT_THREADING, PARSER_BREAK and PARSER_CONTINUE jump
+		straight to the label of the next state through a table, and the loop
+		and switch are only used for entering the first state.
 	*/
 
+#if PARSER_DIRECT_THREADING
+	// Labels in the same order as the State enum.
+	static void *const stateLabelTbl[] = {
+		&&OTHER_STATE,
+		&&MATCH_SPARSE, &&MATCH_SPARSE, &&QUOTE,
+		&&BEFORE_TEXT, &&TEXT, &&NUMBER_LIST,
+		&&BEFORE_CDATA, &&CDATA,
+		&&AFTER_LT,
+		&&BEFORE_NAME, &&MATCH_TRIE, &&NAME, &&UNKNOWN_NAME,
+		&&STORE_ELEMENT_NAME, &&AFTER_ELEMENT_NAME,
+		&&AFTER_CLOSE_ELEMENT_NAME,
+		&&OTHER_STATE, &&AFTER_ATTRIBUTE_VALUE,
+		&&DEFINE_XMLNS_BEFORE_PREFIX_NAME, &&DEFINE_XMLNS_AFTER_PREFIX_NAME,
+		&&BEFORE_VALUE, &&VALUE, &&UNKNOWN_VALUE, &&DEFINE_XMLNS_AFTER_URI,
+		&&BEFORE_SGML, &&SGML_DECLARATION,
+		&&AFTER_PROCESSING_NAME, &&AFTER_PROCESSING_VALUE,
+		&&BEFORE_COMMENT, &&COMMENT,
+		&&SKIP_RECORD,
+		&&EXPECT,
+		&&PARSE_ERROR
+	};
+
+	static_assert(
+		sizeof(stateLabelTbl) / sizeof(*stateLabelTbl) == stateCount,
+		"Jump table must have a label for every state"
+	);
+#endif
+
 	while(1) {
 		switch(state) {
 
@@ -118,39 +1147,39 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 				if(!d) {
 					state = matchState;
 					pos = 0;
-					continue;
+					PARSER_CONTINUE;
 				} else if(c == d) {
 					++pos;
-					break;
+					PARSER_BREAK;
 				} else if(state == State :: MATCH_SPARSE && whiteCharTbl[c]) {
-					break;
+					PARSER_BREAK;
 				} else {
 					state = pos ? partialMatchState : noMatchState;
 					pos = 0;
-					continue;
+					PARSER_CONTINUE;
 				}
 
-			case State :: QUOTE:
+			case State :: QUOTE: PARSER_LABEL(QUOTE)
 
 				if(d == '"' && c == '\'') {
 					textEndChar = '\'';
 					state = matchState;
-					break;
+					PARSER_BREAK;
 				} else {
 					state = noMatchState;
-					continue;
+					PARSER_CONTINUE;
 				}
 
 			// State at the beginning of input after a possible UTF-8 BOM,
 			// or after any closing tag.
 			// Skip whitespace and then read text up to an opening tag.
-			case State :: BEFORE_TEXT:
+			case State :: BEFORE_TEXT: PARSER_LABEL(BEFORE_TEXT)
 
-				if(whiteCharTbl[c]) break;
+				if(whiteCharTbl[c]) PARSER_BREAK;
 
 				if(c == '<') {
 					state = State :: AFTER_LT;
-					break;
+					PARSER_BREAK;
 				}
 
 				textEndChar = '<';
@@ -163,21 +1192,54 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 
 			// Read text, which can be an attribute value or a text node,
 			// until textEndChar (defined by a preceding state) is found.
-			// TODO: Detect and handle numbers in a special way for speed?
 			case State :: TEXT: TEXT:
 
+				if(
+					textTokenType == TokenType :: TEXT_START_OFFSET ?
+					textNumberType != NumberListType :: NONE : (
+						textTokenType == TokenType :: VALUE_START_OFFSET &&
+						valueNumberType != NumberListType :: NONE
+					)
+				) {
+					// Flush first, so the list starts in the same code buffer
+					// as its numbers. When pulling, resume here instead.
+					if(tokenPtr >= tokenBufferEnd) {
+						if(isPulling) goto SUSPEND;
+						flush(tokenPtr, FlushCause :: BUFFER_FULL);
+					}
+
+					numberType = textTokenType == TokenType :: TEXT_START_OFFSET ? textNumberType : valueNumberType;
+					numberPos = (numberPos + 7) & ~static_cast<size_t>(7);
+					numberStart = numberPos;
+					writeToken(TokenType :: NUMBER_LIST_START, static_cast<uint32_t>(numberType), tokenPtr);
+
+					state = State :: NUMBER_LIST;
+					goto NUMBER_LIST;
+				}
+
 				writeToken(textTokenType, p - chunkBuffer - 1, tokenPtr);
+				spanStart = p - 1;
 
 				// Fast inner loop for capturing text between elements
 				// and in attribute values.
 				while(1) {
+					if(skipText && valueCharTbl[c]) {
+						// Move to the last byte before any special byte,
+						// scanning many at a time with SIMD instructions.
+						size_t skipLen = valueSpecial.skip(p, len - 1);
+						if(validateUtf8 && !validateSkipped(p, skipLen)) goto INVALID_UTF8;
+						p += skipLen;
+						len -= skipLen;
+						c = p[-1];
+					}
+
 					if(!valueCharTbl[c]) {
 						if(c == textEndChar) break;
 
 						switch(c) {
 							case '&':
 
-								// TODO: handle entities here?
+								if(dtd) hasEntityRef = true;
 								break;
 
 							case '"':
@@ -190,7 +1252,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 
 							case ']':
 
-								if(sgmlNesting) {
+								if(dtd && sgmlNesting) {
 									// Signal end of DTD embedded in DOCTYPE.
 									writeToken(TokenType :: SGML_NESTED_END, 0, tokenPtr);
 									--sgmlNesting;
@@ -208,23 +1270,118 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 						}
 					}
 
-					updateRowCol(c);
-					if(!--len) return(ErrorType :: OK);
+					if(!consumeChar<trackPosition, validateUtf8>(c)) goto INVALID_UTF8;
+					if(!--len) {
+						// Span continues in the next chunk.
+						if(isSpanFlagsEnabled) spanFlags.scan(spanStart, p);
+						return(ErrorType :: OK);
+					}
 					c = *p++;
 				}
 
-				writeToken(
-					// End token ID is always one higher than the corresponding
-					// start token ID.
-					static_cast<TokenType>(static_cast<uint32_t>(textTokenType) + 1),
-					p - chunkBuffer - 1,
-					tokenPtr
-				);
+				// Flags precede the end offset, so JavaScript can use them
+				// while decoding the string.
+				if(isSpanFlagsEnabled) {
+					spanFlags.scan(spanStart, p - 1);
+					if(spanFlags.get()) writeToken(TokenType :: SPAN_FLAGS, spanFlags.get(), tokenPtr);
+					spanFlags.clear();
+				}
+
+				if(textTokenType == TokenType :: VALUE_START_OFFSET) {
+					writeInternable(
+						TokenType :: VALUE_END_OFFSET,
+						TokenType :: INTERNED_VALUE_ID,
+						true,
+						chunkBuffer,
+						p - 1,
+						tokenPtr
+					);
+				} else {
+					writeToken(
+						// End token ID is always one higher than the corresponding
+						// start token ID.
+						static_cast<TokenType>(static_cast<uint32_t>(textTokenType) + 1),
+						p - chunkBuffer - 1,
+						tokenPtr
+					);
+				}
+
+				if(dtd && isEntityExpansion) {
+					// Replace entity references in the text just emitted.
+					if(
+						hasEntityRef && !entityTbl.empty() &&
+						textTokenType != TokenType :: SGML_TEXT_START_OFFSET &&
+						!writeExpansion(p - 1, tokenPtr)
+					) return(ErrorType :: ENTITY_LIMIT);
+
+					hasEntityRef = false;
+					textBuffer.clear();
+				}
 
 				state = afterTextState;
-				break;
+				PARSER_BREAK;
+
+			// Decode whitespace separated numbers up to textEndChar into the
+			// number buffer. A number split between chunks is kept in
+			// numberText.
+			case State :: NUMBER_LIST: NUMBER_LIST:
+
+				while(1) {
+					if(whiteCharTbl[c] || c == textEndChar) {
+						if(!numberText.empty()) {
+							// Store a number continuing from a previous chunk.
+							if(!reserveNumber(tokenPtr)) goto SUSPEND;
+							if(!storeNumber(p - 1, 0)) return(ErrorType :: INVALID_CHAR);
+						}
+
+						if(c == textEndChar) break;
+
+						if(!consumeChar<trackPosition, validateUtf8>(c)) goto INVALID_UTF8;
+						if(!--len) return(ErrorType :: OK);
+						c = *p++;
+						continue;
+					}
+
+					// Suspend before consuming any part of the number.
+					if(!reserveNumber(tokenPtr)) goto SUSPEND;
+
+					const unsigned char *numberPtr = p - 1;
+
+					// Move to the last byte of the number, scanning many
+					// at a time with SIMD instructions.
+					if(skipText) {
+						size_t skipLen = numberEnd.skip(p, len - 1);
+						if(validateUtf8 && !validateSkipped(p, skipLen)) goto INVALID_UTF8;
+						p += skipLen;
+						len -= skipLen;
+						c = p[-1];
+					} else {
+						while(len > 1 && !numberEnd.has(*p)) {
+							if(!consumeChar<trackPosition, validateUtf8>(c)) goto INVALID_UTF8;
+							--len;
+							c = *p++;
+						}
+					}
 
-			case State :: BEFORE_CDATA:
+					if(!consumeChar<trackPosition, validateUtf8>(c)) goto INVALID_UTF8;
+
+					if(!--len) {
+						// Number may continue in the next chunk.
+						appendNumberText(numberPtr, p - numberPtr);
+						return(ErrorType :: OK);
+					}
+
+					if(!storeNumber(numberPtr, p - numberPtr)) return(ErrorType :: INVALID_CHAR);
+					c = *p++;
+				}
+
+				writeNumberOffset(TokenType :: NUMBER_LIST_END_OFFSET, tokenPtr);
+				numberType = NumberListType :: NONE;
+
+				state = afterTextState;
+				PARSER_BREAK;
+
+			case State :: BEFORE_CDATA: PARSER_LABEL(BEFORE_CDATA)
 
 				writeToken(textTokenType, p - chunkBuffer - 1, tokenPtr);
 				state = State :: CDATA;
@@ -242,7 +1399,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 						pos = 0;
 					}
 
-					updateRowCol(c);
+					if(!consumeChar<trackPosition, validateUtf8>(c)) goto INVALID_UTF8;
 					if(!--len) return(ErrorType :: OK);
 					c = *p++;
 				}
@@ -257,11 +1414,11 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 
 				pos = 0;
 				state = afterTextState;
-				break;
+				PARSER_BREAK;
 
 			// The previous character was a '<' starting a tag. The current
 			// character determines what kind of tag.
-			case State :: AFTER_LT:
+			case State :: AFTER_LT: PARSER_LABEL(AFTER_LT)
 
 				trie = &Namespace :: elementTrie;
 
@@ -312,6 +1469,18 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 
 					// An element <NAME ... >. May be self-closing.
 					default:
+
+						// Skip records without matching any names.
+						if(splitDepth && elementStack.size() == splitDepth) {
+							writeToken(TokenType :: RECORD_START_OFFSET, p - chunkBuffer - 1, tokenPtr);
+
+							recordNesting = 1;
+							skipState = SkipState :: START_TAG;
+							pos = 0;
+							state = State :: SKIP_RECORD;
+							goto SKIP_RECORD;
+						}
+
 						afterNameState = State :: STORE_ELEMENT_NAME;
 						afterValueState = State :: AFTER_ATTRIBUTE_VALUE;
 						nameTokenType = TokenType :: OPEN_ELEMENT_ID;
@@ -324,7 +1493,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 						goto BEFORE_NAME;
 				}
 
-				break;
+				PARSER_BREAK;
 
 			// Skip any whitespace before an element name. XML doesn't
 			// actually allow any, so this state could be removed for
@@ -347,7 +1516,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 
 				// The current character must be the valid first character of
 				// an element or attribute name, anything else is an error.
-				if(!nameStartCharTbl[c]) {
+				if(!isNameStartChar<namespaces, dtd>(c)) {
 					return(ErrorType :: INVALID_CHAR);
 				}
 
@@ -355,7 +1524,11 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 				// with a namespace prefix). If the entire name doesn't fit in
 				// the input buffer, we first try to parse as a qualified name.
 				// This is an optional lookup to avoid later reprocessing.
-				for(ahead = 0; ahead + 1 < len && nameCharTbl[p[ahead]]; ++ahead) {}
+				if(namespaces) {
+					for(ahead = 0; ahead + 1 < len && nameCharTbl[p[ahead]]; ++ahead) {}
+				}
+
+				if(nameTokenType == TokenType :: ATTRIBUTE_ID) attributeStart = p - 1;
 
 				if(matchTarget == MatchTarget :: ELEMENT) {
 					elementPrefix.idPrefix = config.emptyPrefixToken;
@@ -365,6 +1538,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 					// By default, attributes belong to the same namespace as their parent element.
 					attributePrefix.idPrefix = elementPrefix.idPrefix;
 					attributePrefix.idNamespace = elementPrefix.idNamespace;
+					isPrefixInherited = true;
 					ns = config.namespaceList[elementPrefix.idNamespace].get();
 					// If element namespace prefix was known but undefined,
 					// try the default namespace to allow matching the magic xmlns attribute.
@@ -372,7 +1546,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 				}
 
 				// Prepare Patricia tree cursor for parsing.
-				if(ahead + 1 >= len || p[ahead] == ':') {
+				if(namespaces && (ahead + 1 >= len || p[ahead] == ':')) {
 					// If the input ran out, assume the name contains a colon
 					// in the next input buffer chunk. If a colon is found, the
 					// name starts with a namespace prefix.
@@ -387,8 +1561,9 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 					if(ns == nullptr) {
 						// No default namespace is defined, so this element
 						// cannot be matched with anything.
-						writeToken(TokenType :: PREFIX_ID, (memberPrefix->idNamespace << 14) | memberPrefix->idPrefix, tokenPtr);
+						writePrefix(tokenPtr);
 						writeToken(TokenType :: UNKNOWN_START_OFFSET, p - 1 - chunkBuffer, tokenPtr);
+						spanStart = p - 1;
 
 						idToken = Patricia :: notFound;
 						state = State :: UNKNOWN_NAME;
@@ -408,7 +1583,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 
 				// Fast inner loop for matching to known element and attribute names.
 				while(cursor.advance(c)) {
-					updateRowCol(c);
+					if(!consumeChar<trackPosition, validateUtf8>(c)) goto INVALID_UTF8;
 					if(!--len) {
 						pos += p - tokenStart;
 						return(ErrorType :: OK);
@@ -417,18 +1592,18 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 				}
 
 				state = afterMatchTrieState;
-				continue;
+				PARSER_CONTINUE;
 
-			case State :: NAME:
+			case State :: NAME: PARSER_LABEL(NAME)
 
-				if(!nameCharTbl[c]) {
+				if(!isNameChar<namespaces, dtd>(c)) {
 					// If the whole name was matched, get associated reference.
 					idToken = cursor.getData();
 
 					// Test for an attribute "xmlns:..." defining a namespace
 					// prefix.
 
-					if(tagType == TagType :: ELEMENT && (
+					if(namespaces && tagType == TagType :: ELEMENT && (
 						(
 							matchTarget == MatchTarget :: ATTRIBUTE_NAMESPACE &&
 							idToken == config.xmlnsPrefixToken
@@ -440,7 +1615,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 						if(c == ':') {
 							pos = 0;
 							state = State :: DEFINE_XMLNS_BEFORE_PREFIX_NAME;
-							break;
+							PARSER_BREAK;
 						} else {
 							// Prepare to set the default namespace.
 							nameTokenType = TokenType :: XMLNS_ID;
@@ -450,7 +1625,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 					}
 
 					if(idToken != Patricia :: notFound) {
-						if(c == ':' && tagType == TagType :: ELEMENT) {
+						if(namespaces && c == ':' && tagType == TagType :: ELEMENT) {
 							// If matching a namespace, use it.
 							if(
 								matchTarget == MatchTarget :: ELEMENT_NAMESPACE ||
@@ -460,7 +1635,10 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 									return(ErrorType :: TOO_MANY_PREFIXES);
 								}
 
+								PARSER_STAT(++stats.trieHits[static_cast<uint32_t>(TrieKind :: PREFIX)]);
+
 								memberPrefix->idPrefix = idToken;
+								isPrefixInherited = false;
 								memberPrefix->idNamespace = config.namespacePrefixTbl[idToken].first;
 
 								if(matchTarget == MatchTarget :: ELEMENT_NAMESPACE) {
@@ -476,13 +1654,14 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 									// prefix, valid if declared with an xmlns
 									// attribute in the same element.
 
-									writeToken(TokenType :: PREFIX_ID, (memberPrefix->idNamespace << 14) | memberPrefix->idPrefix, tokenPtr);
+									writePrefix(tokenPtr);
 									writeToken(TokenType :: UNKNOWN_START_OFFSET, p - chunkBuffer, tokenPtr);
+									spanStart = p;
 
 									idToken = Patricia :: notFound;
 									pos = 0;
 									state = State :: UNKNOWN_NAME;
-									break;
+									PARSER_BREAK;
 								}
 
 								pos = 0;
@@ -490,12 +1669,12 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 								cursor.init(ns->*trie);
 
 								state = State :: MATCH_TRIE;
-								break;
+								PARSER_BREAK;
 							} else {
 								// TODO: Reintepret token up to cursor as a
 								// namespace prefix.
 							}
-							break;
+							PARSER_BREAK;
 						} else if(
 							matchTarget == MatchTarget :: ELEMENT_NAMESPACE ||
 							matchTarget == MatchTarget :: ATTRIBUTE_NAMESPACE
@@ -506,15 +1685,26 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 						}
 
 						if(nameTokenType != TokenType :: XMLNS_ID) {
-							if(!updateElementStack(nameTokenType)) return(ErrorType :: OTHER);
-							writeToken(TokenType :: PREFIX_ID, (memberPrefix->idNamespace << 14) | memberPrefix->idPrefix, tokenPtr);
+							status = updateElementStack(nameTokenType, idToken);
+							if(status != ErrorType :: OK) return(status);
+
+							if(
+								nameTokenType == TokenType :: ATTRIBUTE_ID &&
+								tagType == TagType :: ELEMENT &&
+								!attributeSet.insert(idToken, isPrefixInherited)
+							) {
+								return(ErrorType :: DUPLICATE_ATTRIBUTE);
+							}
+
+							writePrefix(tokenPtr);
 						}
 						writeToken(nameTokenType, idToken, tokenPtr);
+						PARSER_STAT(++stats.trieHits[static_cast<uint32_t>(getNameTrieKind())]);
 
 						knownName = true;
 						pos = 0;
 						state = afterNameState;
-						continue;
+						PARSER_CONTINUE;
 					} else {
 						// TODO: Verify emitting partial name works in this case.
 					}
@@ -546,13 +1736,13 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 			// Patricia trie.
 			case State :: UNKNOWN_NAME: UNKNOWN_NAME:
 
-				while(nameCharTbl[c]) {
-					updateRowCol(c);
+				while(isNameChar<namespaces, dtd>(c)) {
+					if(!consumeChar<trackPosition, validateUtf8>(c)) goto INVALID_UTF8;
 					if(!--len) return(ErrorType :: OK);
 					c = *p++;
 				}
 
-				if(c == ':' && tagType == TagType :: ELEMENT) {
+				if(namespaces && c == ':' && tagType == TagType :: ELEMENT) {
 					// Found a new, undeclared namespace prefix, valid if
 					// declared with an xmlns attribute in the same element.
 
@@ -563,40 +1753,104 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 					);
 
 					// Flush tokens to regenerate prefix trie in JavaScript.
-					flush(tokenPtr);
+					flushNow(tokenPtr, FlushCause :: UNKNOWN_PREFIX);
 
 					// Namespace is unknown so prepare to emit the name.
 					writeToken(TokenType :: UNKNOWN_START_OFFSET, p - chunkBuffer, tokenPtr);
-					break;
+					spanStart = p;
+					PARSER_BREAK;
 				}
 
 				if(nameTokenType != TokenType :: XMLNS_ID) {
-					if(!updateElementStack(nameTokenType)) return(ErrorType :: OTHER);
-					writeToken(TokenType :: PREFIX_ID, (memberPrefix->idNamespace << 14) | memberPrefix->idPrefix, tokenPtr);
+					status = updateElementStack(nameTokenType, idToken);
+					if(status != ErrorType :: OK) return(status);
+
+					// Names continuing from a previous chunk are not checked.
+					if(
+						nameTokenType == TokenType :: ATTRIBUTE_ID &&
+						tagType == TagType :: ELEMENT &&
+						attributeStart
+					) {
+						const unsigned char *name = attributeStart;
+						size_t nameLen = p - 1 - attributeStart;
+						uint32_t idNamespace = 0;
+
+						// Compare names with a bound prefix by namespace and
+						// local name, so different prefixes for the same URI
+						// still collide.
+						if(
+							namespaces &&
+							!isPrefixInherited &&
+							memberPrefix->idPrefix < namespacePrefixTblSize &&
+							config.namespacePrefixTbl[memberPrefix->idPrefix].second
+						) {
+							const unsigned char *colon = static_cast<const unsigned char *>(
+								std::memchr(name, ':', nameLen)
+							);
+
+							if(colon) {
+								idNamespace = memberPrefix->idNamespace;
+								nameLen -= colon + 1 - name;
+								name = colon + 1;
+							}
+						}
+
+						if(!attributeSet.insert(idNamespace, name, nameLen)) {
+							return(ErrorType :: DUPLICATE_ATTRIBUTE);
+						}
+					}
+
+					writePrefix(tokenPtr);
+				}
+
+				if(
+					nameTokenType == TokenType :: OPEN_ELEMENT_ID ||
+					nameTokenType == TokenType :: ATTRIBUTE_ID ||
+					// Closing tags in a known namespace define new names there.
+					(nameTokenType == TokenType :: CLOSE_ELEMENT_ID && !memberPrefix->idNamespace)
+				) {
+					writeInternable(
+						static_cast<TokenType>(
+							static_cast<uint32_t>(TokenType :: UNKNOWN_OPEN_ELEMENT_END_OFFSET) -
+							static_cast<uint32_t>(TokenType :: OPEN_ELEMENT_ID) +
+							static_cast<uint32_t>(nameTokenType)
+						),
+						static_cast<TokenType>(
+							static_cast<uint32_t>(TokenType :: INTERNED_OPEN_ELEMENT_ID) -
+							static_cast<uint32_t>(TokenType :: OPEN_ELEMENT_ID) +
+							static_cast<uint32_t>(nameTokenType)
+						),
+						false,
+						chunkBuffer,
+						p - 1,
+						tokenPtr
+					);
+				} else {
+					writeToken(
+						static_cast<TokenType>(
+							static_cast<uint32_t>(TokenType :: UNKNOWN_OPEN_ELEMENT_END_OFFSET) -
+							static_cast<uint32_t>(TokenType :: OPEN_ELEMENT_ID) +
+							static_cast<uint32_t>(nameTokenType)
+						),
+						p - chunkBuffer - 1,
+						tokenPtr
+					);
 				}
-				writeToken(
-					static_cast<TokenType>(
-						static_cast<uint32_t>(TokenType :: UNKNOWN_OPEN_ELEMENT_END_OFFSET) -
-						static_cast<uint32_t>(TokenType :: OPEN_ELEMENT_ID) +
-						static_cast<uint32_t>(nameTokenType)
-					),
-					p - chunkBuffer - 1,
-					tokenPtr
-				);
 
 				knownName = false;
 				state = afterNameState;
-				continue;
+				PARSER_CONTINUE;
 
 			// ---------------------------------------
 			// Element and attribute name parsing ends
 			// ---------------------------------------
 
-			case State :: STORE_ELEMENT_NAME:
+			case State :: STORE_ELEMENT_NAME: PARSER_LABEL(STORE_ELEMENT_NAME)
 
 				// Store element name ID (already output) to verify closing element.
 				// TODO: Push to a stack and verify!
 				idElement = idToken;
+				attributeSet.clear();
 
 				state = State :: AFTER_ELEMENT_NAME;
 				goto AFTER_ELEMENT_NAME;
@@ -607,7 +1861,8 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 				switch(c) {
 					case '/':
 
-						if(!updateElementStack(TokenType :: CLOSE_ELEMENT_ID)) return(ErrorType :: OTHER);
+						status = updateElementStack(TokenType :: CLOSE_ELEMENT_ID, idElement);
+						if(status != ErrorType :: OK) return(status);
 						writeToken(TokenType :: CLOSED_ELEMENT_EMITTED, idElement, tokenPtr);
 
 						expected = '>';
@@ -652,16 +1907,16 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 						}
 				}
 
-				break;
+				PARSER_BREAK;
 
-			case State :: AFTER_CLOSE_ELEMENT_NAME:
+			case State :: AFTER_CLOSE_ELEMENT_NAME: PARSER_LABEL(AFTER_CLOSE_ELEMENT_NAME)
 				if(c == '>') {
 					state = State :: BEFORE_TEXT;
 				} else if(!whiteCharTbl[c]) {
 					return(ErrorType :: PROHIBITED_WHITESPACE);
 				}
 
-				break;
+				PARSER_BREAK;
 
 			// ------------------------------
 			// Attribute value parsing begins
@@ -688,11 +1943,11 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 						}
 				}
 
-				break;
+				PARSER_BREAK;
 
 			// Finished reading an attribute name beginning "xmlns:".
 			// Parse the namespace prefix it defines.
-			case State :: DEFINE_XMLNS_BEFORE_PREFIX_NAME:
+			case State :: DEFINE_XMLNS_BEFORE_PREFIX_NAME: PARSER_LABEL(DEFINE_XMLNS_BEFORE_PREFIX_NAME)
 
 				tokenStart = p - 1;
 
@@ -709,7 +1964,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 
 				goto MATCH_TRIE;
 
-			case State :: DEFINE_XMLNS_AFTER_PREFIX_NAME:
+			case State :: DEFINE_XMLNS_AFTER_PREFIX_NAME: PARSER_LABEL(DEFINE_XMLNS_AFTER_PREFIX_NAME)
 
 				if(knownName) {
 					// Store index of namespace prefix in prefix mapping table
@@ -719,7 +1974,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 					// If the name was unrecognized, flush tokens so JavaScript
 					// updates the namespace prefix trie and this tokenizer can
 					// recognize it in the future.
-					flush(tokenPtr);
+					flushNow(tokenPtr, FlushCause :: UNKNOWN_XMLNS_PREFIX);
 				}
 
 				// Match equals sign and namespace URI in double quotes.
@@ -737,7 +1992,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 
 				goto MATCH_SPARSE;
 
-			case State :: BEFORE_VALUE:
+			case State :: BEFORE_VALUE: PARSER_LABEL(BEFORE_VALUE)
 
 				tokenStart = p - 1;
 
@@ -747,7 +2002,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 
 			// Parse a value that should match a known set. Similar to
 			// State :: NAME but reads up to and consumes a final double quote.
-			case State :: VALUE:
+			case State :: VALUE: PARSER_LABEL(VALUE)
 
 				if(c == textEndChar) {
 					// If the whole value was matched, get associated reference.
@@ -759,11 +2014,12 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 							idToken = config.namespaceByUriToken[idToken].first;
 						}
 						writeToken(valueTokenType, idToken, tokenPtr);
+						PARSER_STAT(++stats.trieHits[static_cast<uint32_t>(TrieKind :: URI)]);
 
 						knownName = true;
 						pos = 0;
 						state = afterValueState;
-						break;
+						PARSER_BREAK;
 					} else {
 						// TODO: Verify emitting partial name works in this case.
 					}
@@ -814,7 +2070,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 						}
 					}
 
-					updateRowCol(c);
+					if(!consumeChar<trackPosition, validateUtf8>(c)) goto INVALID_UTF8;
 					if(!--len) return(ErrorType :: OK);
 					c = *p++;
 				}
@@ -831,9 +2087,15 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 
 				knownName = false;
 				state = afterValueState;
-				break;
+				PARSER_BREAK;
+
+			case State :: DEFINE_XMLNS_AFTER_URI: PARSER_LABEL(DEFINE_XMLNS_AFTER_URI)
 
-			case State :: DEFINE_XMLNS_AFTER_URI:
+				// The prefix is known here even if it was new, because
+				// JavaScript set it after the earlier flush.
+				if(!attributeSet.insertPrefix(idPrefix)) {
+					return(ErrorType :: DUPLICATE_ATTRIBUTE);
+				}
 
 				if(knownName) {
 					bindPrefix(idPrefix, idToken);
@@ -841,7 +2103,17 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 					// If the value was unrecognized, flush tokens so JavaScript
 					// updates the uri trie and this tokenizer can recognize it
 					// in the future.
-					flush(tokenPtr);
+					if(isPulling) {
+						PARSER_STAT(++stats.flushCount[static_cast<uint32_t>(FlushCause :: UNKNOWN_URI)]);
+
+						// Element namespace is reset in resume.
+						isNamespaceStale = true;
+						afterValueState = State :: AFTER_ATTRIBUTE_VALUE;
+						state = State :: AFTER_ATTRIBUTE_VALUE;
+						goto SUSPEND;
+					}
+
+					flush(tokenPtr, FlushCause :: UNKNOWN_URI);
 
 					// Reset element namespace to correctly match any following attributes.
 					elementPrefix.idNamespace = config.namespacePrefixTbl[elementPrefix.idPrefix].first;
@@ -857,7 +2129,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 			// ----------------------------
 
 			// Tag starting with <! (comment, cdata, entity definition...)
-			case State :: BEFORE_SGML:
+			case State :: BEFORE_SGML: PARSER_LABEL(BEFORE_SGML)
 
 				switch(c) {
 					case '[':
@@ -885,14 +2157,20 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 
 					default:
 
+						if(dtd && sgmlNesting && isEntityExpansion) {
+							// Store the declaration in case it defines an entity.
+							isEntityDeclaration = true;
+							declStart = p - 1;
+						}
+
 						// writeToken(TokenType :: SGML_START, 0, tokenPtr);
 						goto SGML_DECLARATION;
 				}
-				break;
+				PARSER_BREAK;
 
 			case State :: SGML_DECLARATION: SGML_DECLARATION:
 
-				if(whiteCharTbl[c]) break;
+				if(whiteCharTbl[c]) PARSER_BREAK;
 
 				switch(c) {
 					case '"':
@@ -908,6 +2186,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 					case '>':
 
 						writeToken(TokenType :: SGML_EMITTED, 0, tokenPtr);
+						if(dtd && isEntityDeclaration) addEntityDeclaration(p - 1);
 
 						nameCharTbl = xmlNameCharTbl;
 						nameStartCharTbl = xmlNameStartCharTbl;
@@ -930,6 +2209,8 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 
 					case '[':
 
+						if(!dtd) return(ErrorType :: UNSUPPORTED_DTD);
+
 						// Signal start of DTD embedded in DOCTYPE.
 						writeToken(TokenType :: SGML_NESTED_START, 0, tokenPtr);
 						++sgmlNesting;
@@ -940,7 +2221,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 						state = State :: BEFORE_TEXT;
 						break;
 				}
-				break;
+				PARSER_BREAK;
 
 			// Inside a processing instruction with the name already parsed.
 			case State :: AFTER_PROCESSING_NAME: AFTER_PROCESSING_NAME:
@@ -957,7 +2238,8 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 					case '>':
 
 						// End of an SGML processing instruction.
-						if(!updateElementStack(TokenType :: CLOSE_ELEMENT_ID)) return(ErrorType :: OTHER);
+						status = updateElementStack(TokenType :: CLOSE_ELEMENT_ID, idElement);
+						if(status != ErrorType :: OK) return(status);
 						writeToken(TokenType :: CLOSED_ELEMENT_EMITTED, idElement, tokenPtr);
 
 						state = State :: BEFORE_TEXT;
@@ -974,10 +2256,10 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 						goto AFTER_ELEMENT_NAME;
 				}
 
-				break;
+				PARSER_BREAK;
 
 			// Enforce whitespace between processing instruction attributes.
-			case State :: AFTER_PROCESSING_VALUE:
+			case State :: AFTER_PROCESSING_VALUE: PARSER_LABEL(AFTER_PROCESSING_VALUE)
 
 				switch(c) {
 					case '?':
@@ -997,9 +2279,9 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 						}
 				}
 
-				break;
+				PARSER_BREAK;
 
-			case State :: BEFORE_COMMENT:
+			case State :: BEFORE_COMMENT: PARSER_LABEL(BEFORE_COMMENT)
 
 				writeToken(TokenType :: COMMENT_START_OFFSET, p - chunkBuffer - 1, tokenPtr);
 
@@ -1018,7 +2300,7 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 						pos = 0;
 					}
 
-					updateRowCol(c);
+					if(!consumeChar<trackPosition, validateUtf8>(c)) goto INVALID_UTF8;
 					if(!--len) return(ErrorType :: OK);
 					c = *p++;
 				}
@@ -1031,31 +2313,178 @@ Parser :: ErrorType Parser :: parse(nbind::Buffer chunk) {
 
 				pos = 0;
 				state = State :: BEFORE_TEXT;
-				break;
+				PARSER_BREAK;
+
+			// Skip an element at the split depth, only tracking markup
+			// until its end tag.
+			case State :: SKIP_RECORD: SKIP_RECORD:
+
+				// Nesting is 0 when resuming to write the prefixes.
+				while(recordNesting) {
+					switch(skipState) {
+						case SkipState :: CONTENT:
+
+							if(c == '<') {
+								skipState = SkipState :: AFTER_LT;
+							} else if(skipText) {
+								// Move to the last byte before the next tag.
+								const unsigned char *next = static_cast<const unsigned char *>(
+									memchr(p, '<', len - 1)
+								);
+								size_t skipLen = next ? next - p : len - 1;
+								if(validateUtf8 && !validateSkipped(p, skipLen)) goto INVALID_UTF8;
+								p += skipLen;
+								len -= skipLen;
+								c = p[-1];
+							}
+							break;
+
+						case SkipState :: AFTER_LT:
+
+							switch(c) {
+								case '/': skipState = SkipState :: CLOSE_TAG; break;
+								case '!': skipState = SkipState :: AFTER_BANG; break;
+								case '?': skipState = SkipState :: PROCESSING; break;
+								default:
+
+									++recordNesting;
+									skipState = SkipState :: START_TAG;
+							}
+
+							pos = 0;
+							break;
+
+						case SkipState :: START_TAG:
+
+							if(c == '"' || c == '\'') {
+								skipQuote = c;
+								skipState = SkipState :: QUOTE;
+							} else if(c == '>') {
+								// Self-closing tags end with />
+								if(pos) --recordNesting;
+								skipState = SkipState :: CONTENT;
+							}
+
+							pos = (c == '/');
+							break;
+
+						case SkipState :: QUOTE:
+
+							if(c == skipQuote) skipState = SkipState :: START_TAG;
+							break;
+
+						case SkipState :: CLOSE_TAG:
+
+							if(c == '>') {
+								--recordNesting;
+								skipState = SkipState :: CONTENT;
+							}
+							break;
+
+						// A comment <!-- ... -->, <![CDATA[ ... ]]>
+						// or another declaration.
+						case SkipState :: AFTER_BANG:
+
+							skipState = (
+								c == '-' ? SkipState :: COMMENT : (
+									c == '[' ? SkipState :: CDATA :
+									SkipState :: DECLARATION
+								)
+							);
+							break;
+
+						case SkipState :: COMMENT:
+						case SkipState :: CDATA:
+
+							// Count dashes or brackets before the final >
+							if(c == (skipState == SkipState :: COMMENT ? '-' : ']')) {
+								++pos;
+							} else {
+								if(c == '>' && pos >= 2) skipState = SkipState :: CONTENT;
+								pos = 0;
+							}
+							break;
+
+						case SkipState :: PROCESSING:
+
+							if(c == '>' && pos) skipState = SkipState :: CONTENT;
+							pos = (c == '?');
+							break;
+
+						case SkipState :: DECLARATION:
+
+							if(c == '>') skipState = SkipState :: CONTENT;
+							break;
+					}
+
+					if(!recordNesting) break;
+
+					if(!consumeChar<trackPosition, validateUtf8>(c)) goto INVALID_UTF8;
+					if(!--len) return(ErrorType :: OK);
+					c = *p++;
+				}
 
-			case State :: EXPECT:
+				// When pulling, suspend first if the prefixes might not
+				// fit, and write them after resuming at the final >.
+				if(
+					isPulling &&
+					tokenList[0] &&
+					static_cast<size_t>(tokenBufferEnd - tokenPtr) <= std::min(
+						prefixStack.size(),
+						static_cast<size_t>(namespacePrefixTblSize)
+					)
+				) {
+					goto SUSPEND;
+				}
+
+				writeRecordPrefixes(tokenPtr);
+				writeToken(TokenType :: RECORD_END_OFFSET, p - chunkBuffer, tokenPtr);
+
+				pos = 0;
+				skipState = SkipState :: CONTENT;
+				state = State :: BEFORE_TEXT;
+				PARSER_BREAK;
+
+			case State :: EXPECT: PARSER_LABEL(EXPECT)
 
 				state = (c == expected) ? nextState : otherState;
 
 				if(state == State :: PARSE_ERROR) goto PARSE_ERROR;
-				break;
+				PARSER_BREAK;
 
 			case State :: PARSE_ERROR: PARSE_ERROR:
 
 				return(ErrorType :: OTHER);
 
-			default:
+			default: PARSER_LABEL(OTHER_STATE)
 
-				break;
+				PARSER_BREAK;
 		}
 
 		// Only read the next character at the end of the loop, to allow
 		// reprocessing the same character (changing states without
 		// consuming input) by using "continue".
-		updateRowCol(c);
+		if(!consumeChar<trackPosition, validateUtf8>(c)) goto INVALID_UTF8;
 		if(!--len) return(ErrorType :: OK);
 		c = *p++;
+
+		// In pull mode, stop before the next byte if the code buffer is
+		// almost full or JavaScript must handle tokens.
+		if(tokenPtr > tokenSuspendPtr) goto SUSPEND;
 	}
+
+SUSPEND:
+
+	// The latest byte read was not consumed yet.
+	pullOffset = p - chunkBuffer - 1;
+	pullLen = len;
+	isSuspended = true;
+	return(ErrorType :: BUFFER_FULL);
+
+INVALID_UTF8:
+
+	errorOffset = p - chunkBuffer - 1;
+	return(ErrorType :: INVALID_UTF8);
 }
 
 inline void Parser :: emitPartialName(
@@ -1064,12 +2493,30 @@ inline void Parser :: emitPartialName(
 	TokenType tokenType,
 	uint32_t *&tokenPtr
 ) {
+	PARSER_STAT(++stats.trieMisses[
+		static_cast<uint32_t>(tokenType) -
+		static_cast<uint32_t>(TokenType :: PARTIAL_ELEMENT_ID)
+	]);
+	PARSER_PROBE3(
+		trie__miss,
+		this,
+		static_cast<uint32_t>(tokenType) - static_cast<uint32_t>(TokenType :: PARTIAL_ELEMENT_ID),
+		pos
+	);
+
 	// Test if the number of characters consumed is more than one,
 	// and more than past characters still left in the input buffer.
 	// Otherwise we can still take the other, faster branch.
 	if(pos > 1 && (pos > offset || DEBUG_PARTIAL_NAME_RECOVERY)) {
 		// NOTE: This is a very rare and complicated edge case.
 		// Test it with the debug flag to run it more often.
+		PARSER_STAT(++stats.partialNameSlowPath);
+		PARSER_PROBE3(
+			partial__name,
+			this,
+			static_cast<uint32_t>(tokenType) - static_cast<uint32_t>(TokenType :: PARTIAL_ELEMENT_ID),
+			pos
+		);
 
 		uint32_t id = cursor.findLeaf();
 
@@ -1082,10 +2529,13 @@ inline void Parser :: emitPartialName(
 		}
 		// Emit the offset of the remaining part of the name.
 		writeToken(TokenType :: UNKNOWN_START_OFFSET, offset - 1, tokenPtr);
+		// The name is not stored in one piece, so do not intern it.
+		spanStart = nullptr;
 	} else {
 		// The consumed part of the name still remains in the
 		// input buffer. Simply emit its starting offset.
 		writeToken(TokenType :: UNKNOWN_START_OFFSET, offset - pos, tokenPtr);
+		spanStart = p - pos;
 	}
 }
 
@@ -1134,8 +2584,23 @@ NBIND_CLASS(Parser) {
 	method(bindPrefix);
 	getter(getRow);
 	getter(getCol);
+	getter(getErrorOffset);
 	method(parse);
+	method(setPullMode);
+	method(resume);
+	method(parseBatch);
+	method(parseCompressed);
+	method(setInterning);
+	method(setEntityExpansion);
+	method(setSplitDepth);
+	method(setSpanFlags);
+	method(setNumberBuffer);
+	method(reset);
+	method(snapshot);
+	method(restore);
 	method(destroy);
+	method(getStats);
+	method(resetStats);
 }
 
 #endif
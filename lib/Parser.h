@@ -1,12 +1,53 @@
 #pragma once
 
+#include <cstring>
 #include <vector>
 
 #include <nbind/api.h>
 
+#include "AttributeSet.h"
+#include "EntityTable.h"
+#include "Inflater.h"
+#include "Interner.h"
 #include "Namespace.h"
 #include "PatriciaCursor.h"
 #include "ParserConfig.h"
+#include "SpanFlags.h"
+
+// Compile with -DPARSER_STATS=1 to gather statistics for getStats.
+#ifndef PARSER_STATS
+#	define PARSER_STATS 0
+#endif
+
+#if PARSER_STATS
+#	define PARSER_STAT(statement) statement
+#else
+#	define PARSER_STAT(statement)
+#endif
+
+// Static tracepoints for perf, bpftrace and SystemTap under provider cxml.
+// Each one is a single no-op instruction until a tracer attaches to it.
+// Enabled when sys/sdt.h is available, compile with -DPARSER_PROBES=0 to omit.
+#if !defined(PARSER_PROBES) && defined(__linux__) && defined(__has_include)
+#	if __has_include(<sys/sdt.h>)
+#		define PARSER_PROBES 1
+#	endif
+#endif
+
+#ifndef PARSER_PROBES
+#	define PARSER_PROBES 0
+#endif
+
+#if PARSER_PROBES
+#	include <sys/sdt.h>
+#	define PARSER_PROBE2(name, a, b) DTRACE_PROBE2(cxml, name, a, b)
+#	define PARSER_PROBE3(name, a, b, c) DTRACE_PROBE3(cxml, name, a, b, c)
+#	define PARSER_PROBE4(name, a, b, c, d) DTRACE_PROBE4(cxml, name, a, b, c, d)
+#else
+#	define PARSER_PROBE2(name, a, b)
+#	define PARSER_PROBE3(name, a, b, c)
+#	define PARSER_PROBE4(name, a, b, c, d)
+#endif
 
 struct ParserState {
 
@@ -33,12 +74,14 @@ struct PrefixDefinition {
 
 struct Element {
 
-	Element(size_t prefixStackOffset, uint32_t crc32) :
-	prefixStackOffset(prefixStackOffset), crc32(crc32) {}
+	Element(size_t prefixStackOffset, uint32_t crc32, uint32_t state = ContentModel :: unvalidated) :
+	prefixStackOffset(prefixStackOffset), crc32(crc32), state(state) {}
 
 	size_t prefixStackOffset;
 	// TODO: verify open and close tags match by using CRC.
 	uint32_t crc32;
+	/** Content model state after the children seen so far. */
+	uint32_t state;
 
 };
 
@@ -46,6 +89,8 @@ struct Element {
 
 class Parser {
 
+	friend class ParserPool;
+
 public:
 
 	static constexpr uint32_t namespacePrefixTblSize = ParserConfig :: namespacePrefixTblSize;
@@ -55,7 +100,7 @@ public:
 	enum class State : uint32_t {
 		BEGIN,
 		MATCH, MATCH_SPARSE, QUOTE,
-		BEFORE_TEXT, TEXT,
+		BEFORE_TEXT, TEXT, NUMBER_LIST,
 		BEFORE_CDATA, CDATA,
 		AFTER_LT,
 		BEFORE_NAME, MATCH_TRIE, NAME, UNKNOWN_NAME,
@@ -67,10 +112,25 @@ public:
 		BEFORE_SGML, SGML_DECLARATION,
 		AFTER_PROCESSING_NAME, AFTER_PROCESSING_VALUE,
 		BEFORE_COMMENT, COMMENT,
+		SKIP_RECORD,
 		EXPECT,
 		PARSE_ERROR
 	};
 
+	/** Markup inside a record skipped in SKIP_RECORD state. */
+	enum class SkipState : uint32_t {
+		CONTENT,
+		AFTER_LT,
+		START_TAG,
+		QUOTE,
+		CLOSE_TAG,
+		AFTER_BANG,
+		COMMENT,
+		CDATA,
+		PROCESSING,
+		DECLARATION
+	};
+
 	enum class TagType : uint32_t {
 		ELEMENT,
 		SGML_DECLARATION,
@@ -84,7 +144,65 @@ public:
 		ATTRIBUTE_NAMESPACE
 	};
 
-	static constexpr unsigned int TOKEN_SHIFT = 5;
+	/** Reasons for passing tokens to JavaScript before parsing ends. */
+	enum class FlushCause : uint32_t {
+		BUFFER_FULL,
+		UNKNOWN_PREFIX,
+		UNKNOWN_XMLNS_PREFIX,
+		UNKNOWN_URI,
+		INPUT_WINDOW,
+		NUMBER_BUFFER,
+		COUNT
+	};
+
+	/** Tries used for matching names. Order must match PARTIAL_ELEMENT_ID,
+	  * PARTIAL_ATTRIBUTE_ID... */
+	enum class TrieKind : uint32_t {
+		ELEMENT,
+		ATTRIBUTE,
+		PREFIX,
+		URI,
+		COUNT
+	};
+
+	static constexpr uint32_t stateCount = static_cast<uint32_t>(State :: PARSE_ERROR) + 1;
+
+	static constexpr unsigned int TOKEN_SHIFT = 6;
+	static constexpr uint32_t tokenKindCount = 1 << TOKEN_SHIFT;
+
+	/** Free space in the code buffer for tokens written between checks
+	  * for suspending in pull mode. States write fewer tokens per input
+	  * byte, so writeToken never needs to flush while pulling. */
+	static constexpr uint32_t pullReserve = 16;
+
+	/** Smallest code buffer in tokens, including its length, that ParserPool
+	  * accepts so that parsing never calls back into JavaScript. It also
+	  * fits a token for every prefix in scope at the end of a record. */
+	static constexpr uint32_t pullBufferMin = namespacePrefixTblSize + pullReserve + 2;
+
+	/** Set in PREFIX_ID tokens when an attribute had no prefix of its own. */
+	static constexpr uint32_t inheritedPrefixFlag = 1 << 13;
+
+#if PARSER_STATS
+	/** Counters updated inside the parser when compiled with PARSER_STATS. */
+	struct Stats {
+		/** Bytes consumed in each state. */
+		double stateBytes[stateCount];
+		/** Number of times a byte was consumed in a different state
+		  * than the previous byte. */
+		double stateTransitions;
+		double tokenCount[tokenKindCount];
+		double flushCount[static_cast<uint32_t>(FlushCause :: COUNT)];
+		double trieHits[static_cast<uint32_t>(TrieKind :: COUNT)];
+		double trieMisses[static_cast<uint32_t>(TrieKind :: COUNT)];
+		/** Partial names recovered from a trie after crossing chunks. */
+		double partialNameSlowPath;
+		double maxElementDepth;
+		double maxPrefixDepth;
+
+		State prevState;
+	};
+#endif
 
 	#define export
 	#define const
@@ -106,37 +224,177 @@ public:
 
 	ErrorType destroy();
 
+	/** Get statistics gathered when compiled with PARSER_STATS, otherwise an
+	  * empty list. The list begins with the number of states, token kinds,
+	  * flush causes and tries, followed by the Stats members in order. */
+	std::vector<double> getStats();
+
+	void resetStats();
+
 	ParserConfig *getConfig() { return(&config); }
 
 	/** Parse a chunk of incoming data. */
 	ErrorType parse(nbind::Buffer chunk);
 
+	/** Stop parse when the code buffer is almost full or JavaScript must
+	  * handle an unknown namespace, instead of calling flushTokens from
+	  * inside the parser. parse then returns BUFFER_FULL and the tokens can
+	  * be read before calling resume. Batch and compressed input are not
+	  * affected. */
+	void setPullMode(bool isPullMode) { this->isPullMode = isPullMode; }
+
+	/** Continue parsing the latest chunk after parse or resume returned
+	  * BUFFER_FULL. Tokens are written to the start of the code buffer. */
+	ErrorType resume();
+
+	/** Parse several complete documents concatenated in a single buffer.
+	  * Parser state is reset before each document, and each one ends with
+	  * a DOCUMENT_END token containing its error code, preceded by the row
+	  * and column of any error.
+	  * @param ends Uint32Array with offsets just past the end of each document.
+	  * @return OTHER if an offset was invalid, after the documents before it,
+	  * or if offsets in chunk do not fit in tokens. */
+	ErrorType parseBatch(nbind::Buffer chunk, nbind::Buffer ends);
+
+	/** Parse gzip or zlib compressed input, decompressing it through window.
+	  * Tokens are flushed every time the window fills, each time followed
+	  * by a CHUNK_END token with the number of valid bytes. */
+	ErrorType parseCompressed(nbind::Buffer compressed, nbind::Buffer window);
+
+	/** Replace repeated unrecognized names and short attribute values with
+	  * IDs. Limits are numbers of different strings to remember. */
+	void setInterning(uint32_t nameLimit, uint32_t valueLimit, uint32_t valueMaxLen);
+
+	/** Expand references to general entities declared in DOCTYPE internal
+	  * subsets, writing expanded text into buffer. Output for each document
+	  * is limited to the buffer length, and entities can nest maxDepth
+	  * levels deep. Exceeding either limit stops parsing with ENTITY_LIMIT.
+	  * An empty buffer disables expansion. */
+	void setEntityExpansion(nbind::Buffer buffer, uint32_t maxDepth);
+
+	/** Skip elements with depth ancestors (0 disables) without tokenizing
+	  * them, emitting only their byte ranges and the namespace prefixes in
+	  * scope. Their content is not validated. */
+	void setSplitDepth(uint32_t depth) { splitDepth = depth; }
+
+	/** Emit SPAN_FLAGS tokens, rescanning each text span once it ends.
+	  * Only worth it if JavaScript decodes the strings (default true). */
+	void setSpanFlags(bool isEnabled) {
+		isSpanFlagsEnabled = isEnabled;
+		spanFlags.clear();
+	}
+
+	/** Decode number lists selected in the config into buffer, shared
+	  * with JavaScript. A full buffer is flushed like the code buffer,
+	  * splitting the list into parts. An empty buffer disables decoding. */
+	void setNumberBuffer(nbind::Buffer buffer);
+
+	/** Return to the initial state for parsing a new document,
+	  * undoing any namespace prefix bindings made by the previous one. */
+	void reset();
+
+	/** Serialize parser state between chunks, storing trie positions as
+	  * offsets instead of pointers. Data is written only if it fits.
+	  * @return Number of bytes needed, or 0 if state cannot be saved at
+	  * this point, inside compressed input or a name matched against a trie
+	  * replaced since. Entity tables are not saved, so documents declaring
+	  * internal entities cannot be saved at all while entities are expanded. */
+	uint32_t snapshot(nbind::Buffer buffer);
+
+	/** Restore state serialized by snapshot, into a parser with an
+	  * identical config. Interned strings are forgotten.
+	  * @return False if data is invalid, leaving the parser reset. */
+	bool restore(nbind::Buffer buffer);
+
 	void setCodeBuffer(nbind::Buffer tokenBuffer, nbind::cbFunction &flushTokens) {
 		this->flushTokens = std::unique_ptr<nbind::cbFunction>(new nbind::cbFunction(flushTokens));
 		this->tokenBuffer = tokenBuffer;
 
 		tokenList = reinterpret_cast<uint32_t *>(tokenBuffer.data());
 		tokenBufferEnd = tokenList + tokenBuffer.length() / 4;
+		tokenSuspendPtr = tokenBufferEnd;
 
 		flushTokens.reset();
 	}
 
-	inline void flush(uint32_t *&tokenPtr) {
-		(*flushTokens)();
+	/** In the Emscripten build, C++ works on a copy of the code buffer,
+	  * which must be copied back before JavaScript reads tokens. */
+	inline void commitTokens() {
+#	ifdef __EMSCRIPTEN__
+		tokenBuffer.commit();
+		if(entityPos) entityBuffer.commit();
+		if(numberPos) numberBuffer.commit();
+#	endif
+	}
+
+	/** Start a new, empty code buffer after JavaScript has read the previous
+	  * one, also discarding the expanded text and numbers it referred to.
+	  * Numbers of a list in progress move to the start of their buffer. */
+	inline void clearTokens(uint32_t *&tokenPtr) {
 		tokenList[0] = 0;
 		tokenPtr = tokenList + 1;
+		entityPos = 0;
+
+		if(numberType != NumberListType :: NONE && numberPos > numberStart) {
+			unsigned char *numberData = numberBuffer.data();
+			memmove(numberData, numberData + numberStart, numberPos - numberStart);
+			numberPos -= numberStart;
+		} else numberPos = 0;
+
+		numberStart = 0;
+	}
+
+	inline void flush(uint32_t *&tokenPtr, FlushCause cause) {
+		// Only used by stats and probes.
+		static_cast<void>(cause);
+
+		PARSER_STAT(++stats.flushCount[static_cast<uint32_t>(cause)]);
+		PARSER_PROBE3(flush, this, static_cast<uint32_t>(cause), tokenList[0]);
+
+		commitTokens();
+		(*flushTokens)();
+		clearTokens(tokenPtr);
+	}
+
+	/** Let JavaScript handle tokens before parsing further. In pull mode,
+	  * parsing is suspended before the next input byte instead. */
+	inline void flushNow(uint32_t *&tokenPtr, FlushCause cause) {
+		if(isPulling) {
+			PARSER_STAT(++stats.flushCount[static_cast<uint32_t>(cause)]);
+			PARSER_PROBE3(suspend, this, static_cast<uint32_t>(cause), tokenList[0]);
+			tokenSuspendPtr = tokenList;
+		} else flush(tokenPtr, cause);
 	}
 
-	bool updateElementStack(TokenType nameTokenType) {
+	ErrorType updateElementStack(TokenType nameTokenType, uint32_t idElement) {
+		if(isNumberListEnabled) selectNumberList(nameTokenType, idElement);
+
 		if(nameTokenType == TokenType :: OPEN_ELEMENT_ID) {
+			uint32_t childState = ContentModel :: unvalidated;
+
+			// Processing instructions are outside the content model.
+			if(contentModel && tagType == TagType :: ELEMENT) {
+				uint32_t &parentState = elementStack.empty() ? documentState : elementStack.back().state;
+
+				if(!contentModel->step(parentState, idElement, childState)) {
+					return(ErrorType :: INVALID_CONTENT);
+				}
+			}
+
 			// TODO: Ensure stack is not too large.
-			elementStack.emplace_back(prefixStack.size(), 0);
+			elementStack.emplace_back(prefixStack.size(), 0, childState);
+			PARSER_STAT(if(elementStack.size() > stats.maxElementDepth) stats.maxElementDepth = elementStack.size());
 		} else if(nameTokenType == TokenType :: CLOSE_ELEMENT_ID) {
-			if(elementStack.empty()) return(false);
+			if(elementStack.empty()) return(ErrorType :: OTHER);
 
 			const Element &element = elementStack.back();
 			size_t oldSize = element.prefixStackOffset;
 
+			// Report missing children.
+			if(contentModel && !contentModel->isAccepting(element.state)) {
+				return(ErrorType :: INVALID_CONTENT);
+			}
+
 			for(size_t size = prefixStack.size(); size > oldSize; --size) {
 				const PrefixDefinition &old = prefixStack.back();
 				Namespace *ns = config.namespaceList[old.idNamespace].get();
@@ -151,14 +409,18 @@ public:
 			elementStack.pop_back();
 		}
 
-		return(true);
+		return(ErrorType :: OK);
 	}
 
-	/** Output a token. This is the only function writing to memory, so safety
-	  * from code execution exploits depends on this and nothing else. */
+	/** Output a token. This is the only function writing to the code buffer.
+	  * Other writes to raw memory are bounds checked where they happen:
+	  * storeNumber after reserveNumber into numberBuffer, EntityTable :: expand
+	  * into entityBuffer and the memmove in clearTokens. declBuffer and
+	  * textBuffer are std::strings growing as needed. */
 
 	inline void writeToken(TokenType kind, uint32_t token, uint32_t *&tokenPtr) {
-		if(tokenPtr >= tokenBufferEnd) flush(tokenPtr);
+		if(tokenPtr >= tokenBufferEnd) flush(tokenPtr, FlushCause :: BUFFER_FULL);
+		PARSER_STAT(++stats.tokenCount[static_cast<uint32_t>(kind)]);
 
 		// Buffer content length is stored at its beginning.
 		++tokenList[0];
@@ -168,9 +430,45 @@ public:
 		*tokenPtr++ = static_cast<uint32_t>(kind) + (token << TOKEN_SHIFT);
 	}
 
+	/** Emit the namespace prefix of the next name. Unprefixed attributes
+	  * inherit the prefix of their element, and are flagged to tell them
+	  * apart when serializing. */
+	inline void writePrefix(uint32_t *&tokenPtr) {
+		writeToken(
+			TokenType :: PREFIX_ID,
+			(memberPrefix->idNamespace << 14) | memberPrefix->idPrefix | (
+				memberPrefix == &attributePrefix && isPrefixInherited ?
+				inheritedPrefixFlag : 0
+			),
+			tokenPtr
+		);
+	}
+
+	/** Emit namespace prefixes bound by ancestors of a skipped record,
+	  * so it can be parsed separately. */
+	inline void writeRecordPrefixes(uint32_t *&tokenPtr) {
+		const size_t count = prefixStack.size();
+
+		for(size_t num = 0; num < count; ++num) {
+			const uint32_t idPrefix = prefixStack[num].idPrefix;
+			size_t later = num + 1;
+
+			// Only the latest binding of each prefix is in scope.
+			while(later < count && prefixStack[later].idPrefix != idPrefix) ++later;
+			if(later < count) continue;
+
+			writeToken(
+				TokenType :: RECORD_PREFIX_ID,
+				(config.namespacePrefixTbl[idPrefix].first << 14) | idPrefix,
+				tokenPtr
+			);
+		}
+	}
+
 	void setPrefix(uint32_t idPrefix) {
 		if(idPrefix < namespacePrefixTblSize) this->idPrefix = idPrefix;
 		memberPrefix->idPrefix = idPrefix;
+		isPrefixInherited = false;
 		memberPrefix->idNamespace = config.namespacePrefixTbl[config.emptyPrefixToken].first;
 	}
 
@@ -180,6 +478,7 @@ public:
 		if(config.bindPrefix(idPrefix, uri)) {
 			// Push old prefix binding to stack, to restore it after closing tag.
 			prefixStack.emplace_back(idPrefix, nsOld);
+			PARSER_STAT(if(prefixStack.size() > stats.maxPrefixDepth) stats.maxPrefixDepth = prefixStack.size());
 			if(elementPrefix.idPrefix == idPrefix) {
 				elementPrefix.idNamespace = config.namespacePrefixTbl[idPrefix].first;
 			}
@@ -201,10 +500,150 @@ public:
 		uint32_t *&tokenPtr
 	);
 
+	/** Choose how to decode text after an element name or the value after
+	  * an attribute name. Only text before any child element can hold
+	  * a number list. */
+	inline void selectNumberList(TokenType nameTokenType, uint32_t idName) {
+		typedef ParserConfig :: NumberListKind NumberListKind;
+
+		if(tagType != TagType :: ELEMENT) return;
+
+		switch(nameTokenType) {
+			case TokenType :: OPEN_ELEMENT_ID:
+
+				textNumberType = config.getNumberListType(NumberListKind :: ELEMENT, idName);
+				break;
+
+			case TokenType :: ATTRIBUTE_ID:
+
+				valueNumberType = config.getNumberListType(NumberListKind :: ATTRIBUTE, idName);
+				break;
+
+			case TokenType :: CLOSE_ELEMENT_ID:
+
+				textNumberType = NumberListType :: NONE;
+				break;
+
+			default:
+
+				break;
+		}
+	}
+
+	/** Emit a token with the end of numbers decoded so far. */
+	inline void writeNumberOffset(TokenType kind, uint32_t *&tokenPtr) {
+		// Flush first, so numbers in progress move before reading numberPos.
+		if(tokenPtr >= tokenBufferEnd) flush(tokenPtr, FlushCause :: BUFFER_FULL);
+		writeToken(kind, numberPos, tokenPtr);
+	}
+
+	/** Ensure the number buffer has room for another number, passing
+	  * numbers decoded so far to JavaScript if it is full.
+	  * @return False if parsing must suspend first. */
+	inline bool reserveNumber(uint32_t *&tokenPtr);
+
+	/** Keep part of a number continuing in the next chunk. */
+	inline void appendNumberText(const unsigned char *p, size_t len);
+
+	/** Decode a complete number from any part in numberText followed by
+	  * len bytes at p, and store it.
+	  * @return False if it contained invalid characters. */
+	inline bool storeNumber(const unsigned char *p, size_t len);
+
+	/** Finish a number list at the end of input.
+	  * @return False if its last number contained invalid characters. */
+	inline bool endNumberList(uint32_t *&tokenPtr);
+
+	/** Store an entity declaration ending at end, in the current chunk. */
+	inline void addEntityDeclaration(const unsigned char *end);
+
+	/** Emit expanded text if the text ending at end referred to entities.
+	  * Returns false if expansion exceeded a limit. */
+	inline bool writeExpansion(const unsigned char *end, uint32_t *&tokenPtr);
+
+	/** Emit the end offset of a string starting from spanStart, or its ID
+	  * if interned earlier. New strings are interned while under limit. */
+	inline void writeInternable(
+		TokenType endTokenType,
+		TokenType internedTokenType,
+		bool isValue,
+		const unsigned char *chunkBuffer,
+		const unsigned char *end,
+		uint32_t *&tokenPtr
+	);
+
 	inline void updateRowCol(unsigned char c);
 
+	/** Bookkeeping for every byte of input consumed.
+	  * Returns false if the byte is not valid UTF-8 in its context. */
+	template <bool trackPosition, bool validateUtf8>
+	inline bool consumeChar(unsigned char c);
+
+	/** Slow path of UTF-8 validation for bytes outside ASCII. */
+	inline bool validateUtf8Byte(unsigned char c);
+
+	/** Validate bytes skipped in bulk, testing 8 ASCII bytes at a time.
+	  * @return Pointer to the first invalid byte, or end if none. */
+	inline const unsigned char *validateUtf8Span(const unsigned char *p, const unsigned char *end);
+
+	/** Validate the current byte at p - 1 and others skipped after it.
+	  * On failure, p moves past the invalid byte to report its offset. */
+	inline bool validateSkipped(const unsigned char *&p, size_t skipLen);
+
+	template <bool namespaces, bool dtd>
+	inline bool isNameChar(unsigned char c);
+
+	template <bool namespaces, bool dtd>
+	inline bool isNameStartChar(unsigned char c);
+
+	/** Check if the Patricia cursor may still be read before matching
+	  * another name or value. */
+	bool isCursorActive() {
+		return(
+			state == State :: MATCH_TRIE ||
+			state == State :: NAME ||
+			state == State :: BEFORE_VALUE ||
+			state == State :: VALUE ||
+			matchState == State :: BEFORE_VALUE
+		);
+	}
+
+	/** Trie currently used for matching a name, for statistics. */
+	TrieKind getNameTrieKind() {
+		return(
+			matchTarget == MatchTarget :: ELEMENT ? TrieKind :: ELEMENT : (
+				matchTarget == MatchTarget :: ATTRIBUTE ? TrieKind :: ATTRIBUTE :
+				TrieKind :: PREFIX
+			)
+		);
+	}
+
+	/** Parse len bytes starting from chunkBuffer + offset. Token offsets are
+	  * relative to chunkBuffer. */
+	ErrorType parseRange(
+		const unsigned char *chunkBuffer,
+		size_t offset,
+		size_t len,
+		uint32_t *&tokenPtr
+	);
+
+	/** Parse part of pullChunk in pull mode, into an empty code buffer. */
+	ErrorType parsePulled(size_t offset, size_t len);
+
+	/** parseRange specialized for features enabled in the config.
+	  * See ParserConfig :: Feature. */
+	template <uint32_t features>
+	ErrorType parseSpecialized(
+		const unsigned char *chunkBuffer,
+		size_t offset,
+		size_t len,
+		uint32_t *&tokenPtr
+	);
+
 	inline uint32_t getRow() { return(row); }
 	inline uint32_t getCol() { return(col); }
+	/** Offset of an invalid byte in the latest chunk. */
+	inline uint32_t getErrorOffset() { return(errorOffset); }
 
 	ParserConfig config;
 
@@ -212,10 +651,18 @@ public:
 	PrefixDefinition elementPrefix;
 	PrefixDefinition attributePrefix;
 	PrefixDefinition *memberPrefix = &attributePrefix;
+	/** Attribute prefix was copied from its element. */
+	bool isPrefixInherited = false;
 
 	std::vector<PrefixDefinition> prefixStack;
 	std::vector<Element> elementStack;
 
+	/** Schema validating element content, kept for the whole document
+	  * even if the config changes. */
+	std::shared_ptr<const ContentModel> contentModel;
+	/** Content model state for top-level elements. */
+	uint32_t documentState;
+
 	PatriciaCursor cursor;
 
 	unsigned char *nameCharTbl;
@@ -226,52 +673,148 @@ public:
 	State matchState;
 	State noMatchState;
 	State partialMatchState;
-	State afterNameState;
-	State afterTextState;
-	State afterMatchTrieState;
+	State afterNameState = State :: BEGIN;
+	State afterTextState = State :: BEGIN;
+	State afterMatchTrieState = State :: BEGIN;
 	/** Next state after reading an element, attribute or processing instruction
 	  * name, a text node or an attribute value. */
-	State nextState;
+	State nextState = State :: BEGIN;
 	/** Next state if the current character was not the expected one. */
-	State otherState;
+	State otherState = State :: BEGIN;
 	/** Next state after reading an attribute value. Regular elements and
 	  * processing instructions need different handling. */
-	State afterValueState;
+	State afterValueState = State :: BEGIN;
 	/** Flag whether the previously emitted name was found in a trie. */
-	bool knownName;
+	bool knownName = false;
 
-	TagType tagType;
-	MatchTarget matchTarget;
+	TagType tagType = TagType :: ELEMENT;
+	MatchTarget matchTarget = MatchTarget :: ELEMENT;
 
-	unsigned char textEndChar;
+	unsigned char textEndChar = 0;
 
 	/** Expected character for moving to another state. */
-	unsigned char expected;
+	unsigned char expected = 0;
 
 	size_t pos;
 
 	uint32_t row;
 	uint32_t col;
 
-	uint32_t idToken;
-	uint32_t idPrefix;
+	uint32_t idToken = 0;
+	uint32_t idPrefix = 0;
 
-	uint32_t idElement;
+	uint32_t idElement = 0;
 
 	uint32_t sgmlNesting;
 
-	TokenType nameTokenType;
-	TokenType textTokenType;
-	TokenType valueTokenType;
+	/** Depth of elements skipped as records, or 0 to tokenize everything. */
+	uint32_t splitDepth = 0;
+	/** Number of elements open in the record being skipped. */
+	uint32_t recordNesting = 0;
+	SkipState skipState = SkipState :: CONTENT;
+	/** Quote character ending an attribute value in a skipped record. */
+	unsigned char skipQuote = 0;
+
+	/** Number of UTF-8 continuation bytes still expected. */
+	uint32_t utf8Pending;
+	/** Range of valid values for the next continuation byte. */
+	unsigned char utf8Min;
+	unsigned char utf8Max;
+
+	uint32_t errorOffset;
+
+	Inflater inflater;
+
+	Interner interner;
+
+	EntityTable entityTbl;
+	/** Output for expanded entities, shared with JavaScript. */
+	nbind::Buffer entityBuffer;
+	/** Bytes written to entityBuffer since the code buffer was cleared. */
+	size_t entityPos = 0;
+	bool isEntityExpansion = false;
+	/** Parsing an entity declaration inside a DOCTYPE, starting at declStart
+	  * or the beginning of the input range. Any earlier part from previous
+	  * chunks is in declBuffer. */
+	bool isEntityDeclaration = false;
+	const unsigned char *declStart = nullptr;
+	std::string declBuffer;
+	/** Latest text contained an ampersand. */
+	bool hasEntityRef = false;
+	/** Part of the latest text from previous chunks, if it may need expanding. */
+	std::string textBuffer;
+	/** Start of the input range parsed in the latest call. */
+	const unsigned char *rangeStart;
+
+	uint32_t internNameLimit = 0;
+	uint32_t internValueLimit = 0;
+	uint32_t internValueMaxLen = 0;
+	uint32_t internNameCount = 0;
+	uint32_t internValueCount = 0;
+
+	typedef ParserConfig :: NumberListType NumberListType;
+
+	/** Output for decoded number lists, shared with JavaScript. */
+	nbind::Buffer numberBuffer;
+	/** Usable length of numberBuffer, a multiple of 8 bytes. */
+	size_t numberBufferLen = 0;
+	/** Bytes written to numberBuffer since the code buffer was cleared. */
+	size_t numberPos = 0;
+	/** Start of numbers in the current list not yet passed to JavaScript. */
+	size_t numberStart = 0;
+	bool isNumberListEnabled = false;
+	/** Type of list decoded from the text of the current element,
+	  * the next attribute value and in the current number list. */
+	NumberListType textNumberType = NumberListType :: NONE;
+	NumberListType valueNumberType = NumberListType :: NONE;
+	NumberListType numberType = NumberListType :: NONE;
+	/** Beginning of a number continuing from previous chunks. */
+	std::string numberText;
+
+	/** Start of the latest name or value, if inside the current chunk. */
+	const unsigned char *spanStart;
+	/** Properties of the text span in progress, from earlier chunks. */
+	SpanFlags spanFlags;
+	bool isSpanFlagsEnabled = true;
+	/** Start of the latest attribute name including any prefix,
+	  * if inside the current chunk. */
+	const unsigned char *attributeStart;
+	/** Attributes of the current start tag. */
+	AttributeSet attributeSet;
+
+	TokenType nameTokenType = TokenType :: OPEN_ELEMENT_ID;
+	TokenType textTokenType = TokenType :: TEXT_START_OFFSET;
+	TokenType valueTokenType = TokenType :: VALUE_START_OFFSET;
 	const unsigned char *tokenStart;
 
 	// TODO: Maybe this could be std::function<void ()>
 	std::unique_ptr<nbind::cbFunction> flushTokens;
 
-	Patricia Namespace :: *trie;
+	Patricia Namespace :: *trie = &Namespace :: elementTrie;
 
 	nbind::Buffer tokenBuffer;
-	uint32_t *tokenList;
-	const uint32_t *tokenBufferEnd;
+	uint32_t *tokenList = nullptr;
+	const uint32_t *tokenBufferEnd = nullptr;
+	/** Parsing is suspended before the next byte if output passes this.
+	  * Equals tokenBufferEnd unless pulling. */
+	const uint32_t *tokenSuspendPtr;
+
+	bool isPullMode = false;
+	/** Parsing a chunk in pull mode. */
+	bool isPulling = false;
+	/** Parsing of pullChunk stopped at pullOffset with pullLen bytes left. */
+	bool isSuspended = false;
+	/** Element namespace must be updated after JavaScript handles
+	  * an unknown URI. */
+	bool isNamespaceStale = false;
+
+	/** Latest chunk parsed in pull mode, kept for resuming. */
+	nbind::Buffer pullChunk;
+	size_t pullOffset = 0;
+	size_t pullLen = 0;
+
+#if PARSER_STATS
+	Stats stats;
+#endif
 
 };
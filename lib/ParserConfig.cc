@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cstring>
+
 #include "ParserConfig.h"
 #include "PatriciaCursor.h"
 
@@ -34,6 +37,221 @@ bool ParserConfig :: addUri(uint32_t uri, uint32_t ns) {
 	return(false);
 }
 
+namespace {
+
+/** Identifies the native part of a config image and its layout version. */
+constexpr uint32_t imageMagic = 0x676d6978;
+constexpr uint32_t imageVersion = 1;
+
+/** Writes 32-bit words and tries padded to 4 bytes into a buffer,
+  * only counting bytes past its end. */
+
+class ImageWriter {
+
+public:
+
+	ImageWriter(unsigned char *p, size_t len) : p(p), len(len) {}
+
+	void write(uint32_t value) {
+		if(pos + 4 <= len) memcpy(p + pos, &value, 4);
+		pos += 4;
+	}
+
+	void writeTrie(const Patricia &trie) {
+		size_t trieLen = trie.getLength();
+
+		write(trieLen);
+		if(pos + trieLen <= len) memcpy(p + pos, trie.getRoot(), trieLen);
+		pos += (trieLen + 3) & ~static_cast<size_t>(3);
+	}
+
+	unsigned char *p;
+	size_t len;
+	size_t pos = 0;
+
+};
+
+/** Reads words and trie locations, flagging reads past the end. */
+
+class ImageReader {
+
+public:
+
+	ImageReader(const unsigned char *p, size_t len, size_t pos) : p(p), len(len), pos(pos) {
+		isValid = pos <= len;
+	}
+
+	uint32_t read(uint32_t limit = ~0U) {
+		uint32_t value;
+
+		if(!isValid || len - pos < 4) {
+			isValid = false;
+			return(0);
+		}
+
+		memcpy(&value, p + pos, 4);
+		pos += 4;
+
+		if(value >= limit) isValid = false;
+		return(value);
+	}
+
+	/** Skip over a trie, returning its offset and length. */
+	void readTrie(size_t &offset, size_t &trieLen) {
+		trieLen = read();
+		offset = pos;
+
+		if(!isValid || len - pos < trieLen) {
+			isValid = false;
+			return;
+		}
+
+		pos += std::min((trieLen + 3) & ~static_cast<size_t>(3), len - pos);
+	}
+
+	const unsigned char *p;
+	size_t len;
+	size_t pos;
+	bool isValid;
+
+};
+
+} // namespace
+
+uint32_t ParserConfig :: saveImage(nbind::Buffer buffer) {
+	ImageWriter writer(buffer.data(), buffer.length());
+	const uint32_t namespaceCount = namespaceList.size();
+
+	writer.write(imageMagic);
+	writer.write(imageVersion);
+
+	writer.writeTrie(uriTrie);
+	writer.writeTrie(prefixTrie);
+
+	// Namespace 0 never exists.
+	writer.write(namespaceCount);
+
+	for(uint32_t num = 1; num < namespaceCount; ++num) {
+		writer.writeTrie(namespaceList[num]->elementTrie);
+		writer.writeTrie(namespaceList[num]->attributeTrie);
+	}
+
+	writer.write(namespaceByUriToken.size());
+	for(const auto &item : namespaceByUriToken) writer.write(item.first);
+
+	// Prefix bindings are stored as namespace IDs.
+	for(uint32_t num = 0; num < namespacePrefixTblSize; ++num) {
+		writer.write(namespacePrefixTbl[num].first);
+	}
+
+#	ifdef __EMSCRIPTEN__
+		// JavaScript only sees a copy of the buffer.
+		if(writer.pos <= writer.len) buffer.commit();
+#	endif
+
+	return(writer.pos);
+}
+
+bool ParserConfig :: loadImage(nbind::Buffer image, uint32_t offset) {
+	ImageReader reader(image.data(), image.length(), offset);
+	const uint32_t namespaceCount = namespaceList.size();
+	size_t uriOffset, uriLen;
+	size_t prefixOffset, prefixLen;
+	std::vector<size_t> trieList;
+
+	if(
+		reader.read() != imageMagic ||
+		reader.read() != imageVersion
+	) return(false);
+
+	reader.readTrie(uriOffset, uriLen);
+	reader.readTrie(prefixOffset, prefixLen);
+
+	if(reader.read() != namespaceCount) return(false);
+
+	// Check the whole image before changing anything.
+	for(uint32_t num = 1; num < namespaceCount; ++num) {
+		for(uint32_t kind = 0; kind < 2; ++kind) {
+			size_t trieOffset, trieLen;
+
+			reader.readTrie(trieOffset, trieLen);
+			trieList.push_back(trieOffset);
+			trieList.push_back(trieLen);
+		}
+	}
+
+	std::vector<std::pair<uint32_t, const Namespace *> > namespaceByUriToken(reader.read(0x1000000));
+
+	for(auto &item : namespaceByUriToken) {
+		item.first = reader.read(namespaceCount);
+		item.second = namespaceList[item.first].get();
+	}
+
+	uint32_t prefixTbl[namespacePrefixTblSize];
+
+	for(uint32_t num = 0; num < namespacePrefixTblSize; ++num) {
+		prefixTbl[num] = reader.read(namespaceCount);
+	}
+
+	if(!reader.isValid) return(false);
+
+	uriTrie.setImage(image, uriOffset, uriLen);
+	prefixTrie.setImage(image, prefixOffset, prefixLen);
+
+	for(uint32_t num = 1; num < namespaceCount; ++num) {
+		const size_t *item = &trieList[(num - 1) * 4];
+
+		namespaceList[num]->elementTrie.setImage(image, item[0], item[1]);
+		namespaceList[num]->attributeTrie.setImage(image, item[2], item[3]);
+	}
+
+	this->namespaceByUriToken.swap(namespaceByUriToken);
+
+	for(uint32_t num = 0; num < namespacePrefixTblSize; ++num) {
+		namespacePrefixTbl[num] = std::make_pair(prefixTbl[num], namespaceList[prefixTbl[num]].get());
+	}
+
+	return(true);
+}
+
+bool ParserConfig :: setContentModel(nbind::Buffer buffer) {
+	if(!buffer.length()) {
+		contentModel.reset();
+		return(true);
+	}
+
+	std::shared_ptr<ContentModel> model = std::make_shared<ContentModel>();
+
+	if(!model->setData(reinterpret_cast<const uint32_t *>(buffer.data()), buffer.length() / 4)) {
+		return(false);
+	}
+
+	contentModel = model;
+	return(true);
+}
+
+bool ParserConfig :: setNumberList(uint32_t kind, uint32_t idName, uint32_t type) {
+	if(
+		kind > static_cast<uint32_t>(NumberListKind :: ATTRIBUTE) ||
+		type > static_cast<uint32_t>(NumberListType :: FLOAT64) ||
+		idName == Patricia :: notFound
+	) return(false);
+
+	std::vector<NumberListType> &tbl = (
+		kind == static_cast<uint32_t>(NumberListKind :: ELEMENT) ?
+		elementNumberTbl :
+		attributeNumberTbl
+	);
+
+	if(idName >= tbl.size()) tbl.resize(idName + 1, NumberListType :: NONE);
+
+	numberListCount -= tbl[idName] != NumberListType :: NONE;
+	tbl[idName] = static_cast<NumberListType>(type);
+	numberListCount += tbl[idName] != NumberListType :: NONE;
+
+	return(true);
+}
+
 #include <nbind/nbind.h>
 
 #ifdef NBIND_CLASS
@@ -44,6 +262,13 @@ NBIND_CLASS(ParserConfig) {
 	method(addNamespace);
 	method(addUri);
 	method(bindPrefix);
+	method(saveImage);
+	method(loadImage);
+	method(setContentModel);
+	method(setFeatures);
+	method(getFeatures);
+	method(setNumberList);
+	method(hasNumberLists);
 
 	method(setUriTrie);
 	method(setPrefixTrie);
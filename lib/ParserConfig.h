@@ -3,6 +3,7 @@
 #include <vector>
 #include <memory>
 
+#include "ContentModel.h"
 #include "Namespace.h"
 #include "Patricia.h"
 
@@ -14,11 +15,57 @@ public:
 
 	static constexpr uint32_t namespacePrefixTblSize = 256;
 
+	/** Optional parser features. Disabling unused features selects
+	  * a faster parser specialized at compile time. */
+	enum class Feature : uint32_t {
+		/** Track row and column for error messages. */
+		TRACK_POSITION = 1,
+		/** Handle namespace prefixes and xmlns attributes.
+		  * Otherwise colons are parts of names. */
+		NAMESPACES = 2,
+		/** Handle DTDs embedded in DOCTYPE and special characters
+		  * in DTD names. */
+		DTD = 4,
+		/** Report invalid UTF-8 input as an error. */
+		VALIDATE_UTF8 = 8,
+		DEFAULT = 7,
+		ALL = 15
+	};
+
+	static constexpr bool hasFeature(uint32_t features, Feature feature) {
+		return((features & static_cast<uint32_t>(feature)) != 0);
+	}
+
+	/** Kinds of names selecting number lists. */
+	enum class NumberListKind : uint32_t {
+		ELEMENT,
+		ATTRIBUTE
+	};
+
+	/** Binary types of decoded number lists.
+	  * Must match NumberListType in ParserConfig.ts. */
+	enum class NumberListType : uint32_t {
+		NONE,
+		INT32,
+		FLOAT64
+	};
+
 	ParserConfig(uint32_t xmlnsToken, uint32_t emptyPrefixToken, uint32_t xmlnsPrefixToken, uint32_t processingPrefixToken);
 
 	void setUriTrie(nbind::Buffer buffer) { uriTrie.setBuffer(buffer); }
 	void setPrefixTrie(nbind::Buffer buffer) { prefixTrie.setBuffer(buffer); }
 
+	/** Write tries, URI mappings and prefix bindings into an image
+	  * for loadImage. Returns the number of bytes needed, written only
+	  * if the buffer is large enough. */
+	uint32_t saveImage(nbind::Buffer buffer);
+
+	/** Point tries into an image from saveImage starting at offset,
+	  * without copying. Namespaces must already be added in the same
+	  * order. The image is kept referenced and must not change.
+	  * Returns false if the image does not match. */
+	bool loadImage(nbind::Buffer image, uint32_t offset);
+
 	uint32_t addNamespace(const std::shared_ptr<Namespace> ns) {
 		namespaceList.push_back(ns);
 
@@ -27,6 +74,32 @@ public:
 
 	bool addUri(uint32_t uri, uint32_t ns);
 
+	/** Validate element content with automata compiled from a schema,
+	  * in parsers created or reset afterwards. An empty buffer turns
+	  * validation off. Returns false if the data is malformed. */
+	bool setContentModel(nbind::Buffer buffer);
+
+	void setFeatures(uint32_t features) { this->features = features; }
+	uint32_t getFeatures() { return(features); }
+
+	/** Decode text directly inside elements or attribute values with
+	  * a known name as whitespace separated numbers, in parsers created
+	  * afterwards. Not stored in config images.
+	  * @param kind NumberListKind of the name.
+	  * @param type NumberListType, NONE to decode as text again.
+	  * @return False if the arguments are invalid. */
+	bool setNumberList(uint32_t kind, uint32_t idName, uint32_t type);
+
+	bool hasNumberLists() { return(numberListCount != 0); }
+
+	NumberListType getNumberListType(NumberListKind kind, uint32_t idName) const {
+		const std::vector<NumberListType> &tbl = (
+			kind == NumberListKind :: ELEMENT ? elementNumberTbl : attributeNumberTbl
+		);
+
+		return(idName < tbl.size() ? tbl[idName] : NumberListType :: NONE);
+	}
+
 	bool bindPrefix(uint32_t idPrefix, uint32_t uri) {
 		if(idPrefix >= namespacePrefixTblSize) return(false);
 		if(uri >= namespaceByUriToken.size()) return(false);
@@ -41,6 +114,15 @@ private:
 	std::vector<std::pair<uint32_t, const Namespace *> > namespaceByUriToken;
 	std::pair<uint32_t, const Namespace *> namespacePrefixTbl[namespacePrefixTblSize];
 
+	uint32_t features = static_cast<uint32_t>(Feature :: DEFAULT);
+
+	std::shared_ptr<const ContentModel> contentModel;
+
+	/** Number list types by element and attribute ID. */
+	std::vector<NumberListType> elementNumberTbl;
+	std::vector<NumberListType> attributeNumberTbl;
+	uint32_t numberListCount = 0;
+
 	uint32_t xmlnsToken;
 
 	uint32_t emptyPrefixToken;
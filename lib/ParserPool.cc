@@ -0,0 +1,143 @@
+#include "ParserPool.h"
+
+ParserPool :: ParserPool(uint32_t threadCount) {
+#	ifdef __EMSCRIPTEN__
+		// Without shared memory, jobs run in wait instead.
+		threadCount = 0;
+#	endif
+
+	for(uint32_t num = 0; num < threadCount; ++num) {
+		threadList.emplace_back(&ParserPool :: work, this);
+	}
+}
+
+uint32_t ParserPool :: add(Parser *parser, nbind::Buffer chunk) {
+	if(
+		!parser->tokenList ||
+		parser->tokenBufferEnd - parser->tokenList < Parser :: pullBufferMin
+	) return(noJob);
+
+	// Set up the parser here, because worker threads cannot touch
+	// JavaScript buffer handles.
+	parser->setPullMode(true);
+	parser->pullChunk = chunk;
+	parser->isSuspended = false;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Start numbering again after all previous jobs were reported.
+	if(!pendingCount && doneQueue.empty()) jobList.clear();
+
+	uint32_t num = jobList.size();
+
+	jobList.emplace_back(parser, chunk.length());
+	readyQueue.push_back(num);
+	++pendingCount;
+
+	queued.notify_one();
+	return(num);
+}
+
+void ParserPool :: resume(uint32_t num) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if(num >= jobList.size() || jobList[num].status != ErrorType :: BUFFER_FULL) return;
+
+	// Continue filled code buffers first, so finished tokens reach
+	// JavaScript before new documents start.
+	readyQueue.push_front(num);
+	queued.notify_one();
+}
+
+uint32_t ParserPool :: wait() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while(doneQueue.empty()) {
+		if(threadList.empty() && !readyQueue.empty()) {
+			uint32_t num = readyQueue.front();
+			readyQueue.pop_front();
+			++runningCount;
+
+			lock.unlock();
+			run(num);
+			lock.lock();
+		} else if(!readyQueue.empty() || runningCount) {
+			stopped.wait(lock);
+		} else return(noJob);
+	}
+
+	uint32_t num = doneQueue.front();
+	doneQueue.pop_front();
+
+	return(num);
+}
+
+void ParserPool :: stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		isStopping = true;
+		queued.notify_all();
+	}
+
+	for(std::thread &thread : threadList) thread.join();
+	threadList.clear();
+}
+
+void ParserPool :: work() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while(1) {
+		while(readyQueue.empty() && !isStopping) queued.wait(lock);
+		if(isStopping) break;
+
+		uint32_t num = readyQueue.front();
+		readyQueue.pop_front();
+		++runningCount;
+
+		lock.unlock();
+		run(num);
+		lock.lock();
+	}
+}
+
+void ParserPool :: run(uint32_t num) {
+	Parser *parser;
+	size_t len;
+	bool isStarted;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		parser = jobList[num].parser;
+		len = jobList[num].len;
+		isStarted = jobList[num].isStarted;
+	}
+
+	ErrorType status = isStarted ? parser->resume() : parser->parsePulled(0, len);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	Job &job = jobList[num];
+
+	job.status = status;
+	job.isStarted = true;
+	if(status != ErrorType :: BUFFER_FULL) --pendingCount;
+
+	--runningCount;
+	doneQueue.push_back(num);
+	stopped.notify_all();
+}
+
+#include <nbind/nbind.h>
+
+#ifdef NBIND_CLASS
+
+NBIND_CLASS(ParserPool) {
+	construct<uint32_t>();
+	method(add);
+	method(resume);
+	method(wait);
+	method(getStatus);
+	method(getPendingCount);
+	method(stop);
+}
+
+#endif
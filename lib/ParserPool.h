@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <nbind/api.h>
+
+#include "Parser.h"
+
+/** Runs parsers for independent documents on worker threads.
+  * Each parser runs in pull mode and stops whenever its code buffer fills,
+  * until JavaScript has read the tokens and resumes it. Prefix bindings
+  * are private to each parser but namespace tries are shared, so JavaScript
+  * must not replace them while jobs run. JavaScript objects are only used
+  * from the calling thread. */
+
+class ParserPool {
+
+public:
+
+	typedef Parser :: ErrorType ErrorType;
+
+	/** Job number returned by wait if no jobs remain. */
+	static constexpr uint32_t noJob = ~0u;
+
+	/** @param threadCount Number of worker threads. If 0, jobs run
+	  * in the calling thread inside wait. */
+	explicit ParserPool(uint32_t threadCount);
+
+	~ParserPool() { stop(); }
+
+	/** Queue parsing a complete document. The parser and chunk must not
+	  * be used from JavaScript until the job stops. Numbering restarts
+	  * when no earlier jobs remain.
+	  * @return Job number, or noJob if the code buffer of the parser is
+	  * smaller than Parser :: pullBufferMin. Parsing would then need to call
+	  * JavaScript from a worker thread. */
+	uint32_t add(Parser *parser, nbind::Buffer chunk);
+
+	/** Continue a job after wait reported BUFFER_FULL
+	  * and its tokens were read. */
+	void resume(uint32_t num);
+
+	/** Block until any job stops, with its status available from getStatus.
+	  * @return Job number or noJob if none are queued or running. */
+	uint32_t wait();
+
+	ErrorType getStatus(uint32_t num) {
+		std::lock_guard<std::mutex> lock(mutex);
+		return(num < jobList.size() ? jobList[num].status : ErrorType :: OTHER);
+	}
+
+	/** Number of jobs not yet finished, including suspended ones. */
+	uint32_t getPendingCount() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return(pendingCount);
+	}
+
+	/** Finish running jobs and end all worker threads. */
+	void stop();
+
+private:
+
+	struct Job {
+		Job(Parser *parser, size_t len) : parser(parser), len(len) {}
+
+		Parser *parser;
+		/** Document length in bytes. */
+		size_t len;
+		ErrorType status = ErrorType :: OK;
+		bool isStarted = false;
+	};
+
+	void work();
+	void run(uint32_t num);
+
+	std::vector<std::thread> threadList;
+
+	std::mutex mutex;
+	/** Signals workers that jobs were queued or the pool is stopping. */
+	std::condition_variable queued;
+	/** Signals wait that a job stopped. */
+	std::condition_variable stopped;
+
+	/** Jobs may be added while others run, so they are only accessed
+	  * by index under the mutex. */
+	std::deque<Job> jobList;
+	std::deque<uint32_t> readyQueue;
+	std::deque<uint32_t> doneQueue;
+
+	uint32_t pendingCount = 0;
+	uint32_t runningCount = 0;
+	bool isStopping = false;
+
+};
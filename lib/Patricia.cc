@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "Patricia.h"
 #include "PatriciaCursor.h"
 
@@ -11,6 +13,94 @@ uint32_t Patricia :: find(const char *needle) {
 	return(cursor.getData());
 }
 
+uint32_t Patricia :: findMany(nbind::Buffer text, nbind::Buffer ends, nbind::Buffer result) {
+	const unsigned char *data = text.data();
+	const uint32_t *endList = reinterpret_cast<const uint32_t *>(ends.data());
+	uint32_t *idList = reinterpret_cast<uint32_t *>(result.data());
+	size_t count = std::min(ends.length(), result.length()) / 4;
+	size_t len = text.length();
+	size_t start = 0;
+
+	// Validate all offsets first, so lookups can start in any order.
+	for(size_t num = 0; num < count; ++num) {
+		if(endList[num] < start || endList[num] > len) {
+			count = num;
+			break;
+		}
+
+		start = endList[num];
+	}
+
+	if(!root) {
+		for(size_t num = 0; num < count; ++num) idList[num] = notFound;
+		return(count);
+	}
+
+	struct Lane {
+		PatriciaCursor cursor;
+		/** Index of the string being looked up, or count if idle. */
+		size_t num;
+		size_t pos;
+		size_t end;
+	};
+
+	Lane laneList[laneCount];
+	size_t next = 0;
+	uint32_t activeCount = laneCount;
+
+	// Take the next non-empty string, reporting empty strings as not found.
+	auto startLane = [&](Lane &lane) {
+		while(next < count) {
+			lane.num = next;
+			lane.pos = next ? endList[next - 1] : 0;
+			lane.end = endList[next++];
+
+			if(lane.pos < lane.end) {
+				lane.cursor.init(*this);
+				return(true);
+			}
+
+			idList[lane.num] = notFound;
+		}
+
+		lane.num = count;
+		--activeCount;
+		return(false);
+	};
+
+	for(Lane &lane : laneList) startLane(lane);
+
+	// Advance every lookup in turn until it jumps to another node,
+	// prefetching the node while the others proceed.
+	while(activeCount) {
+		for(Lane &lane : laneList) {
+			if(lane.num == count) continue;
+
+			switch(lane.cursor.advanceResumable(data[lane.pos])) {
+				case PatriciaCursor :: Step :: JUMPED:
+
+					lane.cursor.prefetch();
+					continue;
+
+				case PatriciaCursor :: Step :: MATCH:
+
+					if(++lane.pos < lane.end) continue;
+					idList[lane.num] = lane.cursor.getExactData();
+					break;
+
+				case PatriciaCursor :: Step :: MISMATCH:
+
+					idList[lane.num] = notFound;
+					break;
+			}
+
+			startLane(lane);
+		}
+	}
+
+	return(count);
+}
+
 #include <nbind/nbind.h>
 
 #ifdef NBIND_CLASS
@@ -19,6 +109,7 @@ NBIND_CLASS(Patricia) {
 	construct<>();
 	method(setBuffer);
 	method(find);
+	method(findMany);
 }
 
 #endif
@@ -14,7 +14,11 @@
 
 	First child node immediately follows.
 
-	Total data size is limited to 16 megabytes.
+	Total data size is limited to 16 megabytes and data values to 0x7ffffe.
+
+	Larger tries use a wide format starting with a 0xff byte, followed by
+	nodes with 4-byte references. Node lengths are at most 254 bits,
+	so the first byte tells the formats apart.
 */
 
 /** Patricia trie. */
@@ -25,22 +29,61 @@ class Patricia {
 
 public:
 
-	void setRoot(const unsigned char *root) { this->root = root; }
+	void setRoot(const unsigned char *root) {
+		this->root = root;
+		refLen = root && *root == wideFlag ? 4 : 3;
+	}
 
 	void setBuffer(nbind::Buffer buffer) {
 		this->buffer = buffer;
-		root = buffer.data();
+		setRoot(buffer.data());
+		len = buffer.length();
 	}
 
+	/** Use a trie stored inside a larger buffer, such as a config image,
+	  * without copying it. */
+	void setImage(nbind::Buffer image, size_t offset, size_t len) {
+		buffer = image;
+		setRoot(len ? image.data() + offset : nullptr);
+		this->len = len;
+	}
+
+	const unsigned char *getRoot() const { return(root); }
+	size_t getLength() const { return(len); }
+
 	uint32_t find(const char *needle);
 
-	static constexpr uint32_t notFound = 0x7fffff;
+	/** Look up many strings at once, interleaving lookups to overlap
+	  * their cache misses in large tries. Strings must match completely.
+	  * @param text Concatenated strings.
+	  * @param ends Uint32Array with offsets just past the end of each string.
+	  * @param result Uint32Array receiving the ID of each string or notFound.
+	  * @return Number of strings looked up, less than requested if
+	  * offsets were invalid or result was too short. */
+	uint32_t findMany(nbind::Buffer text, nbind::Buffer ends, nbind::Buffer result);
+
+	/** Returned for strings without data. */
+	static constexpr uint32_t notFound = ~0u;
+
+	/** Data values without the flag for nodes without children.
+	  * All bits set means no data. */
 	static constexpr uint32_t idMask = 0x7fffff;
+	static constexpr uint32_t wideIdMask = 0x7fffffff;
+
+	/** First byte of tries in the wide format. */
+	static constexpr unsigned char wideFlag = 0xff;
+
+	/** Number of lookups interleaved in findMany. */
+	static constexpr uint32_t laneCount = 16;
 
 private:
 
 	/** Trie root. */
-	const unsigned char *root;
+	const unsigned char *root = nullptr;
+	/** Bytes in data values and child offsets, 4 in the wide format. */
+	unsigned char refLen = 3;
+	/** Encoded size in bytes, if known. */
+	size_t len = 0;
 
 	/** Handle to the JavaScript buffer with inserted data,
 	  * to prevent garbage collecting it too early. */
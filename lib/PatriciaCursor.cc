@@ -5,20 +5,27 @@
 void PatriciaCursor :: init(const Patricia &trie) {
 	if(trie.root != root) {
 		root = trie.root;
+		refLen = trie.refLen;
 		// Hold on to trie data used by the cursor in case it gets garbage collected.
 		buffer = trie.buffer;
 	}
 
 	ptr = root;
+	// Skip the wide format flag.
+	if(refLen != 3) ++ptr;
 	len = *ptr++;
 
 	found = nullptr;
 }
 
-bool PatriciaCursor :: advance(unsigned char c) {
+template <bool isResumable>
+inline PatriciaCursor :: Step PatriciaCursor :: advanceStep(unsigned char c) {
 	const unsigned char *p = ptr;
 	unsigned char delta;
 
+	// Read length of a second child entered in the previous call.
+	if(isResumable && len == nodeStart) len = *p++;
+
 	// Loop until the current trie branch node contains an entire byte.
 	while(len < 8) {
 		if(len) {
@@ -35,7 +42,7 @@ bool PatriciaCursor :: advance(unsigned char c) {
 			// with this prefix exist.
 			if(*p & 0x80) {
 				ptr = p;
-				return(false);
+				return(Step :: MISMATCH);
 			}
 		}
 
@@ -44,18 +51,25 @@ bool PatriciaCursor :: advance(unsigned char c) {
 			// the last one, then it was not found in the trie.
 			if(delta > 1) {
 				ptr = p - 1;
-				return(false);
+				return(Step :: MISMATCH);
 			}
 
 			// If the last bit differs, find pointer to the second child.
 			// It must exist, otherwise there would be no branch here.
-			p += (p[0] << 16) + (p[1] << 8) + p[2];
+			p += readRef(p);
+
+			if(isResumable) {
+				// Let the caller prefetch the child before reading it.
+				ptr = p;
+				len = nodeStart;
+				return(Step :: JUMPED);
+			}
 		} else {
 			// This branch is conditioned on a bit so it has a pointer
 			// to a second child, or it ends on a byte boundary so it has
 			// a data pointer. In either case, jump over a pointer to find
 			// the first child node.
-			p += 3;
+			p += refLen;
 		}
 
 		// Entered a new node, so read its length.
@@ -68,7 +82,7 @@ bool PatriciaCursor :: advance(unsigned char c) {
 	// then it was not found in the trie.
 	if(c != *p++) {
 		ptr = p;
-		return(false);
+		return(Step :: MISMATCH);
 	}
 
 	if(!len) {
@@ -83,7 +97,15 @@ bool PatriciaCursor :: advance(unsigned char c) {
 	}
 
 	ptr = p;
-	return(true);
+	return(Step :: MATCH);
+}
+
+bool PatriciaCursor :: advance(unsigned char c) {
+	return(advanceStep<false>(c) == Step :: MATCH);
+}
+
+PatriciaCursor :: Step PatriciaCursor :: advanceResumable(unsigned char c) {
+	return(advanceStep<true>(c));
 }
 
 bool PatriciaCursor :: transfer(const Patricia &trie) {
@@ -118,17 +140,17 @@ uint32_t PatriciaCursor :: findLeaf() {
 		while(len & 7) {
 			// Read length from beginning of first child
 			// (just after the data reference).
-			len = p[3];
+			len = p[refLen];
 			// Skip current node's data or second child reference, the first child's
 			// length and its contents, moving to its data or second child reference.
-			p += (len + 7) / 8 + 4;
+			p += (len + 7) / 8 + refLen + 1;
 		}
 
-		len = p[3];
+		len = p[refLen];
 		found = p;
 		data = getData();
 
-		p += 4;
+		p += refLen + 1;
 		// After splitting nodes at 32 chars, avoid returning a split node.
 	} while(data == Patricia :: notFound && !(*p & 0x80));
 
@@ -138,5 +160,47 @@ uint32_t PatriciaCursor :: findLeaf() {
 uint32_t PatriciaCursor :: getData() {
 	if(!found) return(Patricia :: notFound);
 
-	return( ( (found[0] << 16) + (found[1] << 8) + found[2] ) & Patricia :: idMask );
+	const uint32_t mask = refLen == 3 ? Patricia :: idMask : Patricia :: wideIdMask;
+	const uint32_t data = readRef(found) & mask;
+
+	return(data == mask ? Patricia :: notFound : data);
+}
+
+bool PatriciaCursor :: getOffsets(
+	const Patricia &trie,
+	uint32_t &ptrOffset,
+	uint32_t &foundOffset,
+	uint32_t &len
+) const {
+	if(!root || root != trie.root) return(false);
+
+	ptrOffset = ptr - root;
+	// Zero means no data value was found.
+	foundOffset = found ? found - root + 1 : 0;
+	len = this->len;
+
+	return(true);
+}
+
+bool PatriciaCursor :: setOffsets(
+	const Patricia &trie,
+	uint32_t ptrOffset,
+	uint32_t foundOffset,
+	uint32_t len
+) {
+	size_t size = trie.buffer.length();
+
+	// Data values found are 3 or 4 bytes long.
+	if(!trie.root || ptrOffset >= size || foundOffset + trie.refLen - 1 > size || len > 0xffff) {
+		return(false);
+	}
+
+	root = trie.root;
+	refLen = trie.refLen;
+	buffer = trie.buffer;
+	ptr = root + ptrOffset;
+	found = foundOffset ? root + foundOffset - 1 : nullptr;
+	this->len = len;
+
+	return(true);
 }
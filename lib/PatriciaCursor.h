@@ -9,6 +9,14 @@ class PatriciaCursor {
 
 public:
 
+	/** Result of advanceResumable. */
+	enum class Step {
+		MISMATCH,
+		MATCH,
+		/** Moved to a second child, call again with the same character. */
+		JUMPED
+	};
+
 	/** Start scanning a trie from the first input character. */
 	void init(const Patricia &trie);
 
@@ -20,22 +28,62 @@ public:
 	  * value found. */
 	bool advance(unsigned char c);
 
+	/** Like advance, but stop before reading a second child node, which
+	  * is likely a cache miss in a large trie. Then it can be prefetched
+	  * while advancing other cursors. */
+	Step advanceResumable(unsigned char c);
+
 	/** Find the ID of the (lexicographically) first descendant leaf
 	  * after advance has failed. The cursor position is unchanged. */
 	uint32_t findLeaf();
 
-	/** Get the data value associated with the string.
-	  * Valid values are from 0 to 0x7ffffe and 0x7fffff indicates no data.
-	  * Values are 3 bytes and the highest bit is an internal flag whether
-	  * the trie node has no children. */
+	/** Hint that the next node will be read soon. */
+	void prefetch() const {
+#		if defined(__GNUC__) || defined(__clang__)
+			__builtin_prefetch(ptr);
+#		endif
+	}
+
+	/** Get the data value associated with the string, or
+	  * Patricia :: notFound. Values are 3 bytes (4 in the wide format)
+	  * and the highest bit is an internal flag whether the trie node has
+	  * no children. */
 	uint32_t getData();
 
+	/** Get the data value only if the input so far was stored in the trie,
+	  * not just a longer or shorter string. */
+	uint32_t getExactData() { return(found && found == ptr ? getData() : Patricia :: notFound); }
+
+	/** Get the cursor position as offsets from the trie root, to store it
+	  * without pointers. Returns false if the cursor is in another trie. */
+	bool getOffsets(const Patricia &trie, uint32_t &ptrOffset, uint32_t &foundOffset, uint32_t &len) const;
+
+	/** Move to a position from getOffsets. On failure, the cursor remains
+	  * unchanged. */
+	bool setOffsets(const Patricia &trie, uint32_t ptrOffset, uint32_t foundOffset, uint32_t len);
+
 private:
 
+	/** Value of len after advanceResumable jumped to a child,
+	  * before reading its length. */
+	static constexpr uint16_t nodeStart = 0xffff;
+
+	template <bool isResumable>
+	inline Step advanceStep(unsigned char c);
+
+	/** Read a data value or child offset. */
+	inline uint32_t readRef(const unsigned char *p) const {
+		uint32_t ref = (p[0] << 16) + (p[1] << 8) + p[2];
+
+		return(refLen == 3 ? ref : (ref << 8) + p[3]);
+	}
+
 	const unsigned char *root = nullptr;
 	const unsigned char *ptr = nullptr;
 	const unsigned char *found;
 	uint16_t len;
+	/** Bytes in data values and child offsets. */
+	unsigned char refLen = 3;
 
 	/** Handle to the JavaScript buffer with inserted data,
 	  * to prevent garbage collecting it too early. */
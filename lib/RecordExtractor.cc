@@ -0,0 +1,350 @@
+#include <cstring>
+#include <limits>
+
+#include "NumberParser.h"
+#include "RecordExtractor.h"
+
+namespace {
+
+inline bool isWhite(unsigned char c) {
+	return(c == ' ' || c == '\t' || c == '\n' || c == '\r');
+}
+
+/** Skip whitespace around a field value. */
+inline void trim(const unsigned char *&p, const unsigned char *&end) {
+	while(p < end && isWhite(*p)) ++p;
+	while(p < end && isWhite(end[-1])) --end;
+}
+
+/** Parse a decimal integer surrounded by optional whitespace. */
+bool parseInt32(const unsigned char *p, const unsigned char *end, int32_t &result) {
+	trim(p, end);
+	return(NumberParser :: parseInt32(p, end - p, result));
+}
+
+/** Parse a floating point number surrounded by optional whitespace. */
+bool parseFloat64(const unsigned char *p, const unsigned char *end, double &result) {
+	trim(p, end);
+	return(NumberParser :: parseFloat64(p, end - p, result));
+}
+
+}
+
+void RecordExtractor :: Column :: push(const unsigned char *value, size_t len, uint32_t row) {
+	size_t start = data.size();
+
+	switch(type) {
+		case ColumnType :: STRING:
+
+			// Offsets are 32-bit, like in Arrow.
+			if(start + len > static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+				pushNull(row);
+				return;
+			}
+
+			data.insert(data.end(), value, value + len);
+			offsetList.push_back(static_cast<int32_t>(data.size()));
+			break;
+
+		case ColumnType :: INT32: {
+
+			int32_t number;
+			if(!parseInt32(value, value + len, number)) {
+				pushNull(row);
+				return;
+			}
+
+			data.resize(start + sizeof(number));
+			std::memcpy(&data[start], &number, sizeof(number));
+			break;
+		}
+
+		case ColumnType :: FLOAT64: {
+
+			double number;
+			if(!parseFloat64(value, value + len, number)) {
+				pushNull(row);
+				return;
+			}
+
+			data.resize(start + sizeof(number));
+			std::memcpy(&data[start], &number, sizeof(number));
+			break;
+		}
+	}
+
+	if(validity.size() <= (row >> 3)) validity.resize((row >> 3) + 1, 0);
+	validity[row >> 3] |= 1 << (row & 7);
+
+	length = row + 1;
+}
+
+void RecordExtractor :: Column :: truncate(uint32_t row) {
+	if(length <= row) return;
+
+	if(!isValid(row)) --nullCount;
+
+	// Unset the validity bit, in case the row gets stored again.
+	validity[row >> 3] &= ~(1 << (row & 7));
+	validity.resize((row + 7) >> 3);
+
+	if(type == ColumnType :: STRING) {
+		offsetList.resize(row + 1);
+		data.resize(offsetList.back());
+	} else {
+		data.resize(row * (type == ColumnType :: INT32 ? sizeof(int32_t) : sizeof(double)));
+	}
+
+	length = row;
+}
+
+void RecordExtractor :: Column :: removeBefore(uint32_t row) {
+	bool isKept = length > row;
+	bool isKeptValid = isKept && isValid(row);
+	size_t start = 0;
+
+	if(type == ColumnType :: STRING) {
+		start = isKept ? offsetList[row] : data.size();
+		offsetList.clear();
+		offsetList.push_back(0);
+		if(isKept) offsetList.push_back(static_cast<int32_t>(data.size() - start));
+	} else {
+		start = isKept ? row * (type == ColumnType :: INT32 ? sizeof(int32_t) : sizeof(double)) : data.size();
+	}
+
+	data.erase(data.begin(), data.begin() + start);
+
+	validity.clear();
+	if(isKept) validity.push_back(isKeptValid);
+
+	nullCount = isKept && !isKeptValid;
+	length = isKept;
+}
+
+void RecordExtractor :: Column :: pushNull(uint32_t row) {
+	switch(type) {
+		case ColumnType :: STRING:
+
+			offsetList.push_back(static_cast<int32_t>(data.size()));
+			break;
+
+		case ColumnType :: INT32:
+
+			data.resize(data.size() + sizeof(int32_t), 0);
+			break;
+
+		case ColumnType :: FLOAT64:
+
+			data.resize(data.size() + sizeof(double), 0);
+			break;
+	}
+
+	if(validity.size() <= (row >> 3)) validity.resize((row >> 3) + 1, 0);
+
+	++nullCount;
+	length = row + 1;
+}
+
+int32_t RecordExtractor :: addColumn(uint32_t kind, uint32_t idName, uint32_t type) {
+	if(
+		kind > static_cast<uint32_t>(FieldKind :: CHILD) ||
+		type > static_cast<uint32_t>(ColumnType :: FLOAT64) ||
+		idName == unknownId ||
+		// Pointers to columns must stay valid while parsing.
+		rowCount || recordDepth
+	) {
+		return(-1);
+	}
+
+	std::vector<uint32_t> &columnTbl = (
+		kind == static_cast<uint32_t>(FieldKind :: ATTRIBUTE) ?
+		attributeColumnTbl :
+		childColumnTbl
+	);
+
+	if(idName >= columnTbl.size()) columnTbl.resize(idName + 1, 0);
+	if(columnTbl[idName]) return(-1);
+
+	columnList.emplace_back(static_cast<ColumnType>(type));
+	columnTbl[idName] = columnList.size();
+
+	return(columnList.size() - 1);
+}
+
+uint32_t RecordExtractor :: getNullCount(uint32_t column) {
+	if(column >= columnList.size()) return(0);
+
+	const Column &item = columnList[column];
+
+	// Ignore a null in a record still open.
+	return(item.nullCount - (item.length > rowCount && !item.isValid(rowCount)));
+}
+
+uint32_t RecordExtractor :: getColumnSize(uint32_t column, uint32_t part) {
+	if(column >= columnList.size()) return(0);
+
+	const Column &item = columnList[column];
+
+	switch(static_cast<ColumnPart>(part)) {
+		case ColumnPart :: VALIDITY:
+
+			return((rowCount + 7) >> 3);
+
+		case ColumnPart :: DATA:
+
+			switch(item.type) {
+				case ColumnType :: STRING: return(item.offsetList[rowCount]);
+				case ColumnType :: INT32: return(rowCount * sizeof(int32_t));
+				case ColumnType :: FLOAT64: return(rowCount * sizeof(double));
+			}
+			break;
+
+		case ColumnPart :: OFFSETS:
+
+			if(item.type == ColumnType :: STRING) return((rowCount + 1) * sizeof(int32_t));
+			break;
+	}
+
+	return(0);
+}
+
+uint32_t RecordExtractor :: readColumn(uint32_t column, uint32_t part, nbind::Buffer dest) {
+	uint32_t len = getColumnSize(column, part);
+
+	if(!len || len > dest.length()) return(0);
+
+	const Column &item = columnList[column];
+	const void *src = (
+		part == static_cast<uint32_t>(ColumnPart :: VALIDITY) ? item.validity.data() : (
+			part == static_cast<uint32_t>(ColumnPart :: DATA) ?
+			static_cast<const void *>(item.data.data()) :
+			static_cast<const void *>(item.offsetList.data())
+		)
+	);
+
+	std::memcpy(dest.data(), src, len);
+
+#	ifdef __EMSCRIPTEN__
+		dest.commit();
+#	endif
+
+	return(len);
+}
+
+void RecordExtractor :: clear() {
+	// Fields of a record in progress move to row 0.
+	for(Column &column : columnList) column.removeBefore(rowCount);
+
+	rowCount = 0;
+}
+
+void RecordExtractor :: setField(Column *column, const unsigned char *data, size_t len) {
+	// Keep the first value if a field repeats.
+	if(column->length > rowCount) return;
+
+	column->push(data, len, rowCount);
+}
+
+void RecordExtractor :: endRecord() {
+	for(Column &column : columnList) {
+		if(column.length <= rowCount) column.pushNull(rowCount);
+	}
+
+	++rowCount;
+	recordDepth = 0;
+}
+
+void RecordExtractor :: openElement(const Span &prefix, const Span &name) {
+	pendingColumn = nullptr;
+
+	// Processing instructions are not elements.
+	if(isPrefix(prefix, '?')) {
+		isProcessing = true;
+		return;
+	}
+
+	++depth;
+
+	if(!recordDepth) {
+		if(idName == idRecord) {
+			recordDepth = depth;
+			isRecordTag = true;
+		}
+	} else if(depth == recordDepth + 1) {
+		textColumn = findColumn(childColumnTbl, idName);
+		textBuffer.clear();
+	}
+}
+
+void RecordExtractor :: attribute(const Span &prefix, const Span &name, uint32_t idNamespace) {
+	pendingColumn = isRecordTag && !isProcessing ? findColumn(attributeColumnTbl, idName) : nullptr;
+}
+
+void RecordExtractor :: value(const Span &value) {
+	if(pendingColumn) setField(pendingColumn, value.data, value.len);
+	pendingColumn = nullptr;
+}
+
+void RecordExtractor :: startTagEnd(bool isClosed) {
+	pendingColumn = nullptr;
+
+	if(isProcessing) {
+		isProcessing = false;
+		return;
+	}
+
+	isRecordTag = false;
+
+	if(isClosed) closeElement(Span(), Span());
+}
+
+void RecordExtractor :: closeElement(const Span &prefix, const Span &name) {
+	if(!depth) return;
+
+	if(depth == recordDepth) {
+		endRecord();
+	} else if(textColumn && depth == recordDepth + 1) {
+		setField(textColumn, textBuffer.data(), textBuffer.size());
+		textColumn = nullptr;
+	}
+
+	--depth;
+}
+
+void RecordExtractor :: text(const Span &text) {
+	if(textColumn && depth == recordDepth + 1) {
+		textBuffer.insert(textBuffer.end(), text.data, text.data + text.len);
+	}
+}
+
+void RecordExtractor :: documentEnd() {
+	// Drop fields of a record left open by a truncated document.
+	if(recordDepth) {
+		for(Column &column : columnList) column.truncate(rowCount);
+	}
+
+	depth = 0;
+	recordDepth = 0;
+	isRecordTag = false;
+	isProcessing = false;
+	pendingColumn = nullptr;
+	textColumn = nullptr;
+}
+
+#include <nbind/nbind.h>
+
+#ifdef NBIND_CLASS
+
+NBIND_CLASS(RecordExtractor) {
+	inherit(TokenDecoder);
+	construct<uint32_t>();
+
+	method(addColumn);
+	method(getRowCount);
+	method(getNullCount);
+	method(getColumnSize);
+	method(readColumn);
+	method(clear);
+}
+
+#endif
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "TokenDecoder.h"
+
+/** Extract fields of repeated record elements straight from parser code
+  * buffers into columns, in the layout used by Apache Arrow: validity
+  * bitmaps with a bit per row, typed values for numbers, and 32-bit
+  * offsets into concatenated UTF-8 data for strings. Fields come from
+  * attributes of the record element or text of its child elements,
+  * matched by token ID, so their names must be known to the parser.
+  * Strings are stored as in the input, with entities intact. */
+
+class RecordExtractor : public TokenDecoder {
+
+public:
+
+	/** Field sources. Must match FieldKind in RecordExtractor.ts. */
+	enum class FieldKind : uint32_t {
+		ATTRIBUTE,
+		CHILD
+	};
+
+	/** Column types. Must match ColumnType in RecordExtractor.ts. */
+	enum class ColumnType : uint32_t {
+		STRING,
+		INT32,
+		FLOAT64
+	};
+
+	/** Buffers of each column, for getColumnSize and readColumn. */
+	enum class ColumnPart : uint32_t {
+		VALIDITY,
+		DATA,
+		/** Only for strings, one more than the number of rows. */
+		OFFSETS
+	};
+
+	/** @param idRecord Token ID of record elements. */
+	explicit RecordExtractor(uint32_t idRecord) : idRecord(idRecord) {}
+
+	/** Add a column filled from an attribute or child element.
+	  * @return Column number, or -1 if the arguments were invalid
+	  * or rows were already extracted. */
+	int32_t addColumn(uint32_t kind, uint32_t idName, uint32_t type);
+
+	uint32_t getRowCount() { return(rowCount); }
+
+	/** Get the number of nulls in completed rows of a column. */
+	uint32_t getNullCount(uint32_t column);
+
+	/** Get the number of bytes in a buffer of a column, covering only
+	  * completed rows. */
+	uint32_t getColumnSize(uint32_t column, uint32_t part);
+
+	/** Copy a buffer of a column into dest if it fits.
+	  * @return Number of bytes copied. */
+	uint32_t readColumn(uint32_t column, uint32_t part, nbind::Buffer dest);
+
+	/** Forget all extracted rows, keeping the columns and
+	  * any record still open. */
+	void clear();
+
+protected:
+
+	void openElement(const Span &prefix, const Span &name) override;
+	void attribute(const Span &prefix, const Span &name, uint32_t idNamespace) override;
+	void xmlns(const Span &prefix) override { pendingColumn = nullptr; }
+	void value(const Span &value) override;
+	void startTagEnd(bool isClosed) override;
+	void closeElement(const Span &prefix, const Span &name) override;
+	void text(const Span &text) override;
+	void cdata(const Span &text) override { RecordExtractor :: text(text); }
+	void comment(const Span &text) override {}
+	void sgml(const Span &prefix, const Span &name) override {}
+	void sgmlText(const Span &text) override {}
+	void sgmlNested(bool isStart) override {}
+	void sgmlEnd() override {}
+	void documentEnd() override;
+
+private:
+
+	struct Column {
+
+		Column(ColumnType type) : type(type) {
+			if(type == ColumnType :: STRING) offsetList.push_back(0);
+		}
+
+		/** Append a value or a null if it is invalid for the column type. */
+		void push(const unsigned char *data, size_t len, uint32_t row);
+		void pushNull(uint32_t row);
+		bool isValid(uint32_t row) const {
+			return((validity[row >> 3] >> (row & 7)) & 1);
+		}
+
+		/** Remove a value or null at row, the latest one. */
+		void truncate(uint32_t row);
+		/** Remove all rows before row, which becomes row 0 if present. */
+		void removeBefore(uint32_t row);
+
+		ColumnType type;
+
+		std::vector<unsigned char> validity;
+		std::vector<unsigned char> data;
+		std::vector<int32_t> offsetList;
+
+		uint32_t nullCount = 0;
+		/** Number of rows with a value or null in this column. */
+		uint32_t length = 0;
+
+	};
+
+	/** Store a field value unless the row already has one. */
+	void setField(Column *column, const unsigned char *data, size_t len);
+
+	/** Add nulls for fields missing from the row and count it. */
+	void endRecord();
+
+	/** Get a column by field source and name, or nullptr. */
+	Column *findColumn(const std::vector<uint32_t> &columnTbl, uint32_t idName) {
+		uint32_t num = idName < columnTbl.size() ? columnTbl[idName] : 0;
+		return(num ? &columnList[num - 1] : nullptr);
+	}
+
+	uint32_t idRecord;
+
+	std::vector<Column> columnList;
+	/** Column number plus one for each attribute or child element ID,
+	  * zero for IDs not extracted. */
+	std::vector<uint32_t> attributeColumnTbl;
+	std::vector<uint32_t> childColumnTbl;
+
+	uint32_t rowCount = 0;
+
+	/** Depth of open elements. */
+	uint32_t depth = 0;
+	/** Depth of the current record element or 0 if outside records. */
+	uint32_t recordDepth = 0;
+	/** Inside the start tag of a record element. */
+	bool isRecordTag = false;
+	/** Inside a processing instruction, which has no end tag. */
+	bool isProcessing = false;
+
+	/** Column for the next attribute value. */
+	Column *pendingColumn = nullptr;
+	/** Column receiving text of the current child element. */
+	Column *textColumn = nullptr;
+	/** Text of the current child element collected so far. */
+	std::vector<unsigned char> textBuffer;
+
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+/** Properties of a text or attribute value span, gathered over all its
+  * parts to tell JavaScript which decoding steps it can skip. */
+
+class SpanFlags {
+
+public:
+
+	/** Flags emitted in SPAN_FLAGS tokens. Must match SpanFlag in CodeType.ts. */
+	enum : uint32_t {
+		NON_ASCII = 1,
+		AMPERSAND = 2,
+		CARRIAGE_RETURN = 4,
+		/** Span is not empty and only has spaces, tabs and line breaks. */
+		WHITESPACE = 8,
+		/** Span is not empty and only has decimal digits. */
+		DIGITS = 16
+	};
+
+	void clear() { seen = 0; }
+
+	/** Add a part of the span. */
+	inline void scan(const unsigned char *p, const unsigned char *end);
+
+	/** Get flags for the whole span. */
+	uint32_t get() const {
+		if(!(seen & SEEN_ANY)) return(0);
+
+		return(
+			(seen & (NON_ASCII | AMPERSAND | CARRIAGE_RETURN)) |
+			flagIf(!(seen & SEEN_NON_WHITESPACE), WHITESPACE) |
+			flagIf(!(seen & SEEN_NON_DIGIT), DIGITS)
+		);
+	}
+
+private:
+
+	/** Bits for bytes seen, besides those shared with emitted flags. */
+	enum : uint32_t {
+		SEEN_NON_WHITESPACE = 8,
+		SEEN_NON_DIGIT = 16,
+		SEEN_ANY = 32
+	};
+
+	/** Return flag if cond holds, keeping enum and integer types apart. */
+	static inline uint32_t flagIf(bool cond, uint32_t flag) { return(cond ? flag : 0); }
+
+	static inline uint32_t scanByte(unsigned char c) {
+		return(
+			flagIf(c >= 0x80, NON_ASCII) |
+			flagIf(c == '&', AMPERSAND) |
+			flagIf(c == '\r', CARRIAGE_RETURN) |
+			flagIf(c != ' ' && c != '\t' && c != '\n' && c != '\r', SEEN_NON_WHITESPACE) |
+			flagIf(c < '0' || c > '9', SEEN_NON_DIGIT)
+		);
+	}
+
+	uint32_t seen = 0;
+
+};
+
+inline void SpanFlags :: scan(const unsigned char *p, const unsigned char *end) {
+	if(p >= end) return;
+
+	uint32_t seen = SEEN_ANY;
+
+#	if defined(__SSE2__)
+		const __m128i amp = _mm_set1_epi8('&');
+		const __m128i cr = _mm_set1_epi8('\r');
+		const __m128i lf = _mm_set1_epi8('\n');
+		const __m128i tab = _mm_set1_epi8('\t');
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i digitMin = _mm_set1_epi8('0' - 1);
+		const __m128i digitMax = _mm_set1_epi8('9' + 1);
+		int nonAscii = 0, hasAmp = 0, hasCr = 0, nonWhite = 0, nonDigit = 0;
+
+		// Combine 16 bytes at a time into bit masks.
+		while(end - p >= 16) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+			__m128i isCr = _mm_cmpeq_epi8(v, cr);
+			__m128i isWhite = _mm_or_si128(
+				_mm_or_si128(isCr, _mm_cmpeq_epi8(v, lf)),
+				_mm_or_si128(_mm_cmpeq_epi8(v, tab), _mm_cmpeq_epi8(v, space))
+			);
+			// Signed comparison, so bytes above 0x7f are not digits.
+			__m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(v, digitMin), _mm_cmplt_epi8(v, digitMax));
+
+			nonAscii |= _mm_movemask_epi8(v);
+			hasAmp |= _mm_movemask_epi8(_mm_cmpeq_epi8(v, amp));
+			hasCr |= _mm_movemask_epi8(isCr);
+			nonWhite |= _mm_movemask_epi8(isWhite) ^ 0xffff;
+			nonDigit |= _mm_movemask_epi8(isDigit) ^ 0xffff;
+
+			p += 16;
+		}
+
+		seen |= (
+			flagIf(nonAscii, NON_ASCII) |
+			flagIf(hasAmp, AMPERSAND) |
+			flagIf(hasCr, CARRIAGE_RETURN) |
+			flagIf(nonWhite, SEEN_NON_WHITESPACE) |
+			flagIf(nonDigit, SEEN_NON_DIGIT)
+		);
+#	endif
+
+	while(p < end) seen |= scanByte(*p++);
+
+	this->seen |= seen;
+}
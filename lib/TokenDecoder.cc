@@ -0,0 +1,357 @@
+#include <algorithm>
+
+#include "TokenDecoder.h"
+
+bool TokenDecoder :: setNames(uint32_t kind, nbind::Buffer data, nbind::Buffer ends) {
+	if(kind >= static_cast<uint32_t>(NameKind :: COUNT)) return(false);
+
+	NameTable &table = nameTableList[kind];
+	const uint32_t *endList = reinterpret_cast<const uint32_t *>(ends.data());
+	size_t count = ends.length() / 4;
+
+	// Names must be stored in order, inside the data buffer.
+	for(size_t num = 0; num < count; ++num) {
+		if(endList[num] > data.length() || (num && endList[num] < endList[num - 1])) {
+			return(false);
+		}
+	}
+
+	table.data.assign(data.data(), data.data() + data.length());
+	table.ends.assign(endList, endList + count);
+
+	return(true);
+}
+
+TokenDecoder :: Span TokenDecoder :: getName(NameKind kind, uint32_t id) const {
+	const NameTable &table = nameTableList[static_cast<uint32_t>(kind)];
+
+	if(id >= table.ends.size()) return(Span());
+
+	uint32_t start = id ? table.ends[id - 1] : 0;
+
+	return(Span(table.data.data() + start, table.ends[id] - start));
+}
+
+TokenDecoder :: Span TokenDecoder :: getPrefix() const {
+	if(isPrefixUnknown) return(Span(prefixBuffer.data(), prefixBuffer.size()));
+
+	return(getName(NameKind :: PREFIX, idPrefix));
+}
+
+TokenDecoder :: Span TokenDecoder :: getAttributePrefix() const {
+	if(isPrefixInherited) return(Span());
+
+	return(getPrefix());
+}
+
+void TokenDecoder :: resetDocument() {
+	spanStart = -1;
+	stash.clear();
+	latestSpan = Span();
+	isStashUsed = false;
+	idPrefix = 0;
+	idNamespace = 0;
+	isPrefixInherited = false;
+	isPrefixUnknown = false;
+}
+
+void TokenDecoder :: stashSpan(const unsigned char *chunk, size_t end) {
+	if(spanStart < 0) return;
+
+	if(isStashUsed) {
+		stash.clear();
+		isStashUsed = false;
+	}
+
+	stash.insert(stash.end(), chunk + spanStart, chunk + end);
+	spanStart = 0;
+}
+
+void TokenDecoder :: beginSpan(uint32_t start) {
+	if(isStashUsed) {
+		stash.clear();
+		isStashUsed = false;
+	}
+
+	spanStart = start;
+}
+
+TokenDecoder :: Span TokenDecoder :: endSpan(const unsigned char *chunk, uint32_t end) {
+	Span span;
+
+	if(spanStart < 0 || end < spanStart) {
+		span = Span();
+	} else if(stash.empty() || isStashUsed) {
+		span = Span(chunk + spanStart, end - spanStart);
+	} else {
+		stash.insert(stash.end(), chunk + spanStart, chunk + end);
+		span = Span(stash.data(), stash.size());
+	}
+
+	// Stash contents stay valid until the next span begins,
+	// in case the span gets interned.
+	isStashUsed = true;
+	spanStart = -1;
+	latestSpan = span;
+
+	return(span);
+}
+
+void TokenDecoder :: decode(nbind::Buffer codes, nbind::Buffer chunk, bool isChunkEnd) {
+	const uint32_t *codeList = reinterpret_cast<const uint32_t *>(codes.data());
+	size_t codeLen = codes.length() / 4;
+	const unsigned char *chunkData = chunk.data();
+	size_t chunkLen = chunk.length();
+
+	if(!codeLen) return;
+
+	uint32_t codeCount = codeList[0];
+	if(codeCount >= codeLen) codeCount = codeLen - 1;
+
+	for(uint32_t codeNum = 1; codeNum <= codeCount; ++codeNum) {
+		uint32_t code = codeList[codeNum];
+		TokenType kind = static_cast<TokenType>(code & (Parser :: tokenKindCount - 1));
+		Span span;
+
+		code >>= Parser :: TOKEN_SHIFT;
+
+		// Offsets must stay inside the chunk.
+		if(
+			kind >= TokenType :: VALUE_START_OFFSET &&
+			kind <= TokenType :: UNKNOWN_SGML_END_OFFSET &&
+			kind != TokenType :: SGML_NESTED_START &&
+			kind != TokenType :: SGML_NESTED_END &&
+			code > chunkLen
+		) {
+			code = chunkLen;
+		}
+
+		switch(kind) {
+			case TokenType :: OPEN_ELEMENT_ID:
+
+				idName = code;
+				openElement(getPrefix(), getName(NameKind :: ELEMENT, code));
+				break;
+
+			case TokenType :: CLOSE_ELEMENT_ID:
+
+				idName = code;
+				closeElement(getPrefix(), getName(NameKind :: ELEMENT, code));
+				break;
+
+			case TokenType :: ATTRIBUTE_ID:
+
+				idName = code;
+				attribute(getAttributePrefix(), getName(NameKind :: ATTRIBUTE, code), idNamespace);
+				break;
+
+			case TokenType :: PREFIX_ID:
+
+				idPrefix = code & (Parser :: inheritedPrefixFlag - 1);
+				idNamespace = code >> 14;
+				isPrefixInherited = (code & Parser :: inheritedPrefixFlag) != 0;
+				isPrefixUnknown = false;
+				break;
+
+			case TokenType :: XMLNS_ID:
+
+				xmlns(getName(NameKind :: PREFIX, code));
+				break;
+
+			case TokenType :: URI_ID:
+
+				value(getName(NameKind :: URI, code));
+				break;
+
+			case TokenType :: NAMESPACE_ID:
+
+				value(getName(NameKind :: NAMESPACE, code));
+				break;
+
+			case TokenType :: SGML_ID:
+
+				sgml(getPrefix(), getName(NameKind :: ELEMENT, code));
+				break;
+
+			case TokenType :: ELEMENT_EMITTED:
+			case TokenType :: CLOSED_ELEMENT_EMITTED:
+
+				startTagEnd(kind == TokenType :: CLOSED_ELEMENT_EMITTED);
+				break;
+
+			case TokenType :: SGML_EMITTED:
+
+				sgmlEnd();
+				break;
+
+			case TokenType :: SGML_NESTED_START:
+			case TokenType :: SGML_NESTED_END:
+
+				sgmlNested(kind == TokenType :: SGML_NESTED_START);
+				break;
+
+			case TokenType :: VALUE_START_OFFSET:
+			case TokenType :: TEXT_START_OFFSET:
+			case TokenType :: CDATA_START_OFFSET:
+			case TokenType :: COMMENT_START_OFFSET:
+			case TokenType :: SGML_TEXT_START_OFFSET:
+			case TokenType :: UNKNOWN_START_OFFSET:
+
+				beginSpan(code);
+				break;
+
+			case TokenType :: VALUE_END_OFFSET:
+
+				value(endSpan(chunkData, code));
+				break;
+
+			case TokenType :: TEXT_END_OFFSET:
+
+				span = endSpan(chunkData, code);
+				if(span.len) text(span);
+				break;
+
+			case TokenType :: CDATA_END_OFFSET:
+			case TokenType :: COMMENT_END_OFFSET:
+
+				span = endSpan(chunkData, code);
+
+				// Remove terminating ]]> or -->
+				span.len = span.len < 3 ? 0 : span.len - 3;
+
+				if(kind == TokenType :: CDATA_END_OFFSET) cdata(span);
+				else comment(span);
+				break;
+
+			case TokenType :: SGML_TEXT_END_OFFSET:
+
+				sgmlText(endSpan(chunkData, code));
+				break;
+
+			case TokenType :: UNKNOWN_OPEN_ELEMENT_END_OFFSET:
+
+				idName = unknownId;
+				openElement(getPrefix(), endSpan(chunkData, code));
+				break;
+
+			case TokenType :: UNKNOWN_CLOSE_ELEMENT_END_OFFSET:
+
+				idName = unknownId;
+				closeElement(getPrefix(), endSpan(chunkData, code));
+				break;
+
+			case TokenType :: UNKNOWN_ATTRIBUTE_END_OFFSET:
+
+				idName = unknownId;
+				attribute(getAttributePrefix(), endSpan(chunkData, code), idNamespace);
+				break;
+
+			case TokenType :: UNKNOWN_PREFIX_END_OFFSET:
+
+				// JavaScript defines the prefix and reports it in PREFIX_ID codes,
+				// but the next name may already be emitted before that.
+				span = endSpan(chunkData, code);
+				prefixBuffer.assign(span.data, span.data + span.len);
+				idNamespace = 0;
+				isPrefixInherited = false;
+				isPrefixUnknown = true;
+				break;
+
+			case TokenType :: UNKNOWN_XMLNS_END_OFFSET:
+
+				xmlns(endSpan(chunkData, code));
+				break;
+
+			case TokenType :: UNKNOWN_URI_END_OFFSET:
+
+				value(endSpan(chunkData, code));
+				break;
+
+			case TokenType :: UNKNOWN_SGML_END_OFFSET:
+
+				sgml(getPrefix(), endSpan(chunkData, code));
+				break;
+
+			case TokenType :: PARTIAL_LEN:
+
+				partialLen = code;
+				break;
+
+			case TokenType :: PARTIAL_ELEMENT_ID:
+			case TokenType :: PARTIAL_ATTRIBUTE_ID:
+			case TokenType :: PARTIAL_PREFIX_ID:
+			case TokenType :: PARTIAL_URI_ID:
+
+				span = getName(static_cast<NameKind>(
+					static_cast<uint32_t>(kind) -
+					static_cast<uint32_t>(TokenType :: PARTIAL_ELEMENT_ID)
+				), code);
+
+				stash.assign(span.data, span.data + std::min<size_t>(span.len, partialLen));
+				isStashUsed = false;
+				break;
+
+			case TokenType :: DOCUMENT_END:
+
+				documentEnd();
+				resetDocument();
+				break;
+
+			case TokenType :: CHUNK_END:
+
+				// Input window will be overwritten.
+				stashSpan(chunkData, code);
+				latestSpan = Span();
+				break;
+
+			case TokenType :: INTERNED_OPEN_ELEMENT_ID:
+			case TokenType :: INTERNED_CLOSE_ELEMENT_ID:
+			case TokenType :: INTERNED_ATTRIBUTE_ID:
+			case TokenType :: INTERNED_VALUE_ID:
+
+				if(code < internedList.size()) {
+					const std::string &interned = internedList[code];
+					span = Span(reinterpret_cast<const unsigned char *>(interned.data()), interned.size());
+				}
+
+				// Name or value replaces an unknown span.
+				spanStart = -1;
+				if(kind != TokenType :: INTERNED_VALUE_ID) idName = unknownId;
+
+				if(kind == TokenType :: INTERNED_OPEN_ELEMENT_ID) openElement(getPrefix(), span);
+				else if(kind == TokenType :: INTERNED_CLOSE_ELEMENT_ID) closeElement(getPrefix(), span);
+				else if(kind == TokenType :: INTERNED_ATTRIBUTE_ID) attribute(getAttributePrefix(), span, idNamespace);
+				else value(span);
+				break;
+
+			case TokenType :: INTERN_ID:
+
+				if(code >= internedList.size()) internedList.resize(code + 1);
+				internedList[code].assign(
+					reinterpret_cast<const char *>(latestSpan.data),
+					latestSpan.len
+				);
+				break;
+
+			default:
+
+				break;
+		}
+	}
+
+	if(isChunkEnd) {
+		stashSpan(chunkData, chunkLen);
+		latestSpan = Span();
+	}
+}
+
+#include <nbind/nbind.h>
+
+#ifdef NBIND_CLASS
+
+NBIND_CLASS(TokenDecoder) {
+	method(setNames);
+	method(decode);
+}
+
+#endif
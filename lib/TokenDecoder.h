@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <nbind/api.h>
+
+#include "Parser.h"
+
+/** Base class for consuming Parser code buffers in native code, without
+  * creating JavaScript tokens. Known names are resolved from tables
+  * passed in from JavaScript, others are sliced from the input chunk. */
+
+class TokenDecoder {
+
+public:
+
+	/** Kinds of name tables. The first four are indexed by IDs in
+	  * element, attribute, prefix and URI tokens (in that order, matching
+	  * partial name tokens). NAMESPACE is indexed by namespace ID. */
+
+	enum class NameKind : uint32_t {
+		ELEMENT,
+		ATTRIBUTE,
+		PREFIX,
+		URI,
+		NAMESPACE,
+		COUNT
+	};
+
+	typedef Parser :: TokenType TokenType;
+
+	/** Value of idName for names not found in any trie. */
+	static constexpr uint32_t unknownId = ~0u;
+
+	virtual ~TokenDecoder() {}
+
+	/** Set names for IDs of one kind.
+	  * @param data Concatenated UTF-8 names.
+	  * @param ends Uint32Array with offsets just past the end of each name. */
+	bool setNames(uint32_t kind, nbind::Buffer data, nbind::Buffer ends);
+
+	/** Handle a buffer of codes written by Parser.
+	  * @param chunk Input chunk the codes refer to.
+	  * @param isChunkEnd Chunk will no longer be available after this call. */
+	void decode(nbind::Buffer codes, nbind::Buffer chunk, bool isChunkEnd);
+
+protected:
+
+	/** Reference to a name or text in the input or some internal buffer.
+	  * Only valid until the handler receiving it returns. */
+
+	struct Span {
+
+		Span(const unsigned char *data = nullptr, size_t len = 0) : data(data), len(len) {}
+
+		bool operator==(const char *other) const {
+			return(std::char_traits<char>::length(other) == len && (!len || !std::memcmp(data, other, len)));
+		}
+
+		const unsigned char *data;
+		size_t len;
+
+	};
+
+	// Handlers for different tokens, called in document order.
+
+	/** Start of an element or, with the processing prefix "?",
+	  * a processing instruction. */
+	virtual void openElement(const Span &prefix, const Span &name) = 0;
+	/** @param idNamespace Attribute namespace or 0 if the prefix was unknown. */
+	virtual void attribute(const Span &prefix, const Span &name, uint32_t idNamespace) = 0;
+	/** Namespace declaration, empty prefix for the default namespace. */
+	virtual void xmlns(const Span &prefix) = 0;
+	/** Attribute value or namespace URI after xmlns, with entities intact. */
+	virtual void value(const Span &value) = 0;
+	/** End of start tag, possibly also ending the element. */
+	virtual void startTagEnd(bool isClosed) = 0;
+	virtual void closeElement(const Span &prefix, const Span &name) = 0;
+	/** Text content with leading whitespace skipped and entities intact. */
+	virtual void text(const Span &text) = 0;
+	virtual void cdata(const Span &text) = 0;
+	virtual void comment(const Span &text) = 0;
+	/** Start of an SGML declaration like DOCTYPE. */
+	virtual void sgml(const Span &prefix, const Span &name) = 0;
+	virtual void sgmlText(const Span &text) = 0;
+	virtual void sgmlNested(bool isStart) = 0;
+	virtual void sgmlEnd() = 0;
+	virtual void documentEnd() = 0;
+
+	Span getName(NameKind kind, uint32_t id) const;
+
+	/** Token ID of the name passed to the latest openElement, closeElement
+	  * or attribute call, or unknownId. */
+	uint32_t idName = unknownId;
+
+	/** Test for a single character prefix like the processing prefix ?. */
+	static inline bool isPrefix(const Span &prefix, char c) {
+		return(prefix.len == 1 && prefix.data[0] == static_cast<unsigned char>(c));
+	}
+
+private:
+
+	/** Forget state of a document in a batch. Interned strings remain
+	  * valid because the native parser does not forget them either. */
+	void resetDocument();
+
+	void beginSpan(uint32_t start);
+
+	/** Get a complete span ending at offset end in chunk. */
+	Span endSpan(const unsigned char *chunk, uint32_t end);
+
+	/** Save an unfinished span before its chunk is invalidated. */
+	void stashSpan(const unsigned char *chunk, size_t end);
+
+	struct NameTable {
+		std::vector<unsigned char> data;
+		std::vector<uint32_t> ends;
+	};
+
+	NameTable nameTableList[static_cast<uint32_t>(NameKind :: COUNT)];
+
+	/** Start offset of the current span in chunk, or -1 if none. */
+	int64_t spanStart = -1;
+
+	/** Beginning of a span from earlier chunks or a partial name. */
+	std::vector<unsigned char> stash;
+
+	/** Stash contents were already used and can be cleared. */
+	bool isStashUsed = false;
+
+	/** Most recently completed span, to be interned by a following code. */
+	Span latestSpan;
+
+	uint32_t partialLen = 0;
+
+	/** Prefix of the next name, from the name table or an unknown prefix
+	  * stored in prefixBuffer. */
+	Span getPrefix() const;
+	/** Attributes without a prefix of their own get an empty one. */
+	Span getAttributePrefix() const;
+
+	uint32_t idPrefix = 0;
+	uint32_t idNamespace = 0;
+	bool isPrefixInherited = false;
+	bool isPrefixUnknown = false;
+	std::vector<unsigned char> prefixBuffer;
+
+	/** Contents of interned strings, indexed by ID. */
+	std::vector<std::string> internedList;
+
+};
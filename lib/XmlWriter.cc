@@ -0,0 +1,659 @@
+#include <algorithm>
+
+#include "ByteSet.h"
+#include "XmlWriter.h"
+
+namespace {
+
+/** Bytes needing escapes in canonical text and attribute values. */
+const ByteSet textSpecial("&<>\r");
+const ByteSet attributeSpecial("&<\"\t\n\r");
+/** Attribute values may have been quoted with apostrophes. */
+const ByteSet quoteSpecial("\"");
+
+const char xmlUri[] = "http://www.w3.org/XML/1998/namespace";
+const unsigned int maxIndent = 255;
+
+/** Canonical attribute values are buffered in strings for sorting. */
+
+struct StringSink {
+
+	StringSink(std::string &str) : str(str) {}
+
+	inline void put(unsigned char c) { str.push_back(static_cast<char>(c)); }
+
+	inline void write(const unsigned char *data, size_t len) {
+		str.append(reinterpret_cast<const char *>(data), len);
+	}
+
+	template <size_t len>
+	inline void write(const char (&text)[len]) { str.append(text, len - 1); }
+
+	std::string &str;
+
+};
+
+/** Decode a character or predefined entity reference after &.
+  * @return Pointer past the terminating ; or nullptr if not recognized. */
+const unsigned char *decodeEntity(const unsigned char *p, const unsigned char *end, uint32_t &code) {
+	if(p < end && *p == '#') {
+		uint32_t base = 10;
+		uint32_t digitCount = 0;
+
+		code = 0;
+		if(++p < end && *p == 'x') {
+			base = 16;
+			++p;
+		}
+
+		while(p < end && *p != ';') {
+			unsigned char c = *p++;
+			uint32_t digit;
+
+			if(c >= '0' && c <= '9') digit = c - '0';
+			else if(base == 16 && (c | 0x20) >= 'a' && (c | 0x20) <= 'f') digit = (c | 0x20) - 'a' + 10;
+			else return(nullptr);
+
+			code = code * base + digit;
+			if(code > 0x10ffff) return(nullptr);
+			++digitCount;
+		}
+
+		if(p >= end || !digitCount || !code || (code >= 0xd800 && code < 0xe000)) return(nullptr);
+
+		return(p + 1);
+	}
+
+	const unsigned char *name = p;
+
+	while(p < end && *p != ';' && p - name < 5) ++p;
+	if(p >= end || *p != ';') return(nullptr);
+
+	switch(p - name) {
+		case 2:
+			if(name[1] != 't') return(nullptr);
+			if(name[0] == 'l') code = '<';
+			else if(name[0] == 'g') code = '>';
+			else return(nullptr);
+			break;
+
+		case 3:
+			if(name[0] != 'a' || name[1] != 'm' || name[2] != 'p') return(nullptr);
+			code = '&';
+			break;
+
+		case 4:
+			if(!std::memcmp(name, "quot", 4)) code = '"';
+			else if(!std::memcmp(name, "apos", 4)) code = '\'';
+			else return(nullptr);
+			break;
+
+		default:
+			return(nullptr);
+	}
+
+	return(p + 1);
+}
+
+}
+
+template <class Sink>
+void XmlWriter :: writeCanonicalChar(Sink &sink, uint32_t code, bool isAttribute) {
+	switch(code) {
+		case '&': sink.write("&amp;"); return;
+		case '<': sink.write("&lt;"); return;
+		case '\r': sink.write("&#xD;"); return;
+
+		case '>':
+			if(isAttribute) sink.put('>');
+			else sink.write("&gt;");
+			return;
+
+		case '"':
+			if(isAttribute) sink.write("&quot;");
+			else sink.put('"');
+			return;
+
+		case '\t':
+			if(isAttribute) sink.write("&#x9;");
+			else sink.put('\t');
+			return;
+
+		case '\n':
+			if(isAttribute) sink.write("&#xA;");
+			else sink.put('\n');
+			return;
+	}
+
+	// Encode as UTF-8.
+	if(code < 0x80) {
+		sink.put(code);
+	} else if(code < 0x800) {
+		sink.put(0xc0 | (code >> 6));
+		sink.put(0x80 | (code & 0x3f));
+	} else if(code < 0x10000) {
+		sink.put(0xe0 | (code >> 12));
+		sink.put(0x80 | ((code >> 6) & 0x3f));
+		sink.put(0x80 | (code & 0x3f));
+	} else {
+		sink.put(0xf0 | (code >> 18));
+		sink.put(0x80 | ((code >> 12) & 0x3f));
+		sink.put(0x80 | ((code >> 6) & 0x3f));
+		sink.put(0x80 | (code & 0x3f));
+	}
+}
+
+/** Escape text or an attribute value for canonical output,
+  * normalizing line breaks and attribute value whitespace. */
+
+template <class Sink>
+void XmlWriter :: writeCanonical(Sink &sink, const Span &span, bool isAttribute, bool decodeEntities) {
+	const ByteSet &special = isAttribute ? attributeSpecial : textSpecial;
+	const unsigned char *p = span.data;
+	const unsigned char *end = p + span.len;
+	uint32_t code;
+
+	while(p < end) {
+		size_t len = special.skip(p, end - p);
+
+		sink.write(p, len);
+		p += len;
+		if(p >= end) break;
+
+		unsigned char c = *p++;
+
+		switch(c) {
+			case '&':
+
+				if(decodeEntities) {
+					const unsigned char *next = decodeEntity(p, end, code);
+
+					if(next) {
+						writeCanonicalChar(sink, code, isAttribute);
+						p = next;
+					} else {
+						// Entities from a DTD cannot be expanded.
+						sink.put('&');
+					}
+				} else sink.write("&amp;");
+
+				break;
+
+			case '<': sink.write("&lt;"); break;
+			case '>': sink.write("&gt;"); break;
+			case '"': sink.write("&quot;"); break;
+
+			case '\t':
+			case '\n':
+
+				// Only in attributes, where whitespace is normalized.
+				sink.put(' ');
+				break;
+
+			case '\r':
+
+				if(p < end && *p == '\n') ++p;
+				sink.put(isAttribute ? ' ' : '\n');
+				break;
+		}
+	}
+}
+
+void XmlWriter :: writeIndent() {
+	if(indent < 0) return;
+
+	output.put('\n');
+	for(int32_t num = 0; num < indent; ++num) output.put('\t');
+}
+
+void XmlWriter :: writeQualified(const Span &prefix, const Span &name) {
+	if(prefix.len) {
+		output.write(prefix.data, prefix.len);
+		output.put(':');
+	}
+
+	output.write(name.data, name.len);
+}
+
+void XmlWriter :: openElement(const Span &prefix, const Span &name) {
+	bool isProcessing = isPrefix(prefix, '?');
+
+	if(!isStarted) {
+		isStarted = true;
+
+		if(!isCanonical && !(isProcessing && name == "xml")) {
+			output.write("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n");
+		}
+	}
+
+	pending = Pending :: NONE;
+
+	if(isProcessing) {
+		if(isCanonical) {
+			if(name == "xml") {
+				state = State :: SKIP;
+				return;
+			}
+
+			if(isAfterRoot) output.put('\n');
+		} else {
+			writeIndent();
+			indent = std::min(depth, maxIndent);
+		}
+
+		output.write("<?");
+		output.write(name.data, name.len);
+
+		state = State :: PROCESSING;
+		return;
+	}
+
+	if(isCanonical) {
+		tagName.clear();
+
+		if(prefix.len) {
+			tagName.append(reinterpret_cast<const char *>(prefix.data), prefix.len);
+			tagName.push_back(':');
+		}
+
+		tagName.append(reinterpret_cast<const char *>(name.data), name.len);
+
+		attributeCount = 0;
+		declarationCount = 0;
+	} else {
+		writeIndent();
+		output.put('<');
+		writeQualified(prefix, name);
+	}
+
+	indent = std::min(++depth, maxIndent);
+	state = State :: ELEMENT;
+}
+
+void XmlWriter :: attribute(const Span &prefix, const Span &name, uint32_t idNamespace) {
+	pending = Pending :: NONE;
+
+	if(state == State :: PROCESSING) {
+		output.put(' ');
+		output.write(name.data, name.len);
+		output.put('=');
+		pending = Pending :: ATTRIBUTE;
+	} else if(state == State :: ELEMENT) {
+		if(isCanonical) {
+			if(attributeCount >= attributeList.size()) attributeList.resize(attributeCount + 1);
+			Attribute &attr = attributeList[attributeCount++];
+
+			attr.prefix.assign(reinterpret_cast<const char *>(prefix.data), prefix.len);
+			attr.name.assign(reinterpret_cast<const char *>(name.data), name.len);
+			attr.idNamespace = idNamespace;
+			attr.value.clear();
+		} else {
+			output.put(' ');
+			writeQualified(prefix, name);
+			output.put('=');
+		}
+
+		pending = Pending :: ATTRIBUTE;
+	}
+}
+
+void XmlWriter :: xmlns(const Span &prefix) {
+	pending = Pending :: NONE;
+	if(state != State :: ELEMENT) return;
+
+	if(isCanonical) {
+		if(declarationCount >= declarationList.size()) declarationList.resize(declarationCount + 1);
+		Declaration &decl = declarationList[declarationCount++];
+
+		decl.prefix.assign(reinterpret_cast<const char *>(prefix.data), prefix.len);
+		decl.uri.clear();
+	} else {
+		output.write(" xmlns");
+
+		if(prefix.len) {
+			output.put(':');
+			output.write(prefix.data, prefix.len);
+		}
+
+		output.put('=');
+	}
+
+	pending = Pending :: XMLNS;
+}
+
+void XmlWriter :: value(const Span &value) {
+	if(pending == Pending :: NONE) return;
+
+	if(isCanonical && state == State :: ELEMENT) {
+		std::string &str = (
+			pending == Pending :: ATTRIBUTE ?
+			attributeList[attributeCount - 1].value :
+			declarationList[declarationCount - 1].uri
+		);
+		StringSink sink(str);
+
+		writeCanonical(sink, value, true, true);
+	} else {
+		const unsigned char *p = value.data;
+		const unsigned char *end = p + value.len;
+
+		output.put('"');
+
+		while(p < end) {
+			size_t len = quoteSpecial.skip(p, end - p);
+
+			output.write(p, len);
+			p += len;
+
+			if(p < end) {
+				output.write("&quot;");
+				++p;
+			}
+		}
+
+		output.put('"');
+	}
+
+	pending = Pending :: NONE;
+}
+
+const std::string *XmlWriter :: findUri(const std::string &prefix) {
+	for(size_t num = declarationCount; num--;) {
+		if(declarationList[num].prefix == prefix) return(&declarationList[num].uri);
+	}
+
+	for(size_t num = scopeList.size(); num--;) {
+		if(scopeList[num].prefix == prefix) return(&scopeList[num].uri);
+	}
+
+	return(nullptr);
+}
+
+void XmlWriter :: writeStartTag() {
+	Declaration *declarations = declarationList.data();
+	Attribute *attributes = attributeList.data();
+
+	// Unprefixed attributes have no namespace. Prefixed ones are resolved
+	// using declarations, or the parser's namespace for predefined prefixes.
+	for(size_t num = 0; num < attributeCount; ++num) {
+		Attribute &attr = attributes[num];
+		const std::string *uri = nullptr;
+
+		if(attr.prefix.empty()) {
+			attr.uri.clear();
+			continue;
+		}
+
+		uri = findUri(attr.prefix);
+
+		if(uri) {
+			attr.uri = *uri;
+		} else if(attr.prefix == "xml") {
+			attr.uri = xmlUri;
+		} else {
+			Span name = getName(NameKind :: NAMESPACE, attr.idNamespace);
+			attr.uri.assign(reinterpret_cast<const char *>(name.data), name.len);
+		}
+	}
+
+	std::sort(declarations, declarations + declarationCount, [](const Declaration &a, const Declaration &b) {
+		return(a.prefix < b.prefix);
+	});
+
+	std::sort(attributes, attributes + attributeCount, [](const Attribute &a, const Attribute &b) {
+		int order = a.uri.compare(b.uri);
+		return(order < 0 || (!order && a.name < b.name));
+	});
+
+	scopeStack.push_back(scopeList.size());
+
+	output.put('<');
+	output.write(tagName.data(), tagName.size());
+
+	for(size_t num = 0; num < declarationCount; ++num) {
+		const Declaration &decl = declarations[num];
+		const std::string *uri = nullptr;
+
+		for(size_t pos = scopeList.size(); pos--;) {
+			if(scopeList[pos].prefix == decl.prefix) {
+				uri = &scopeList[pos].uri;
+				break;
+			}
+		}
+
+		// Omit declarations not changing the namespace in scope.
+		if(uri ? *uri == decl.uri : decl.prefix.empty() && decl.uri.empty()) continue;
+
+		output.write(" xmlns");
+
+		if(!decl.prefix.empty()) {
+			output.put(':');
+			output.write(decl.prefix.data(), decl.prefix.size());
+		}
+
+		output.write("=\"");
+		output.write(decl.uri.data(), decl.uri.size());
+		output.put('"');
+
+		scopeList.push_back(decl);
+	}
+
+	for(size_t num = 0; num < attributeCount; ++num) {
+		const Attribute &attr = attributes[num];
+
+		output.put(' ');
+
+		if(!attr.prefix.empty()) {
+			output.write(attr.prefix.data(), attr.prefix.size());
+			output.put(':');
+		}
+
+		output.write(attr.name.data(), attr.name.size());
+		output.write("=\"");
+		output.write(attr.value.data(), attr.value.size());
+		output.put('"');
+	}
+
+	output.put('>');
+}
+
+void XmlWriter :: startTagEnd(bool isClosed) {
+	pending = Pending :: NONE;
+
+	switch(state) {
+		case State :: SKIP:
+
+			break;
+
+		case State :: PROCESSING:
+
+			output.write("?>");
+			if(isCanonical && !depth && !isAfterRoot) output.put('\n');
+			break;
+
+		case State :: ELEMENT:
+
+			if(isCanonical) {
+				writeStartTag();
+
+				if(isClosed) {
+					// Empty elements always have end tags.
+					output.write("</");
+					output.write(tagName.data(), tagName.size());
+					output.put('>');
+
+					scopeList.resize(scopeStack.back());
+					scopeStack.pop_back();
+				}
+			} else if(isClosed) {
+				output.write("/>");
+			} else {
+				output.put('>');
+			}
+
+			if(isClosed) {
+				indent = std::min(--depth, maxIndent);
+				if(!depth) isAfterRoot = true;
+			}
+			break;
+
+		default:
+
+			break;
+	}
+
+	state = State :: TEXT;
+}
+
+void XmlWriter :: closeElement(const Span &prefix, const Span &name) {
+	if(!depth) return;
+
+	indent = std::min(--depth, maxIndent);
+
+	if(isCanonical) {
+		if(!scopeStack.empty()) {
+			scopeList.resize(scopeStack.back());
+			scopeStack.pop_back();
+		}
+	} else if(state != State :: AFTER_TEXT) {
+		writeIndent();
+	}
+
+	output.write("</");
+	writeQualified(prefix, name);
+	output.put('>');
+
+	if(!depth) isAfterRoot = true;
+	state = State :: TEXT;
+}
+
+void XmlWriter :: text(const Span &text) {
+	if(isCanonical) {
+		// Drop text outside the root element and inside DTDs.
+		if(!depth || sgmlNesting) return;
+
+		writeCanonical(output, text, false, true);
+	} else {
+		output.write(text.data, text.len);
+	}
+
+	state = State :: AFTER_TEXT;
+}
+
+void XmlWriter :: cdata(const Span &text) {
+	if(isCanonical) {
+		if(!depth) return;
+
+		writeCanonical(output, text, false, false);
+	} else {
+		output.write("<![CDATA[");
+		output.write(text.data, text.len);
+		output.write("]]>");
+	}
+
+	state = State :: AFTER_TEXT;
+}
+
+void XmlWriter :: comment(const Span &text) {
+	if(isCanonical) {
+		if(!withComments || sgmlNesting) return;
+
+		// Comments outside the root element get line breaks
+		// separating them from it.
+		if(!depth && isAfterRoot) output.put('\n');
+		output.write("<!--");
+		output.write(text.data, text.len);
+		output.write("-->");
+		if(!depth && !isAfterRoot) output.put('\n');
+	} else {
+		writeIndent();
+		output.write("<!--");
+		output.write(text.data, text.len);
+		output.write("-->");
+	}
+
+	state = State :: TEXT;
+}
+
+void XmlWriter :: sgml(const Span &prefix, const Span &name) {
+	state = State :: SGML;
+
+	// Canonical output omits the document type declaration.
+	if(isCanonical) return;
+
+	output.write(sgmlSeparator, std::strlen(sgmlSeparator));
+	writeQualified(prefix, name);
+	sgmlSeparator = " ";
+}
+
+void XmlWriter :: sgmlText(const Span &text) {
+	if(isCanonical) return;
+
+	output.write(sgmlSeparator, std::strlen(sgmlSeparator));
+	output.put('"');
+	output.write(text.data, text.len);
+	output.put('"');
+	sgmlSeparator = " ";
+}
+
+void XmlWriter :: sgmlNested(bool isStart) {
+	if(isStart) {
+		++sgmlNesting;
+
+		if(!isCanonical) {
+			output.write(sgmlSeparator, std::strlen(sgmlSeparator));
+			output.put('[');
+		}
+
+		sgmlSeparator = "<!";
+		state = State :: TEXT;
+	} else {
+		if(sgmlNesting) --sgmlNesting;
+		if(!isCanonical) output.put(']');
+
+		sgmlSeparator = " ";
+		state = State :: SGML;
+	}
+}
+
+void XmlWriter :: sgmlEnd() {
+	if(!isCanonical) output.put('>');
+
+	sgmlSeparator = "<!";
+	state = State :: TEXT;
+}
+
+void XmlWriter :: documentEnd() {
+	if(!isCanonical && isStarted) output.put('\n');
+
+	state = State :: TEXT;
+	pending = Pending :: NONE;
+	depth = 0;
+	indent = -1;
+	sgmlNesting = 0;
+	sgmlSeparator = "<!";
+	isStarted = false;
+	isAfterRoot = false;
+	scopeList.clear();
+	scopeStack.clear();
+}
+
+void XmlWriter :: end() {
+	if(isStarted) documentEnd();
+
+	output.flush();
+}
+
+#include <nbind/nbind.h>
+
+#ifdef NBIND_CLASS
+
+NBIND_CLASS(XmlWriter) {
+	inherit(TokenDecoder);
+	construct<bool, bool>();
+
+	method(setOutputBuffer);
+	method(end);
+}
+
+#endif
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "OutputBuffer.h"
+#include "TokenDecoder.h"
+
+/** Serialize XML straight from parser code buffers, copying names,
+  * text and attribute values from input. Optionally outputs Canonical
+  * XML 1.0, apart from whitespace the parser skips before text. */
+
+class XmlWriter : public TokenDecoder {
+
+public:
+
+	/** @param canonical Output Canonical XML 1.0 instead of indented XML.
+	  * @param withComments Keep comments in canonical output. */
+	XmlWriter(bool canonical, bool withComments) :
+		isCanonical(canonical), withComments(withComments) {}
+
+	void setOutputBuffer(nbind::Buffer buffer, nbind::cbFunction &flushOutput) {
+		output.setBuffer(buffer, flushOutput);
+	}
+
+	/** Finish output after all input was parsed. */
+	void end();
+
+protected:
+
+	void openElement(const Span &prefix, const Span &name) override;
+	void attribute(const Span &prefix, const Span &name, uint32_t idNamespace) override;
+	void xmlns(const Span &prefix) override;
+	void value(const Span &value) override;
+	void startTagEnd(bool isClosed) override;
+	void closeElement(const Span &prefix, const Span &name) override;
+	void text(const Span &text) override;
+	void cdata(const Span &text) override;
+	void comment(const Span &text) override;
+	void sgml(const Span &prefix, const Span &name) override;
+	void sgmlText(const Span &text) override;
+	void sgmlNested(bool isStart) override;
+	void sgmlEnd() override;
+	void documentEnd() override;
+
+private:
+
+	enum class State : uint32_t {
+		TEXT,
+		AFTER_TEXT,
+		ELEMENT,
+		PROCESSING,
+		SGML,
+		/** Inside an XML declaration omitted from canonical output. */
+		SKIP
+	};
+
+	/** Where the next attribute value goes. */
+	enum class Pending : uint32_t {
+		NONE,
+		ATTRIBUTE,
+		XMLNS
+	};
+
+	struct Attribute {
+		std::string prefix;
+		std::string name;
+		uint32_t idNamespace;
+		/** Namespace URI, resolved when the start tag ends. */
+		std::string uri;
+		std::string value;
+	};
+
+	struct Declaration {
+		std::string prefix;
+		std::string uri;
+	};
+
+	void writeIndent();
+	void writeQualified(const Span &prefix, const Span &name);
+
+	/** Write attributes and namespace declarations in canonical order. */
+	void writeStartTag();
+
+	/** Find the namespace URI bound to a prefix in canonical output. */
+	const std::string *findUri(const std::string &prefix);
+
+	template <class Sink>
+	static void writeCanonical(Sink &sink, const Span &span, bool isAttribute, bool decodeEntities);
+
+	template <class Sink>
+	static void writeCanonicalChar(Sink &sink, uint32_t code, bool isAttribute);
+
+	const bool isCanonical;
+	const bool withComments;
+
+	OutputBuffer output;
+
+	State state = State :: TEXT;
+	Pending pending = Pending :: NONE;
+
+	/** Number of open elements. */
+	uint32_t depth = 0;
+	/** Number of tabs after a line break before the next tag, or -1 for none. */
+	int32_t indent = -1;
+	/** Nesting depth of SGML declarations. */
+	uint32_t sgmlNesting = 0;
+	const char *sgmlSeparator = "<!";
+
+	bool isStarted = false;
+	/** The root element has already ended. */
+	bool isAfterRoot = false;
+
+	// Canonical start tag contents are buffered for sorting.
+
+	std::string tagName;
+	std::vector<Attribute> attributeList;
+	std::vector<Declaration> declarationList;
+	size_t attributeCount = 0;
+	size_t declarationCount = 0;
+
+	/** Rendered namespace declarations in scope. */
+	std::vector<Declaration> scopeList;
+	/** Size of scopeList before each open element. */
+	std::vector<size_t> scopeStack;
+
+};
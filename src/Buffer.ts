@@ -2,6 +2,7 @@ export declare class TextEncoder {
 	constructor(encoding: string);
 
 	encode(data: string): Uint8Array;
+	encodeInto(data: string, dest: Uint8Array): { read: number, written: number };
 	decode(data: Uint8Array): string;
 }
 
@@ -9,14 +10,21 @@ export type ArrayType = Buffer | Uint8Array;
 export let ArrayType: { new(size: number): ArrayType };
 
 export let encodeArray: (text: string) => ArrayType;
+/** Encode text as UTF-8 into an existing buffer, which must have room for
+  * 3 bytes per UTF-16 code unit. Returns number of bytes written. */
+export let encodeArrayInto: (text: string, dest: ArrayType) => number;
 export let decodeArray: (data: ArrayType, start?: number, end?: number) => string;
+/** Decode text known to be ASCII, faster where supported. */
+export let decodeAscii: (data: ArrayType, start?: number, end?: number) => string;
 export let concatArray: (list: ArrayType[], len: number) => ArrayType;
 
 if(typeof(Buffer) == 'function') {
 	ArrayType = Buffer;
 
 	encodeArray = (text: string) => new Buffer(text);
+	encodeArrayInto = (text: string, dest: ArrayType) => (dest as Buffer).write(text, 0, dest.length, 'utf-8');
 	decodeArray = (data: ArrayType, start?: number, end?: number) => (data as Buffer).toString('utf-8', start, end);
+	decodeAscii = (data: ArrayType, start?: number, end?: number) => (data as Buffer).toString('latin1', start, end);
 
 	concatArray = Buffer.concat as any;
 } else if(typeof(TextEncoder) == 'function') {
@@ -24,10 +32,13 @@ if(typeof(Buffer) == 'function') {
 
 	const encoder = new TextEncoder('utf-8');
 	encodeArray = (text: string) => encoder.encode(name);
+	encodeArrayInto = (text: string, dest: ArrayType) => encoder.encodeInto(text, dest).written;
 	decodeArray = (data: ArrayType, start?: number, end?: number) => encoder.decode(
 		(start || end || end === 0) ? data.slice(start, end) : data
 	);
 
+	decodeAscii = decodeArray;
+
 	concatArray = (list: ArrayType[], len: number) => {
 		const buf = new Uint8Array(len);
 
@@ -161,6 +161,16 @@ export class Builder {
 
 						state = State.COMMENT;
 						break;
+
+					default:
+
+						// Number lists are stored as typed arrays.
+						if(target && (state == State.TEXT || state == State.ELEMENT) && ArrayBuffer.isView(token)) {
+							item[target] = token;
+							target = void 0;
+						}
+
+						break;
 				}
 			} else {
 				switch(state) {
@@ -3,11 +3,14 @@ export { CRC32, Hasher32 } from './CRC32';
 
 import { Namespace } from './Namespace';
 export { Namespace };
-export { ParserConfig, ParserOptions, TokenTbl, Registry } from './parser/ParserConfig';
-export { Parser, ParseError } from './parser/Parser';
+export { ParserConfig, ParserOptions, TokenTbl, Registry, NumberListType } from './parser/ParserConfig';
+export { Parser, ParseError, ParserStats, CodeHandler } from './parser/Parser';
+export { ParserPool } from './parser/ParserPool';
+export { RecordExtractor, RecordField, RecordColumn, RecordBatch, ColumnType } from './parser/RecordExtractor';
 export { Builder } from './builder/Builder';
 export { Writer } from './writer/Writer';
 export { JsonWriter } from './writer/JsonWriter';
+export { NativeWriter, NativeWriterOptions } from './writer/NativeWriter';
 export { defineElement, defineAttribute, jsxElement, jsxCompile, jsxExpand } from './parser/JSX';
 export { TokenChunk } from './parser/TokenChunk';
 export { ElementMeta } from './schema/Element';
@@ -2,6 +2,17 @@ import { Buffer } from "nbind/dist/shim";
 
 export class NBindBase { free?(): void }
 
+export class JsonWriter extends TokenDecoder {
+	/** JsonWriter(); */
+	constructor();
+
+	/** void setOutputBuffer(Buffer, cbFunction &); */
+	setOutputBuffer(p0: number[] | ArrayBuffer | DataView | Uint8Array | Buffer, p1: (...args: any[]) => any): void;
+
+	/** void end(); */
+	end(): void;
+}
+
 export class Namespace extends NBindBase {
 	/** Namespace(std::string); */
 	constructor(p0: string);
@@ -35,14 +46,59 @@ export class Parser extends NBindBase {
 	/** int32_t parse(Buffer); */
 	parse(p0: number[] | ArrayBuffer | DataView | Uint8Array | Buffer): number;
 
+	/** void setPullMode(bool); */
+	setPullMode(p0: boolean): void;
+
+	/** int32_t resume(); */
+	resume(): number;
+
+	/** int32_t parseBatch(Buffer, Buffer); */
+	parseBatch(p0: number[] | ArrayBuffer | DataView | Uint8Array | Buffer, p1: number[] | ArrayBuffer | DataView | Uint8Array | Buffer): number;
+
+	/** int32_t parseCompressed(Buffer, Buffer); */
+	parseCompressed(p0: number[] | ArrayBuffer | DataView | Uint8Array | Buffer, p1: number[] | ArrayBuffer | DataView | Uint8Array | Buffer): number;
+
+	/** void setEntityExpansion(Buffer, uint32_t); */
+	setEntityExpansion(p0: number[] | ArrayBuffer | DataView | Uint8Array | Buffer, p1: number): void;
+
+	/** void setSplitDepth(uint32_t); */
+	setSplitDepth(p0: number): void;
+
+	/** void setSpanFlags(bool); */
+	setSpanFlags(p0: boolean): void;
+
+	/** void setNumberBuffer(Buffer); */
+	setNumberBuffer(p0: number[] | ArrayBuffer | DataView | Uint8Array | Buffer): void;
+
+	/** void reset(); */
+	reset(): void;
+
+	/** uint32_t snapshot(Buffer); */
+	snapshot(p0: number[] | ArrayBuffer | DataView | Uint8Array | Buffer): number;
+
+	/** bool restore(Buffer); */
+	restore(p0: number[] | ArrayBuffer | DataView | Uint8Array | Buffer): boolean;
+
+	/** void setInterning(uint32_t, uint32_t, uint32_t); */
+	setInterning(p0: number, p1: number, p2: number): void;
+
 	/** int32_t destroy(); */
 	destroy(): number;
 
+	/** std::vector<double> getStats(); */
+	getStats(): number[];
+
+	/** void resetStats(); */
+	resetStats(): void;
+
 	/** uint32_t row; -- Read-only */
 	row: number;
 
 	/** uint32_t col; -- Read-only */
 	col: number;
+
+	/** uint32_t errorOffset; -- Read-only */
+	errorOffset: number;
 }
 
 export class ParserConfig extends NBindBase {
@@ -58,6 +114,27 @@ export class ParserConfig extends NBindBase {
 	/** bool bindPrefix(uint32_t, uint32_t); */
 	bindPrefix(p0: number, p1: number): boolean;
 
+	/** uint32_t saveImage(Buffer); */
+	saveImage(p0: number[] | ArrayBuffer | DataView | Uint8Array | Buffer): number;
+
+	/** bool loadImage(Buffer, uint32_t); */
+	loadImage(p0: number[] | ArrayBuffer | DataView | Uint8Array | Buffer, p1: number): boolean;
+
+	/** bool setContentModel(Buffer); */
+	setContentModel(p0: number[] | ArrayBuffer | DataView | Uint8Array | Buffer): boolean;
+
+	/** void setFeatures(uint32_t); */
+	setFeatures(p0: number): void;
+
+	/** uint32_t getFeatures(); */
+	getFeatures(): number;
+
+	/** bool setNumberList(uint32_t, uint32_t, uint32_t); */
+	setNumberList(p0: number, p1: number, p2: number): boolean;
+
+	/** bool hasNumberLists(); */
+	hasNumberLists(): boolean;
+
 	/** void setUriTrie(Buffer); */
 	setUriTrie(p0: number[] | ArrayBuffer | DataView | Uint8Array | Buffer): void;
 
@@ -65,6 +142,29 @@ export class ParserConfig extends NBindBase {
 	setPrefixTrie(p0: number[] | ArrayBuffer | DataView | Uint8Array | Buffer): void;
 }
 
+export class ParserPool extends NBindBase {
+	/** ParserPool(uint32_t); */
+	constructor(p0: number);
+
+	/** uint32_t add(Parser *, Buffer); */
+	add(p0: Parser | null, p1: number[] | ArrayBuffer | DataView | Uint8Array | Buffer): number;
+
+	/** void resume(uint32_t); */
+	resume(p0: number): void;
+
+	/** uint32_t wait(); */
+	wait(): number;
+
+	/** int32_t getStatus(uint32_t); */
+	getStatus(p0: number): number;
+
+	/** uint32_t getPendingCount(); */
+	getPendingCount(): number;
+
+	/** void stop(); */
+	stop(): void;
+}
+
 export class Patricia extends NBindBase {
 	/** Patricia(); */
 	constructor();
@@ -74,4 +174,49 @@ export class Patricia extends NBindBase {
 
 	/** uint32_t find(const char *); */
 	find(p0: string): number;
+
+	/** uint32_t findMany(Buffer, Buffer, Buffer); */
+	findMany(p0: number[] | ArrayBuffer | DataView | Uint8Array | Buffer, p1: number[] | ArrayBuffer | DataView | Uint8Array | Buffer, p2: number[] | ArrayBuffer | DataView | Uint8Array | Buffer): number;
+}
+
+export class RecordExtractor extends TokenDecoder {
+	/** RecordExtractor(uint32_t); */
+	constructor(p0: number);
+
+	/** int32_t addColumn(uint32_t, uint32_t, uint32_t); */
+	addColumn(p0: number, p1: number, p2: number): number;
+
+	/** uint32_t getRowCount(); */
+	getRowCount(): number;
+
+	/** uint32_t getNullCount(uint32_t); */
+	getNullCount(p0: number): number;
+
+	/** uint32_t getColumnSize(uint32_t, uint32_t); */
+	getColumnSize(p0: number, p1: number): number;
+
+	/** uint32_t readColumn(uint32_t, uint32_t, Buffer); */
+	readColumn(p0: number, p1: number, p2: number[] | ArrayBuffer | DataView | Uint8Array | Buffer): number;
+
+	/** void clear(); */
+	clear(): void;
+}
+
+export class TokenDecoder extends NBindBase {
+	/** bool setNames(uint32_t, Buffer, Buffer); */
+	setNames(p0: number, p1: number[] | ArrayBuffer | DataView | Uint8Array | Buffer, p2: number[] | ArrayBuffer | DataView | Uint8Array | Buffer): boolean;
+
+	/** void decode(Buffer, Buffer, bool); */
+	decode(p0: number[] | ArrayBuffer | DataView | Uint8Array | Buffer, p1: number[] | ArrayBuffer | DataView | Uint8Array | Buffer, p2: boolean): void;
+}
+
+export class XmlWriter extends TokenDecoder {
+	/** XmlWriter(bool, bool); */
+	constructor(p0: boolean, p1: boolean);
+
+	/** void setOutputBuffer(Buffer, cbFunction &); */
+	setOutputBuffer(p0: number[] | ArrayBuffer | DataView | Uint8Array | Buffer, p1: (...args: any[]) => any): void;
+
+	/** void end(); */
+	end(): void;
 }
@@ -0,0 +1,74 @@
+import { ArrayType, encodeArray } from '../Buffer';
+import { ParserConfig } from './ParserConfig';
+import { NativeTokenDecoder } from './ParserLib';
+
+/** Name tables in the native decoder, by kind of ID. */
+const enum NameKind {
+	ELEMENT = 0,
+	ATTRIBUTE,
+	PREFIX,
+	URI,
+	NAMESPACE
+}
+
+/** Keeps name tables of a native token decoder in sync with a config. */
+
+export class NativeNames {
+
+	constructor(private native: NativeTokenDecoder) {}
+
+	/** Send any names added to the parser config to native code. */
+	update(config: ParserConfig) {
+		const countList = this.nameCountList;
+
+		const spaceList = [
+			config.elementSpace.list,
+			config.attributeSpace.list,
+			config.prefixSpace.list,
+			config.uriSpace.list
+		];
+
+		for(let kind = NameKind.ELEMENT; kind <= NameKind.URI; ++kind) {
+			const list = spaceList[kind];
+
+			if(list.length != countList[kind]) {
+				countList[kind] = list.length;
+				this.sendNames(kind, list.map((token) => token && token.buf));
+			}
+		}
+
+		const namespaceList = config.namespaceList;
+
+		if(namespaceList.length != countList[NameKind.NAMESPACE]) {
+			countList[NameKind.NAMESPACE] = namespaceList.length;
+			this.sendNames(NameKind.NAMESPACE, namespaceList.map((ns) => ns && encodeArray(ns.base.uri)));
+		}
+	}
+
+	private sendNames(kind: NameKind, bufList: (ArrayType | undefined)[]) {
+		const count = bufList.length;
+		const ends = new Uint32Array(count);
+		let len = 0;
+
+		for(let num = 0; num < count; ++num) {
+			if(bufList[num]) len += bufList[num]!.length;
+			ends[num] = len;
+		}
+
+		const data = new ArrayType(len);
+		len = 0;
+
+		for(let buf of bufList) {
+			if(buf) {
+				data.set(buf, len);
+				len += buf.length;
+			}
+		}
+
+		this.native.setNames(kind, data, ends);
+	}
+
+	/** Number of names already sent to native code, by kind. */
+	private nameCountList = [ 0, 0, 0, 0, 0 ];
+
+}
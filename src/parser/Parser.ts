@@ -1,9 +1,9 @@
-import { ArrayType, encodeArray } from '../Buffer';
+import { ArrayType, encodeArray, encodeArrayInto, decodeArray } from '../Buffer';
 import { Namespace } from '../Namespace';
-import { CodeType } from '../tokenizer/CodeType';
+import { CodeType, SpanFlag } from '../tokenizer/CodeType';
 import { ErrorType } from '../tokenizer/ErrorType';
-import { NativeParser } from './ParserLib';
-import { ParserConfig } from './ParserConfig';
+import { NativeParser, NativeParserPool } from './ParserLib';
+import { ParserConfig, NumberListType } from './ParserConfig';
 import { ParserNamespace } from './ParserNamespace';
 import { InternalToken } from './InternalToken';
 import { TokenSet } from '../tokenizer/TokenSet';
@@ -12,6 +12,7 @@ import { Stitcher } from './Stitcher';
 import {
 	Token,
 	TokenBuffer,
+	NumberList,
 	TokenKind,
 	SpecialToken,
 	MemberToken,
@@ -25,16 +26,63 @@ import {
 // const codeBufferSize = 3;
 const codeBufferSize = 8192;
 
-const chunkSize = Infinity;
+// Token offsets to input chunks must fit in 32 - TOKEN.SHIFT bits.
+// Staying a bit lower keeps bit 31 of codes clear, so they never turn
+// negative in signed arithmetic.
+const chunkSize = 1 << 25;
+
+// Decompressed input is parsed in windows small enough to stay in cache.
+const inflateWindowSize = 65536;
 
 const enum TOKEN {
-	SHIFT = 5,
-	MASK = 31
+	SHIFT = 6,
+	MASK = 63
+}
+
+/** Counters from a native parser compiled with PARSER_STATS.
+  * Arrays are indexed by native state, CodeType, flush cause
+  * (buffer full, unknown prefix, unknown xmlns prefix, unknown URI,
+  * input window, number buffer) and trie (element, attribute, prefix, URI). */
+
+export interface ParserStats {
+	stateBytes: number[];
+	stateTransitions: number;
+	tokenCount: number[];
+	flushCount: number[];
+	trieHits: number[];
+	trieMisses: number[];
+	partialNameSlowPath: number;
+	maxElementDepth: number;
+	maxPrefixDepth: number;
+}
+
+/** Consumer of raw code buffers, called with the input chunk they refer to.
+  * isChunkEnd signals the chunk will not be referenced again. */
+
+export type CodeHandler = (codeBuffer: Uint32Array, chunk: ArrayType, isChunkEnd: boolean) => void;
+
+/** Concatenate parts of a number list split by a full number buffer. */
+
+function joinNumbers(partList: NumberList[]) {
+	let len = 0;
+
+	for(let part of partList) len += part.length;
+
+	const result = partList[0] instanceof Int32Array ? new Int32Array(len) : new Float64Array(len);
+	len = 0;
+
+	for(let part of partList) {
+		(result as Float64Array).set(part, len);
+		len += part.length;
+	}
+
+	return(result);
 }
 
 export class ParseError extends Error {
 
-	constructor(public code: ErrorType, public row: number, public col: number) {
+	/** @param offset Byte offset of invalid UTF-8 in the latest input chunk. */
+	constructor(public code: ErrorType, public row: number, public col: number, public offset?: number) {
 		super('Parse error on line ' + row + ' column ' + col);
 	}
 
@@ -51,6 +99,32 @@ export class Parser {
 	constructor(private config: ParserConfig, private native: NativeParser) {
 		this.codeBuffer = new Uint32Array(codeBufferSize);
 		this.native.setCodeBuffer(this.codeBuffer, () => this.parseCodeBuffer(true));
+		this.native.setPullMode(true);
+
+		const options = config.options;
+
+		this.native.setInterning(
+			options.internNames === void 0 ? 4096 : options.internNames,
+			options.internValues || 0,
+			options.internValueLength === void 0 ? 32 : options.internValueLength
+		);
+
+		if(options.splitDepth) this.native.setSplitDepth(options.splitDepth);
+		if(options.spanFlags === false) this.disableSpanFlags();
+
+		if(options.expandEntities) {
+			this.entityBuffer = new ArrayType(options.entityMaxBytes || (1 << 20));
+			this.native.setEntityExpansion(
+				this.entityBuffer,
+				options.entityMaxDepth === void 0 ? 8 : options.entityMaxDepth
+			);
+		}
+
+		if(config.hasNumberLists()) {
+			// Lists are aligned for creating typed array views.
+			this.numberBuffer = new ArrayBuffer((options.numberBufferSize || (1 << 20)) & ~7);
+			this.native.setNumberBuffer(new Uint8Array(this.numberBuffer));
+		}
 
 		for(let ns of this.config.namespaceList) {
 			if(ns && (ns.base.isSpecial || ns.base.defaultPrefix == 'xml')) {
@@ -61,10 +135,88 @@ export class Parser {
 
 	public getConfig() { return(this.config); }
 
+	/** Pass code buffers to a native consumer like XmlWriter instead of
+	  * creating tokens. Only namespace prefixes and URIs are still handled
+	  * in JavaScript, keeping the configuration in sync. */
+	public setCodeHandler(handler: CodeHandler) {
+		this.codeHandler = handler;
+
+		// Native consumers read number lists as text and ignore span flags.
+		if(this.numberBuffer) this.native.setNumberBuffer(new ArrayType(0));
+		this.disableSpanFlags();
+	}
+
 	bindPrefix(prefix: InternalToken, uri: InternalToken) {
 		this.native.bindPrefix(prefix.id, uri.id);
 	}
 
+	private disableSpanFlags() {
+		this.native.setSpanFlags(false);
+		this.spanFlagsDefault = SpanFlag.NON_ASCII | SpanFlag.CARRIAGE_RETURN;
+		this.spanFlags = this.spanFlagsDefault;
+	}
+
+	/** Get native parser statistics, or null if they were compiled out. */
+	public getStats(): ParserStats | null {
+		const list = this.native.getStats();
+		if(!list.length) return(null);
+
+		const [ stateCount, kindCount, causeCount, trieCount ] = list;
+		let pos = 4;
+
+		return({
+			stateBytes: list.slice(pos, pos += stateCount),
+			stateTransitions: list[pos++],
+			tokenCount: list.slice(pos, pos += kindCount),
+			flushCount: list.slice(pos, pos += causeCount),
+			trieHits: list.slice(pos, pos += trieCount),
+			trieMisses: list.slice(pos, pos += trieCount),
+			partialNameSlowPath: list[pos++],
+			maxElementDepth: list[pos++],
+			maxPrefixDepth: list[pos++]
+		});
+	}
+
+	public resetStats() {
+		this.native.resetStats();
+	}
+
+	/** Serialize parser state between calls to write, to checkpoint a huge
+	  * stream and later resume parsing from the next byte offset.
+	  * @return Snapshot, or null if state cannot be saved at this point,
+	  * such as inside an element start tag or a partial string. With
+	  * expandEntities, always null after the DTD declared any entity. */
+	public snapshot() {
+		// Partially parsed elements and strings are held in JavaScript.
+		if(this.hasError || this.elementStart >= 0 || this.partStart >= 0 || this.stitcher.hasParts()) {
+			return(null);
+		}
+
+		const len = this.native.snapshot(new ArrayType(0));
+		if(!len) return(null);
+
+		const data = new ArrayType(len);
+		this.native.snapshot(data);
+
+		return(data);
+	}
+
+	/** Restore state from snapshot, in a parser created from an identical
+	  * config. Namespaces and names added to the config while parsing
+	  * must also be defined again before restoring.
+	  * @return False if data is invalid, leaving the parser reset. */
+	public restore(data: ArrayType) {
+		this.stitcher.discard();
+		this.elementStart = -1;
+		this.partStart = -1;
+		this.unknownCount = 0;
+		this.internedList = [];
+		this.numberPartList.length = 0;
+		this.hasError = void 0;
+
+		return(this.native.restore(data));
+	}
+
 	public parseSync(data: string | ArrayType) {
 		const buffer: TokenBuffer = [];
 		let namespaceList: (Namespace | undefined)[] | undefined;
@@ -87,6 +239,32 @@ export class Parser {
 		return(output);
 	}
 
+	/** Parse many small, complete documents with a single native call.
+	  * Throws if an offset in ends is invalid or data is 32 MiB or more.
+	  * @param data Documents concatenated together.
+	  * @param ends Offset just past the end of each document in data.
+	  * @return Tokens or a parse error for each document. */
+
+	public parseBatch(data: ArrayType, ends: Uint32Array) {
+		if(data.length >= chunkSize) throw(new Error('Batch too large for a single call'));
+
+		const result: (TokenChunk | ParseError)[] = [];
+
+		this.batchResult = result;
+		this.chunk = data;
+		this.stitcher.setChunk(data);
+
+		const nativeStatus = this.native.parseBatch(data, ends);
+
+		// Every document is complete so no strings remain pending.
+		this.parseCodeBuffer(true);
+		this.batchResult = void 0;
+
+		if(nativeStatus != ErrorType.OK) throw(new ParseError(nativeStatus, 0, 0));
+
+		return(result);
+	}
+
 	destroy(
 		flush: (err: any, chunk: TokenChunk | null) => void
 	) {
@@ -111,33 +289,151 @@ export class Parser {
 			return;
 		}
 
-		if(typeof(chunk) == 'string') chunk = encodeArray(chunk);
+		let isReused = false;
+
+		if(typeof(chunk) == 'string') {
+			// UTF-8 takes at most 3 bytes per UTF-16 code unit.
+			const maxLen = chunk.length * 3;
+
+			if(maxLen < chunkSize) {
+				// Transcode into a reusable buffer to avoid allocating.
+				if(!this.stringBuffer || this.stringBuffer.length < maxLen) {
+					this.stringBuffer = new ArrayType(Math.max(maxLen, 65536));
+				}
+
+				const stringBuffer = this.stringBuffer;
+				chunk = stringBuffer.subarray(0, encodeArrayInto(chunk, stringBuffer));
+				isReused = true;
+			} else chunk = encodeArray(chunk);
+		}
 
 		const len = chunk.length;
 		let nativeStatus = ErrorType.OK;
+		let chunkStart = 0;
 		let next: number;
 
 		if(len < chunkSize) {
 			this.chunk = chunk;
-			this.stitcher.setChunk(this.chunk);
-			nativeStatus = this.native.parse(this.chunk);
+			this.stitcher.setChunk(this.chunk, isReused);
+			nativeStatus = this.parseChunk(this.chunk);
 			this.parseCodeBuffer(false);
 		} else {
 			// Limit size of buffers sent to native code.
 			for(let pos = 0; pos < len; pos = next) {
 				next = Math.min(pos + chunkSize, len);
+				chunkStart = pos;
 
 				this.chunk = chunk.slice(pos, next);
 				this.stitcher.setChunk(this.chunk);
-				nativeStatus = this.native.parse(this.chunk);
+				nativeStatus = this.parseChunk(this.chunk);
 
 				if(nativeStatus != ErrorType.OK) break;
 				this.parseCodeBuffer(false);
 			}
 		}
 
+		this.flushWrite(
+			nativeStatus,
+			nativeStatus == ErrorType.INVALID_UTF8 ? chunkStart + this.native.errorOffset : void 0,
+			flush
+		);
+	}
+
+	/** Parse gzip or zlib compressed input. Decompression happens in native
+	  * code, so a whole compressed file can be parsed in a single call. */
+
+	writeCompressed(
+		chunk: ArrayType,
+		flush: (err: any, chunk: TokenChunk | null) => void
+	) {
+		if(this.hasError) {
+			flush(this.hasError, null);
+			return;
+		}
+
+		if(!this.inflateWindow) this.inflateWindow = new ArrayType(inflateWindowSize);
+
+		// Native code reports valid window contents using CHUNK_END tokens.
+		this.chunk = this.inflateWindow;
+		this.stitcher.setChunk(this.chunk, true);
+
+		const nativeStatus = this.native.parseCompressed(chunk, this.inflateWindow);
+
+		// Partial strings were already stored at the last CHUNK_END.
+		this.parseCodeBuffer(true);
+		this.flushWrite(nativeStatus, void 0, flush);
+	}
+
+	/** Queue a complete document for parsing in a native thread pool.
+	  * @return Job number in the pool. */
+
+	startPooled(pool: NativeParserPool, data: ArrayType) {
+		if(data.length >= chunkSize) throw(new Error('Document too large for a parser pool'));
+
+		this.chunk = data;
+		this.stitcher.setChunk(data);
+		this.isPooled = true;
+
+		const jobNum = pool.add(this.native, data);
+
+		// Must equal ParserPool :: noJob on C++ side.
+		if(jobNum == 0xffffffff) throw(new Error('Code buffer too small for a parser pool'));
+
+		return(jobNum);
+	}
+
+	/** Read tokens after a pool job stopped, passing them to flush
+	  * like write and destroy would.
+	  * @return False if the job must be resumed to parse further. */
+
+	continuePooled(
+		nativeStatus: ErrorType,
+		flush: (err: any, chunk: TokenChunk | null) => void
+	) {
+		if(nativeStatus == ErrorType.BUFFER_FULL) {
+			this.parseCodeBuffer(true);
+			return(false);
+		}
+
+		if(nativeStatus == ErrorType.OK) this.parseCodeBuffer(false);
+
+		this.flushWrite(
+			nativeStatus,
+			nativeStatus == ErrorType.INVALID_UTF8 ? this.native.errorOffset : void 0,
+			flush
+		);
+
+		if(!this.hasError) this.destroy(flush);
+
+		return(true);
+	}
+
+	/** Parse input in pull mode, reading full code buffers between native
+	  * calls instead of in callbacks from inside the parser. */
+
+	private parseChunk(chunk: ArrayType) {
+		let nativeStatus: ErrorType = this.native.parse(chunk);
+
+		while(nativeStatus == ErrorType.BUFFER_FULL) {
+			this.parseCodeBuffer(true);
+			nativeStatus = this.native.resume();
+		}
+
+		return(nativeStatus);
+	}
+
+	private flushWrite(
+		nativeStatus: ErrorType,
+		errorOffset: number | undefined,
+		flush: (err: any, chunk: TokenChunk | null) => void
+	) {
 		if(nativeStatus != ErrorType.OK) {
-			this.hasError = new ParseError(nativeStatus, this.native.row + 1, this.native.col + 1);
+			this.hasError = new ParseError(
+				nativeStatus,
+				this.native.row + 1,
+				this.native.col + 1,
+				errorOffset
+			);
 			flush(this.hasError, null);
 			return;
 		}
@@ -154,6 +450,11 @@ export class Parser {
 	}
 
 	private parseCodeBuffer(pending: boolean) {
+		if(this.codeHandler) {
+			this.parseRawCodes(pending, this.codeHandler);
+			return;
+		}
+
 		const config = this.config;
 		const stitcher = this.stitcher;
 		const codeBuffer = this.codeBuffer;
@@ -173,24 +474,33 @@ export class Parser {
 		let latestPrefix = this.latestPrefix;
 		let latestNamespace = this.latestNamespace;
 
-		const tokenBuffer = this.tokenChunk.buffer;
+		let tokenBuffer = this.tokenChunk.buffer;
 		const prefixBuffer = this.prefixBuffer;
 		const namespaceBuffer = this.namespaceBuffer;
 		const unknownElementTbl = this.unknownElementTbl;
 		const unknownAttributeTbl = this.unknownAttributeTbl;
 		const sgmlTbl = this.sgmlTbl;
 		const unknownOffsetList = this.unknownOffsetList;
+		const internedList = this.internedList;
 		let tokenNum = this.tokenChunk.length - 1;
 		let token: Token;
 		let name: string;
 		let prefix: string;
 		let elementStart = this.elementStart;
 		let unknownCount = this.unknownCount;
+		let spanFlags = this.spanFlags;
+		const spanFlagsDefault = this.spanFlagsDefault;
+		let numberType = this.numberType;
+		const numberPartList = this.numberPartList;
+		// Native code starts new entity and number buffers with every
+		// code buffer.
+		let expandStart = 0;
+		let numberPos = 0;
 
 		while(codeNum < codeCount) {
 			let code = codeBuffer[++codeNum];
 			const kind = code & TOKEN.MASK;
-			code >>= TOKEN.SHIFT;
+			code >>>= TOKEN.SHIFT;
 
 			switch(kind) {
 				case CodeType.OPEN_ELEMENT_ID:
@@ -252,7 +562,8 @@ export class Parser {
 				case CodeType.PREFIX_ID:
 
 					latestNamespace = config.namespaceList[code >> 14];
-					code = code & 0x3fff;
+					// Bit 13 flags attributes inheriting their element prefix.
+					code = code & 0x1fff;
 
 				// Fallthru
 				case CodeType.XMLNS_ID:
@@ -294,13 +605,18 @@ export class Parser {
 					break;
 
 				case CodeType.UNKNOWN_OPEN_ELEMENT_END_OFFSET:
+				case CodeType.INTERNED_OPEN_ELEMENT_ID:
 
-					name = stitcher.getSlice(partStart, code);
-					latestElement = unknownElementTbl[name];
+					if(kind == CodeType.INTERNED_OPEN_ELEMENT_ID) {
+						latestElement = internedList[code] as OpenToken;
+					} else {
+						name = stitcher.getSlice(partStart, code);
+						latestElement = unknownElementTbl[name];
 
-					if(!latestElement) {
-						latestElement = new OpenToken(name, Namespace.unknown);
-						unknownElementTbl[name] = latestElement;
+						if(!latestElement) {
+							latestElement = new OpenToken(name, Namespace.unknown);
+							unknownElementTbl[name] = latestElement;
+						}
 					}
 
 					tokenBuffer[++tokenNum] = latestElement;
@@ -324,14 +640,26 @@ export class Parser {
 					partStart = -1;
 					break;
 
+				case CodeType.INTERNED_CLOSE_ELEMENT_ID:
+
+					tokenBuffer[++tokenNum] = internedList[code];
+
+					partStart = -1;
+					break;
+
 				case CodeType.UNKNOWN_ATTRIBUTE_END_OFFSET:
+				case CodeType.INTERNED_ATTRIBUTE_ID:
 
-					name = stitcher.getSlice(partStart, code);
-					token = unknownAttributeTbl[name];
+					if(kind == CodeType.INTERNED_ATTRIBUTE_ID) {
+						token = internedList[code] as Token;
+					} else {
+						name = stitcher.getSlice(partStart, code);
+						token = unknownAttributeTbl[name];
 
-					if(!token) {
-						token = new StringToken(name, Namespace.unknown);
-						unknownAttributeTbl[name] = token;
+						if(!token) {
+							token = new StringToken(name, Namespace.unknown);
+							unknownAttributeTbl[name] = token;
+						}
 					}
 
 					tokenBuffer[++tokenNum] = token;
@@ -367,7 +695,17 @@ export class Parser {
 					tokenBuffer[++tokenNum] = this.specialTokenTbl[kind];
 					break;
 
+				case CodeType.SPAN_FLAGS:
+
+					spanFlags = code;
+					break;
+
 				case CodeType.COMMENT_END_OFFSET:
+
+					// Comments are not scanned for flags.
+					spanFlags = SpanFlag.NON_ASCII | SpanFlag.CARRIAGE_RETURN;
+
+				// Fallthru
 				case CodeType.SGML_TEXT_END_OFFSET:
 
 					tokenBuffer[++tokenNum] = this.specialTokenTbl[kind];
@@ -376,8 +714,34 @@ export class Parser {
 				case CodeType.VALUE_END_OFFSET:
 				case CodeType.TEXT_END_OFFSET:
 
-					tokenBuffer[++tokenNum] = stitcher.getSlice(partStart, code);
+					tokenBuffer[++tokenNum] = stitcher.getSlice(partStart, code, spanFlags);
 					partStart = -1;
+					spanFlags = spanFlagsDefault;
+					break;
+
+				case CodeType.INTERNED_VALUE_ID:
+
+					tokenBuffer[++tokenNum] = internedList[code];
+					partStart = -1;
+					spanFlags = spanFlagsDefault;
+					break;
+
+				case CodeType.INTERN_ID:
+
+					// Remember the previous token (already decoded from input)
+					// to be referenced by ID in the future.
+					internedList[code] = tokenBuffer[tokenNum] as Token | string;
+					break;
+
+				case CodeType.EXPANDED_END_OFFSET:
+
+					// Replace the latest string with its expanded version.
+					tokenBuffer[tokenNum] = decodeArray(
+						this.entityBuffer!,
+						expandStart,
+						code
+					).replace(/\r\n?|\n\r/g, '\n');
+					expandStart = code;
 					break;
 
 				case CodeType.CDATA_END_OFFSET:
@@ -460,6 +824,90 @@ export class Parser {
 					partialList = elementList;
 					break;
 
+				case CodeType.DOCUMENT_ERROR_ROW:
+
+					this.batchErrorRow = code;
+					break;
+
+				case CodeType.DOCUMENT_ERROR_COL:
+
+					this.batchErrorCol = code;
+					break;
+
+				case CodeType.DOCUMENT_END:
+
+					if(code != ErrorType.OK) {
+						this.batchResult!.push(new ParseError(code, this.batchErrorRow + 1, this.batchErrorCol + 1));
+					} else {
+						this.tokenChunk.length = tokenNum + 1;
+						if(this.namespacesChanged) this.tokenChunk.namespaceList = this.namespaceList;
+						this.batchResult!.push(this.tokenChunk);
+
+						this.tokenChunk = TokenChunk.allocate();
+						tokenBuffer = this.tokenChunk.buffer;
+					}
+
+					// Native parser state was reset for the next document.
+					tokenNum = -1;
+					partStart = -1;
+					spanFlags = spanFlagsDefault;
+					latestPrefix = null;
+					latestNamespace = null;
+					elementStart = -1;
+					unknownCount = 0;
+					numberPartList.length = 0;
+					break;
+
+				case CodeType.RECORD_START_OFFSET:
+
+					tokenBuffer[++tokenNum] = SpecialToken.record;
+					partStart = code;
+					break;
+
+				case CodeType.RECORD_PREFIX_ID:
+
+					tokenBuffer[++tokenNum] = prefixList[code & 0x1fff].prefix;
+					tokenBuffer[++tokenNum] = config.namespaceList[code >> 14].uriToken;
+					break;
+
+				case CodeType.RECORD_END_OFFSET:
+
+					// Native code skipped the opening <
+					tokenBuffer[++tokenNum] = '<' + stitcher.getSlice(partStart, code, SpanFlag.NON_ASCII);
+					partStart = -1;
+					break;
+
+				case CodeType.NUMBER_LIST_START:
+
+					numberType = code;
+					numberPos = (numberPos + 7) & ~7;
+					break;
+
+				case CodeType.NUMBER_LIST_PART_OFFSET:
+				case CodeType.NUMBER_LIST_END_OFFSET:
+
+					numberPartList.push(this.readNumbers(numberType, numberPos, code));
+					numberPos = code;
+
+					if(kind == CodeType.NUMBER_LIST_END_OFFSET) {
+						tokenBuffer[++tokenNum] = (
+							numberPartList.length == 1 ?
+							numberPartList[0] :
+							joinNumbers(numberPartList)
+						);
+						numberPartList.length = 0;
+					}
+					break;
+
+				case CodeType.CHUNK_END:
+
+					// Input buffer will be overwritten, so store any partial string.
+					if(partStart >= 0) {
+						stitcher.storeSlice(partStart, code);
+						partStart = 0;
+					}
+					break;
+
 				default:
 
 					break;
@@ -472,8 +920,9 @@ export class Parser {
 		}
 
 		// NOTE: Any active cursor in native code will still use the old trie
-		// after update.
-		config.updateNamespaces();
+		// after update. Pooled parsers share tries with others running
+		// meanwhile, so ParserPool updates them after all jobs finish.
+		if(!this.isPooled) config.updateNamespaces();
 
 		this.partStart = partStart;
 		this.partialLen = partialLen;
@@ -484,6 +933,140 @@ export class Parser {
 		this.tokenChunk.length = tokenNum + 1;
 		this.elementStart = elementStart;
 		this.unknownCount = unknownCount;
+		this.spanFlags = spanFlags;
+		this.numberType = numberType;
+	}
+
+	/** Copy numbers decoded into the native number buffer. */
+	private readNumbers(type: NumberListType, start: number, end: number): NumberList {
+		const data = this.numberBuffer!.slice(start, end);
+
+		return(type == NumberListType.INT32 ? new Int32Array(data) : new Float64Array(data));
+	}
+
+	/** Handle new namespace prefixes and URIs in codes, without creating
+	  * tokens. Then pass the codes to a handler. */
+	private parseRawCodes(pending: boolean, handler: CodeHandler) {
+		const config = this.config;
+		const stitcher = this.stitcher;
+		const codeBuffer = this.codeBuffer;
+		const codeCount = codeBuffer[0];
+
+		let prefixList = config.prefixSpace.list;
+		let uriList = config.uriSpace.list;
+		let codeNum = 0;
+		let partStart = this.partStart;
+		let partialLen = this.partialLen;
+		let latestPrefix = this.latestPrefix;
+
+		while(codeNum < codeCount) {
+			let code = codeBuffer[++codeNum];
+			const kind = code & TOKEN.MASK;
+			code >>>= TOKEN.SHIFT;
+
+			switch(kind) {
+				case CodeType.PREFIX_ID:
+
+					code = code & 0x1fff;
+
+				// Fallthru
+				case CodeType.XMLNS_ID:
+
+					latestPrefix = prefixList[code];
+					break;
+
+				case CodeType.NAMESPACE_ID:
+
+					latestPrefix = null;
+					break;
+
+				case CodeType.UNKNOWN_START_OFFSET:
+
+					partStart = code;
+					break;
+
+				case CodeType.UNKNOWN_PREFIX_END_OFFSET:
+				case CodeType.UNKNOWN_XMLNS_END_OFFSET:
+
+					// This may unlink the config:
+					latestPrefix = config.addPrefix(stitcher.getSlice(partStart, code));
+					this.native.setPrefix(latestPrefix.id);
+
+					prefixList = config.prefixSpace.list;
+					uriList = config.uriSpace.list;
+					partStart = -1;
+					break;
+
+				case CodeType.UNKNOWN_URI_END_OFFSET:
+
+					const name = latestPrefix!.name;
+					const ns = new Namespace(name, stitcher.getSlice(partStart, code), config.maxNamespace + 1);
+					// This may unlink the config:
+					config.bindNamespace(ns, name, this);
+
+					prefixList = config.prefixSpace.list;
+					uriList = config.uriSpace.list;
+					latestPrefix = null;
+					partStart = -1;
+					break;
+
+				case CodeType.UNKNOWN_OPEN_ELEMENT_END_OFFSET:
+				case CodeType.UNKNOWN_CLOSE_ELEMENT_END_OFFSET:
+				case CodeType.UNKNOWN_ATTRIBUTE_END_OFFSET:
+				case CodeType.UNKNOWN_SGML_END_OFFSET:
+				case CodeType.INTERNED_OPEN_ELEMENT_ID:
+				case CodeType.INTERNED_CLOSE_ELEMENT_ID:
+				case CodeType.INTERNED_ATTRIBUTE_ID:
+
+					// Names are decoded by the handler.
+					stitcher.discard();
+					partStart = -1;
+					break;
+
+				case CodeType.PARTIAL_LEN:
+
+					partialLen = code;
+					break;
+
+				case CodeType.PARTIAL_PREFIX_ID:
+				case CodeType.PARTIAL_URI_ID:
+
+					stitcher.reset((kind == CodeType.PARTIAL_URI_ID ? uriList : prefixList)[code].buf, partialLen);
+					break;
+
+				case CodeType.DOCUMENT_END:
+
+					stitcher.discard();
+					partStart = -1;
+					latestPrefix = null;
+					break;
+
+				case CodeType.CHUNK_END:
+
+					if(partStart >= 0) {
+						stitcher.storeSlice(partStart, code);
+						partStart = 0;
+					}
+					break;
+
+				default:
+
+					break;
+			}
+		}
+
+		if(!pending && partStart >= 0) {
+			stitcher.storeSlice(partStart);
+			partStart = 0;
+		}
+
+		if(!this.isPooled) config.updateNamespaces();
+
+		this.partStart = partStart;
+		this.partialLen = partialLen;
+		this.latestPrefix = latestPrefix;
+
+		handler(codeBuffer, this.chunk, !pending);
 	}
 
 	/** Resolve any prior occurrences of a recently defined prefix
@@ -513,6 +1096,7 @@ export class Parser {
 	}
 
 	private stitcher = new Stitcher();
+	private codeHandler?: CodeHandler;
 
 	/** Current element not yet emitted (closing angle bracket unseen). */
 	private latestElement: OpenToken;
@@ -523,12 +1107,30 @@ export class Parser {
 
 	/** Current input buffer. */
 	private chunk: ArrayType;
+	/** Reusable storage for UTF-8 encoded string input. */
+	private stringBuffer?: ArrayType;
+	/** Reusable storage for decompressed input. */
+	private inflateWindow?: ArrayType;
+	/** Text with entities expanded, written by native code. */
+	private entityBuffer?: ArrayType;
 
 	private namespaceList: (Namespace | undefined)[] = [];
 	private namespacesChanged = true;
 
 	/** Offset to start of text in input buffer, or -1 if not reading text. */
 	private partStart = -1;
+	/** SpanFlag bits for the next string, sent before its end offset. */
+	private spanFlags = 0;
+	/** SpanFlag bits if no flags were sent. Without native scanning,
+	  * strings must be fully decoded. */
+	private spanFlagsDefault = 0;
+
+	/** Numbers decoded by native code, shared with it. */
+	private numberBuffer?: ArrayBuffer;
+	/** NumberListType of the latest number list. */
+	private numberType = NumberListType.NONE;
+	/** Parts of a number list continuing in the next code buffer. */
+	private numberPartList: NumberList[] = [];
 
 	/** Number of valid initial bytes in next token. */
 	private partialLen: number;
@@ -547,6 +1149,8 @@ export class Parser {
 
 	/** Unresolved elements (temporary tokens lacking a namespace). */
 	private unknownElementTbl: { [ name: string ]: OpenToken } = {};
+	/** Tokens and strings referenced by interned IDs from native code. */
+	private internedList: (Token | string)[] = [];
 	/** Unresolved attributes (temporary tokens lacking a namespace). */
 	private unknownAttributeTbl: { [ name: string ]: Token } = {};
 	private sgmlTbl: { [ name: string ]: SgmlToken } = {};
@@ -564,4 +1168,13 @@ export class Parser {
 
 	private hasError?: ParseError;
 
+	/** Output of parseBatch, one entry per document. */
+	private batchResult?: (TokenChunk | ParseError)[];
+	/** Position of the latest error in a batch document. */
+	private batchErrorRow = 0;
+	private batchErrorCol = 0;
+
+	/** Running in a ParserPool, where native tries must not change. */
+	private isPooled = false;
+
 }
@@ -1,5 +1,6 @@
 import { NativeConfig, NativeParser } from './ParserLib';
 
+import { ArrayType, encodeArray, decodeArray } from '../Buffer';
 import { Namespace } from '../Namespace';
 import { ParserNamespace } from './ParserNamespace';
 import { TokenSpace } from '../tokenizer/TokenSpace';
@@ -9,10 +10,91 @@ import { TokenChunk } from './TokenChunk';
 import { TokenKind, MemberToken, OpenToken, CloseToken, EmittedToken, StringToken } from './Token';
 import { Parser } from './Parser';
 import { XModuleTable } from './JSX';
+import { ComplexType } from '../schema/ComplexType';
+import { ContentModel } from '../schema/ContentModel';
 
 export interface ParserOptions {
 	parseUnknown?: boolean;
 	omitDefaults?: boolean;
+	/** Track row and column for error messages (default true). */
+	trackPosition?: boolean;
+	/** Handle namespace prefixes and xmlns attributes (default true).
+	  * If false, colons are treated as parts of names. */
+	namespaces?: boolean;
+	/** Handle DTDs embedded in DOCTYPE (default true). */
+	dtd?: boolean;
+	/** Report malformed UTF-8 as a parse error (default false). */
+	validateUtf8?: boolean;
+	/** Number of different unrecognized names to decode only once
+	  * (default 4096). */
+	internNames?: number;
+	/** Number of different attribute values to decode only once
+	  * (default 0). */
+	internValues?: number;
+	/** Maximum length in bytes of attribute values to intern (default 32). */
+	internValueLength?: number;
+	/** Expand entities declared in a DOCTYPE internal subset (default false).
+	  * Requires the dtd option. */
+	expandEntities?: boolean;
+	/** Maximum nesting depth of entity references (default 8). */
+	entityMaxDepth?: number;
+	/** Maximum bytes of expanded text in a document (default 1 MiB). */
+	entityMaxBytes?: number;
+	/** Depth of elements to pass through unparsed, counting ancestors
+	  * (default 0, disabled). Each one is emitted as a record token,
+	  * prefix and URI tokens for namespaces in scope, and its source. */
+	splitDepth?: number;
+	/** Bytes of numbers decoded before passing them to JavaScript, when
+	  * number lists are selected with setNumberList (default 1 MiB). */
+	numberBufferSize?: number;
+	/** Scan text in native code again for properties speeding up decoding
+	  * it in JavaScript (default true). Disable if most text is skipped. */
+	spanFlags?: boolean;
+}
+
+/** Must match ParserConfig :: NumberListKind in C++ code. */
+const enum NumberListKind {
+	ELEMENT = 0,
+	ATTRIBUTE
+}
+
+/** Must match ParserConfig :: NumberListType in C++ code. */
+export const enum NumberListType {
+	NONE = 0,
+	INT32,
+	FLOAT64
+}
+
+/** Must match ParserConfig :: Feature in C++ code. */
+const enum Feature {
+	TRACK_POSITION = 1,
+	NAMESPACES = 2,
+	DTD = 4,
+	VALIDATE_UTF8 = 8
+}
+
+/** Identifies a config image and its layout version. */
+const imageMagic = 0x66637863;
+const imageVersion = 1;
+
+/** Name and namespace ID (0 if none) of each token, indexed by token ID. */
+type ImageTokenList = ([ string, number ] | null)[];
+
+/** JavaScript part of a config image, stored as JSON before native data. */
+interface ConfigImage {
+	/** IDs of the xmlns attribute token and empty,
+	  * xmlns and processing instruction prefix tokens. */
+	tokens: number[];
+	/** Default prefix and URI of each namespace, indexed by namespace ID. */
+	namespaces: ([ string, string ] | null)[];
+	uri: ImageTokenList;
+	prefix: ImageTokenList;
+	element: ImageTokenList;
+	attribute: ImageTokenList;
+}
+
+function encodeTokens(space: TokenSpace): ImageTokenList {
+	return(space.list.map((token: InternalToken) => [ token.name, token.ns ? token.ns.id : 0 ] as [ string, number ]));
 }
 
 export interface TokenTbl {
@@ -91,6 +173,15 @@ export class ParserConfig {
 			this.processingPrefixToken = this.prefixSet.createToken('?');
 
 			native = new NativeConfig(this.xmlnsToken.id, this.emptyPrefixToken.id, this.xmlnsPrefixToken.id, this.processingPrefixToken.id);
+
+			// Disabling unused features selects a faster native parser.
+			const options = this.options;
+			native.setFeatures(
+				(options.trackPosition === false ? 0 : Feature.TRACK_POSITION) |
+				(options.namespaces === false ? 0 : Feature.NAMESPACES) |
+				(options.dtd === false ? 0 : Feature.DTD) |
+				(options.validateUtf8 ? Feature.VALIDATE_UTF8 : 0)
+			);
 		}
 
 		this.native = native;
@@ -311,6 +402,200 @@ export class ParserConfig {
 		return(this.namespaceList[id].addAttribute(name).tokenList);
 	}
 
+	/** Store names, tries, namespaces and prefix bindings in a binary
+	  * image. ParserConfig.loadImage recreates the config without building
+	  * or encoding any tries, so the image can be written once and loaded
+	  * quickly at startup. */
+
+	saveImage() {
+		this.updateNamespaces();
+
+		const spec: ConfigImage = {
+			tokens: [
+				this.xmlnsToken.id,
+				this.emptyPrefixToken.id,
+				this.xmlnsPrefixToken.id,
+				this.processingPrefixToken.id
+			],
+			namespaces: this.namespaceList.map((ns: ParserNamespace) => [ ns.base.defaultPrefix, ns.base.uri ] as [ string, string ]),
+			uri: encodeTokens(this.uriSpace),
+			prefix: encodeTokens(this.prefixSpace),
+			element: encodeTokens(this.elementSpace),
+			attribute: encodeTokens(this.attributeSpace)
+		};
+
+		const json = encodeArray(JSON.stringify(spec));
+		// Native data is aligned to 4 bytes.
+		const offset = 12 + ((json.length + 3) & ~3);
+		const image = new ArrayType(offset + this.native.saveImage(new ArrayType(0)));
+		const view = new DataView(image.buffer, image.byteOffset, image.byteLength);
+
+		view.setUint32(0, imageMagic, true);
+		view.setUint32(4, imageVersion, true);
+		view.setUint32(8, json.length, true);
+		image.set(json, 12);
+
+		this.native.saveImage(image.subarray(offset));
+
+		return(image);
+	}
+
+	/** Recreate a config from an image written by saveImage.
+	  * Native tries point directly into the image, which must not change
+	  * afterwards. It can be a read-only memory mapped file shared
+	  * between processes. Tries are built in JavaScript only if more
+	  * names are added later. */
+
+	static loadImage(image: ArrayType, options?: ParserOptions) {
+		const view = new DataView(image.buffer, image.byteOffset, image.byteLength);
+
+		if(
+			image.length < 12 ||
+			view.getUint32(0, true) != imageMagic ||
+			view.getUint32(4, true) != imageVersion
+		) {
+			throw(new Error('Invalid config image'));
+		}
+
+		const jsonLen = view.getUint32(8, true);
+		const spec: ConfigImage = JSON.parse(decodeArray(image, 12, 12 + jsonLen));
+		const baseOptions: ParserOptions = {};
+
+		for(let key of Object.keys(options || {})) {
+			(baseOptions as any)[key] = (options as any)[key];
+		}
+
+		// Namespaces come from the image instead.
+		baseOptions.omitDefaults = true;
+
+		const config = new ParserConfig(baseOptions);
+		config.options = options || {};
+		config.restoreImage(spec);
+
+		if(!config.native.loadImage(image, 12 + ((jsonLen + 3) & ~3))) {
+			throw(new Error('Invalid config image'));
+		}
+
+		return(config);
+	}
+
+	private restoreImage(spec: ConfigImage) {
+		const knownList = [ Namespace.unknown, Namespace.processing, Namespace.xml1998 ];
+
+		// The native config was created with these token IDs.
+		if(
+			spec.tokens[0] != this.xmlnsToken.id ||
+			spec.tokens[1] != this.emptyPrefixToken.id ||
+			spec.tokens[2] != this.xmlnsPrefixToken.id ||
+			spec.tokens[3] != this.processingPrefixToken.id
+		) {
+			throw(new Error('Invalid config image'));
+		}
+
+		this.uriSpace = new TokenSpace(TokenKind.uri);
+		this.prefixSpace = new TokenSpace(TokenKind.prefix);
+		this.elementSpace = new TokenSpace(TokenKind.element);
+		this.attributeSpace = new TokenSpace(TokenKind.attribute);
+
+		this.uriSet = new TokenSet(this.uriSpace);
+		this.prefixSet = new TokenSet(this.prefixSpace);
+
+		const namespaceList = this.namespaceList;
+
+		for(let num = 0; num < spec.namespaces.length; ++num) {
+			const item = spec.namespaces[num];
+			if(!item) continue;
+
+			const [ defaultPrefix, uri ] = item;
+			let nsBase: Namespace | undefined;
+
+			for(let known of knownList) {
+				if(known.uri == uri) nsBase = known;
+			}
+
+			const ns = new ParserNamespace(nsBase || new Namespace(defaultPrefix, uri), this, true);
+			ns.id = this.native.addNamespace(ns.registerNative());
+
+			if(ns.id != num) throw(new Error('Invalid config image'));
+
+			namespaceList[num] = ns;
+			this.namespaceTbl[uri] = ns;
+
+			if(ns.base.id > this.maxNamespace) this.maxNamespace = ns.base.id;
+		}
+
+		spec.uri.forEach((item, id) => {
+			if(!item) return;
+			const ns = namespaceList[item[1]];
+			const token = this.uriSpace.restoreToken(id, item[0], ns);
+
+			this.uriSet.restoreToken(token);
+			ns.uriToken = token.uri;
+		});
+
+		spec.prefix.forEach((item, id) => {
+			if(item) this.prefixSet.restoreToken(this.prefixSpace.restoreToken(id, item[0]));
+		});
+
+		spec.element.forEach((item, id) => {
+			if(!item) return;
+			const ns = namespaceList[item[1]];
+			const token = this.elementSpace.restoreToken(id, item[0], ns);
+
+			if(ns) ns.restoreElement(token);
+		});
+
+		spec.attribute.forEach((item, id) => {
+			if(!item) return;
+			const ns = namespaceList[item[1]];
+			const token = this.attributeSpace.restoreToken(id, item[0], ns);
+
+			if(ns) ns.restoreAttribute(token);
+		});
+
+		this.xmlnsToken = this.attributeSpace.list[spec.tokens[0]];
+		this.emptyPrefixToken = this.prefixSpace.list[spec.tokens[1]];
+		this.xmlnsPrefixToken = this.prefixSpace.list[spec.tokens[2]];
+		this.processingPrefixToken = this.prefixSpace.list[spec.tokens[3]];
+
+		// Every namespace accepts xmlns attributes.
+		for(let ns of namespaceList) {
+			if(ns) ns.restoreAttribute(this.xmlnsToken);
+		}
+	}
+
+	/** Validate nesting of elements in parsers created afterwards
+	  * against content models of types in a schema. Invalid children
+	  * stop parsing with an ErrorType.INVALID_CONTENT parse error.
+	  * @param document Type with the allowed top-level elements. */
+
+	setSchema(document: ComplexType) {
+		const data = new ContentModel(document).encode();
+
+		if(!this.native.setContentModel(data)) {
+			throw(new Error('Invalid content model'));
+		}
+	}
+
+	/** Decode text directly inside an element, before any child element,
+	  * or an attribute value as whitespace separated numbers in native code,
+	  * in parsers created afterwards. The parser emits an Int32Array or
+	  * Float64Array instead of a string. Invalid numbers become 0 or NaN.
+	  * @param token Element or attribute registered in this config.
+	  * @param type NumberListType.NONE decodes strings again. */
+
+	setNumberList(token: OpenToken | StringToken, type: NumberListType) {
+		const kind = token instanceof OpenToken ? NumberListKind.ELEMENT : NumberListKind.ATTRIBUTE;
+
+		if(token.id === void 0 || !this.native.setNumberList(kind, token.id, type)) {
+			throw(new Error('Invalid number list ' + token.name));
+		}
+	}
+
+	hasNumberLists() {
+		return(this.native.hasNumberLists());
+	}
+
 	/** If true, object is a clone sharing data with another object. */
 	private isLinked: boolean;
 
@@ -2,7 +2,10 @@ import * as path from 'path';
 import * as nbind from 'nbind';
 import * as Lib from './Lib';
 
-export const lib = nbind.init<typeof Lib>(path.resolve(__dirname, '../..')).lib;
+// Set CXML_LIB to a directory with another build, such as dist/wasm.
+export const lib = nbind.init<typeof Lib>(
+	process.env.CXML_LIB || path.resolve(__dirname, '../..')
+).lib;
 
 export const NativeParser = lib.Parser;
 export type NativeParser = Lib.Parser;
@@ -12,3 +15,17 @@ export type NativeNamespace = Lib.Namespace;
 
 export const NativeConfig = lib.ParserConfig;
 export type NativeConfig = Lib.ParserConfig;
+
+export const NativeParserPool = lib.ParserPool;
+export type NativeParserPool = Lib.ParserPool;
+
+export type NativeTokenDecoder = Lib.TokenDecoder;
+
+export const NativeRecordExtractor = lib.RecordExtractor;
+export type NativeRecordExtractor = Lib.RecordExtractor;
+
+export const NativeJsonWriter = lib.JsonWriter;
+export type NativeJsonWriter = Lib.JsonWriter;
+
+export const NativeXmlWriter = lib.XmlWriter;
+export type NativeXmlWriter = Lib.XmlWriter;
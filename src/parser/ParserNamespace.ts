@@ -8,8 +8,9 @@ import { InternalToken } from './InternalToken';
 
 export class ParserNamespace {
 
-	/** @param base Parser-independent namespace definition. */
-	constructor(public parent: Namespace | ParserNamespace, config: ParserConfig) {
+	/** @param base Parser-independent namespace definition.
+	  * @param isRestored Tokens will come from a config image. */
+	constructor(public parent: Namespace | ParserNamespace, config: ParserConfig, isRestored = false) {
 		if(parent instanceof ParserNamespace) {
 			this.base = parent.base;
 			this.native = parent.native.clone();
@@ -25,14 +26,16 @@ export class ParserNamespace {
 			this.elementSet = new TokenSet(config.elementSpace);
 			this.attributeSet = new TokenSet(config.attributeSpace);
 
-			this.attributeSet.addToken(config.xmlnsToken);
+			if(!isRestored) {
+				this.attributeSet.addToken(config.xmlnsToken);
 
-			for(let name of parent.elementNameList) {
-				this.addElement(name);
-			}
+				for(let name of parent.elementNameList) {
+					this.addElement(name);
+				}
 
-			for(let name of parent.attributeNameList) {
-				this.addAttribute(name);
+				for(let name of parent.attributeNameList) {
+					this.addAttribute(name);
+				}
 			}
 		}
 	}
@@ -57,6 +60,14 @@ export class ParserNamespace {
 		return(this.attributeSet.createToken(name, this));
 	}
 
+	restoreElement(token: InternalToken) {
+		this.elementSet.restoreToken(token);
+	}
+
+	restoreAttribute(token: InternalToken) {
+		this.attributeSet.restoreToken(token);
+	}
+
 	public base: Namespace;
 	private native: NativeNamespace;
 
@@ -0,0 +1,81 @@
+import * as os from 'os';
+
+import { ArrayType } from '../Buffer';
+import { NativeParserPool } from './ParserLib';
+import { ParserConfig } from './ParserConfig';
+import { Parser } from './Parser';
+import { TokenChunk } from './TokenChunk';
+
+/** Must equal ParserPool :: noJob on C++ side. */
+const noJob = 0xffffffff;
+
+/** Parses many independent documents concurrently on native worker
+  * threads, decoding tokens in the calling thread as code buffers fill. */
+
+export class ParserPool {
+
+	/** @param threadCount Number of worker threads (default one per core). */
+	constructor(threadCount = os.cpus().length) {
+		this.native = new NativeParserPool(threadCount);
+		this.queueLimit = Math.max(threadCount, 1) * 2;
+	}
+
+	/** Parse complete documents, returning when all are done.
+	  * The config must not change meanwhile. Each parser keeps its own
+	  * namespace prefix bindings. Names found in known namespaces are
+	  * added to native tries only after all documents are parsed.
+	  * @param flush Called with tokens of each document as they are read,
+	  * like Parser.write and destroy would, identified by its index. */
+
+	parse(
+		config: ParserConfig,
+		dataList: ArrayType[],
+		flush: (num: number, err: any, chunk: TokenChunk | null) => void
+	) {
+		const count = dataList.length;
+		/** Documents by job number. */
+		const numTbl: number[] = [];
+		const parserTbl: Parser[] = [];
+		let next = 0;
+		let jobNum: number;
+
+		// Keep few documents in flight to limit buffer memory.
+		const queue = () => {
+			while(next < count && this.native.getPendingCount() < this.queueLimit) {
+				const parser = config.createParser();
+				jobNum = parser.startPooled(this.native, dataList[next]);
+
+				numTbl[jobNum] = next++;
+				parserTbl[jobNum] = parser;
+			}
+		};
+
+		queue();
+
+		while((jobNum = this.native.wait()) != noJob) {
+			const num = numTbl[jobNum];
+			const parser = parserTbl[jobNum];
+			const isDone = parser.continuePooled(
+				this.native.getStatus(jobNum),
+				(err: any, chunk: TokenChunk | null) => flush(num, err, chunk)
+			);
+
+			if(isDone) {
+				delete parserTbl[jobNum];
+				queue();
+			} else this.native.resume(jobNum);
+		}
+
+		// Worker threads no longer read the tries.
+		config.updateNamespaces();
+	}
+
+	/** End worker threads. */
+	destroy() {
+		this.native.stop();
+	}
+
+	private native: NativeParserPool;
+	private queueLimit: number;
+
+}
@@ -0,0 +1,160 @@
+import * as stream from 'stream';
+
+import { ArrayType } from '../Buffer';
+import { ParserConfig } from './ParserConfig';
+import { Parser } from './Parser';
+import { TokenChunk } from './TokenChunk';
+import { OpenToken, StringToken } from './Token';
+import { NativeRecordExtractor } from './ParserLib';
+import { NativeNames } from './NativeNames';
+
+/** Must match RecordExtractor :: FieldKind on C++ side. */
+const enum FieldKind {
+	ATTRIBUTE = 0,
+	CHILD
+}
+
+/** Must match RecordExtractor :: ColumnType on C++ side. */
+export const enum ColumnType {
+	STRING = 0,
+	INT32,
+	FLOAT64
+}
+
+/** Must match RecordExtractor :: ColumnPart on C++ side. */
+const enum ColumnPart {
+	VALIDITY = 0,
+	DATA,
+	OFFSETS
+}
+
+export interface RecordField {
+	/** Attribute of the record element or its child element with text. */
+	token: StringToken | OpenToken;
+	type: ColumnType;
+}
+
+/** Values of one field, laid out like an Apache Arrow array. */
+
+export interface RecordColumn {
+	/** Bit for each row, set if it has a value. */
+	validity: Uint8Array;
+	nullCount: number;
+	/** Numbers, or UTF-8 contents of all strings concatenated. */
+	data: Int32Array | Float64Array | Uint8Array;
+	/** For strings, start of each row in data followed by the end. */
+	offsets?: Int32Array;
+}
+
+export interface RecordBatch {
+	rowCount: number;
+	columns: RecordColumn[];
+}
+
+/** Extract fields of repeated record elements into columns in native
+  * code, without creating any tokens. Emits a RecordBatch after each
+  * input chunk completing any records. Field names must be registered
+  * in the config before parsing. */
+
+export class RecordExtractor extends stream.Transform {
+
+	constructor(
+		config: ParserConfig,
+		record: OpenToken,
+		private fields: RecordField[],
+		public parser = config.createParser()
+	) {
+		super({ readableObjectMode: true });
+
+		this.native = new NativeRecordExtractor(getId(record));
+		this.names = new NativeNames(this.native);
+
+		for(let field of fields) {
+			const kind = field.token instanceof OpenToken ? FieldKind.CHILD : FieldKind.ATTRIBUTE;
+
+			if(this.native.addColumn(kind, getId(field.token), field.type) < 0) {
+				throw(new Error('Invalid or repeated field ' + field.token.name));
+			}
+		}
+
+		this.parser.setCodeHandler((codeBuffer: Uint32Array, chunk: ArrayType, isChunkEnd: boolean) => {
+			this.names.update(this.parser.getConfig());
+			this.native.decode(codeBuffer, chunk, isChunkEnd);
+		});
+	}
+
+	_transform(
+		chunk: string | ArrayType,
+		enc: string,
+		flush: (err: any) => void
+	) {
+		this.parser.write(chunk, enc, (err: any, tokens: TokenChunk | null) => {
+			if(tokens) tokens.free();
+			if(!err) this.pushBatch();
+			flush(err);
+		});
+	}
+
+	_flush(flush: (err: any) => void) {
+		this.parser.destroy((err: any, tokens: TokenChunk | null) => {
+			if(tokens) tokens.free();
+			if(!err) this.pushBatch();
+			flush(err);
+		});
+	}
+
+	/** Copy completed rows out of native buffers and emit them. */
+	private pushBatch() {
+		const native = this.native;
+		const rowCount = native.getRowCount();
+
+		if(!rowCount) return;
+
+		const columns = this.fields.map((field: RecordField, num: number) => {
+			const validity = new Uint8Array(native.getColumnSize(num, ColumnPart.VALIDITY));
+			const size = native.getColumnSize(num, ColumnPart.DATA);
+			let data: Int32Array | Float64Array | Uint8Array;
+			let offsets: Int32Array | undefined;
+
+			native.readColumn(num, ColumnPart.VALIDITY, validity);
+
+			switch(field.type) {
+				case ColumnType.INT32:
+
+					data = new Int32Array(size / 4);
+					break;
+
+				case ColumnType.FLOAT64:
+
+					data = new Float64Array(size / 8);
+					break;
+
+				default:
+
+					data = new Uint8Array(size);
+					offsets = new Int32Array(rowCount + 1);
+					native.readColumn(num, ColumnPart.OFFSETS, new Uint8Array(offsets.buffer));
+			}
+
+			if(size) native.readColumn(num, ColumnPart.DATA, new Uint8Array(data.buffer));
+
+			const column: RecordColumn = { validity, nullCount: native.getNullCount(num), data };
+			if(offsets) column.offsets = offsets;
+
+			return(column);
+		});
+
+		native.clear();
+		this.push({ rowCount, columns } as RecordBatch);
+	}
+
+	private native: NativeRecordExtractor;
+	private names: NativeNames;
+
+}
+
+function getId(token: OpenToken | StringToken) {
+	if(token.id === undefined) throw(new Error('Unregistered token ' + token.name));
+
+	return(token.id);
+}
@@ -1,9 +1,13 @@
-import { ArrayType, encodeArray, decodeArray, concatArray } from '../Buffer';
+import { ArrayType, encodeArray, decodeArray, decodeAscii, concatArray } from '../Buffer';
+import { SpanFlag } from '../tokenizer/CodeType';
 
 export class Stitcher {
 
-	setChunk(chunk: ArrayType) {
+	/** @param isReused Chunk memory will be overwritten by later input,
+	  * so parts of strings must be copied. */
+	setChunk(chunk: ArrayType, isReused = false) {
 		this.chunk = chunk;
+		this.isReused = isReused;
 	}
 
 	reset(buf: ArrayType, len: number) {
@@ -11,19 +15,39 @@ export class Stitcher {
 		this.byteLen = len;
 	}
 
+	/** Forget any stored parts of a string not needed after all. */
+	discard() {
+		this.partList = null;
+		this.byteLen = 0;
+	}
+
+	/** Check if parts of a string from previous chunks are stored. */
+	hasParts() {
+		return(!!this.partList);
+	}
+
 	storeSlice(start: number, end?: number) {
 		if(!this.partList) this.partList = [];
 		if(end !== 0) {
-			this.partList.push(this.chunk.slice(start, end));
+			let part: ArrayType;
+
+			if(this.isReused) {
+				// Node.js Buffer slices share memory with the original.
+				const view = this.chunk.subarray(start, end);
+				part = new ArrayType(view.length);
+				part.set(view);
+			} else part = this.chunk.slice(start, end);
+
+			this.partList.push(part);
 			this.byteLen += (end || this.chunk.length) - start;
 		}
 	}
 
 	/** getSlice helper for concatenating buffer parts. */
-	private buildSlice(start: number, end?: number) {
+	private buildSlice(start: number, end: number | undefined, decode: typeof decodeArray) {
 		this.storeSlice(start, end);
 
-		const result = decodeArray(concatArray(this.partList!, this.byteLen));
+		const result = decode(concatArray(this.partList!, this.byteLen));
 		this.partList = null;
 		this.byteLen = 0;
 
@@ -31,16 +55,23 @@ export class Stitcher {
 	}
 
 	/** Get a string from the input buffer. Prepend any parts left from
-	  * previous code buffers. */
-	getSlice(start: number, end?: number) {
-		return((
-			this.partList ? this.buildSlice(start, end) :
-			decodeArray(this.chunk, start, end)
-		).replace(/\r\n?|\n\r/g, '\n'));
+	  * previous code buffers.
+	  * @param flags SpanFlag bits from native code, if the string was
+	  * scanned. Then ASCII text skips UTF-8 decoding, and text without
+	  * carriage returns skips normalizing line breaks. */
+	getSlice(start: number, end?: number, flags = SpanFlag.NON_ASCII | SpanFlag.CARRIAGE_RETURN) {
+		const decode = flags & SpanFlag.NON_ASCII ? decodeArray : decodeAscii;
+		const result = (
+			this.partList ? this.buildSlice(start, end, decode) :
+			decode(this.chunk, start, end)
+		);
+
+		return(flags & SpanFlag.CARRIAGE_RETURN ? result.replace(/\r\n?|\n\r/g, '\n') : result);
 	}
 
 	/** Current input buffer. */
 	private chunk: ArrayType;
+	private isReused = false;
 
 	/** Storage for parts of strings split between chunks of input. */
 	private partList: ArrayType[] | null = null;
@@ -2,7 +2,11 @@ import { Namespace } from '../Namespace';
 import { ParserNamespace } from './ParserNamespace';
 import { ParserConfig } from './ParserConfig';
 
-export type TokenBuffer = (Token | number | string)[];
+/** Text or attribute value decoded in native code as whitespace
+  * separated numbers. */
+export type NumberList = Int32Array | Float64Array;
+
+export type TokenBuffer = (Token | number | string | NumberList)[];
 
 // Order must match InternalToken.tokenList.
 export const enum TokenKind {
@@ -25,6 +29,7 @@ export const enum TokenKind {
 	sgmlNestedStart,
 	sgmlNestedEnd,
 	sgmlText,
+	record,
 
 	// Internal token types
 	uri,
@@ -60,6 +65,7 @@ export class SpecialToken extends Token {
 	static sgmlNestedStart = new SpecialToken(TokenKind.sgmlNestedStart, 'DTD start');
 	static sgmlNestedEnd = new SpecialToken(TokenKind.sgmlNestedEnd, 'DTD end');
 	static sgmlText = new SpecialToken(TokenKind.sgmlText, 'SGML text');
+	static record = new SpecialToken(TokenKind.record, 'record');
 
 }
 
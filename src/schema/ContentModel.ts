@@ -0,0 +1,347 @@
+import { ComplexType } from './ComplexType';
+import { SimpleElementSpec, ElementSpec } from './Element';
+import { Group, GroupKind } from './Group';
+
+/** Bounded repetitions above this count are treated as unbounded,
+  * to keep the automata small. */
+const maxRepeat = 8;
+
+/** All groups with more members than this only check which children
+  * are allowed, not whether they are missing or repeated. */
+const maxAllTracked = 8;
+
+/** Transition of a nondeterministic automaton. */
+
+interface NfaEdge {
+	id: number;
+	type?: ComplexType;
+	next: number;
+}
+
+/** Nondeterministic automaton built from nested groups,
+  * converted to a deterministic one for the native validator. */
+
+class Nfa {
+
+	addState() {
+		this.edgeList.push([]);
+		this.emptyList.push([]);
+
+		return(this.edgeList.length - 1);
+	}
+
+	/** Add states matching spec, starting from state start.
+	  * @return Final state. */
+
+	addSpec(spec: SimpleElementSpec | ElementSpec, start: number) {
+		const min = Math.min(spec.min, maxRepeat);
+		const max = spec.max > maxRepeat ? Infinity : spec.max;
+		let state = start;
+		let end: number;
+		let num: number;
+
+		for(num = 0; num < min; ++num) state = this.addOnce(spec, state);
+
+		if(max == Infinity) {
+			// Loop back to the same state after each repetition.
+			end = this.addState();
+			this.emptyList[state].push(end);
+			this.emptyList[this.addOnce(spec, end)].push(end);
+		} else {
+			// Optional repetitions can each be followed by the end.
+			end = this.addState();
+
+			for(; num < max; ++num) {
+				this.emptyList[state].push(end);
+				state = this.addOnce(spec, state);
+			}
+
+			this.emptyList[state].push(end);
+		}
+
+		return(end);
+	}
+
+	addOnce(spec: SimpleElementSpec | ElementSpec, start: number): number {
+		const end = this.addState();
+		const meta = spec.meta;
+		const group = (spec as ElementSpec).group;
+
+		if(meta) {
+			if(meta.token.id !== void 0) {
+				this.edgeList[start].push({
+					id: meta.token.id,
+					type: meta.type instanceof ComplexType ? meta.type : void 0,
+					next: end
+				});
+			}
+		} else if(group) {
+			this.emptyList[this.addGroup(group, start)].push(end);
+		} else {
+			this.emptyList[start].push(end);
+		}
+
+		return(end);
+	}
+
+	addGroup(group: Group, start: number) {
+		let end: number;
+
+		switch(group.kind) {
+			case GroupKind.choice:
+
+				end = this.addState();
+				for(let spec of group.list) this.emptyList[this.addSpec(spec, start)].push(end);
+				break;
+
+			case GroupKind.all:
+
+				// Nested all groups only allow their members in any amounts.
+				end = this.addState();
+				this.emptyList[start].push(end);
+				for(let spec of group.list) this.emptyList[this.addOnce(spec, end)].push(end);
+				break;
+
+			default:
+
+				end = start;
+				for(let spec of group.list) end = this.addSpec(spec, end);
+				break;
+		}
+
+		return(end);
+	}
+
+	/** Add states reachable through empty transitions. */
+
+	close(stateList: number[]) {
+		const seen: { [state: number]: boolean } = {};
+		const result: number[] = [];
+		const stack = stateList.slice(0);
+		let state: number | undefined;
+
+		while((state = stack.pop()) !== void 0) {
+			if(seen[state]) continue;
+			seen[state] = true;
+			result.push(state);
+
+			for(let next of this.emptyList[state]) stack.push(next);
+		}
+
+		return(result.sort((a, b) => a - b));
+	}
+
+	/** Convert to a deterministic automaton using subset construction. */
+
+	compile(start: number, final: number, model: ContentModel) {
+		const stateTbl: { [key: string]: number } = {};
+		const pending: number[][] = [];
+
+		const addState = (nfaList: number[]) => {
+			const key = nfaList.join(',');
+			let state = stateTbl[key];
+
+			if(state === void 0) {
+				state = model.addState(nfaList.indexOf(final) >= 0);
+				stateTbl[key] = state;
+				pending.push(nfaList);
+			}
+
+			return(state);
+		};
+
+		const result = addState(this.close([ start ]));
+		let num = 0;
+
+		while(num < pending.length) {
+			const nfaList = pending[num];
+			const state = result + num++;
+			const targetTbl: { [id: number]: number[] } = {};
+			const typeTbl: { [id: number]: ComplexType | undefined } = {};
+			const idList: number[] = [];
+
+			for(let nfaState of nfaList) {
+				for(let edge of this.edgeList[nfaState]) {
+					if(!targetTbl[edge.id]) {
+						targetTbl[edge.id] = [];
+						// Ambiguous models use the first type for each name.
+						typeTbl[edge.id] = edge.type;
+						idList.push(edge.id);
+					}
+
+					targetTbl[edge.id].push(edge.next);
+				}
+			}
+
+			for(let id of idList) {
+				model.addTransition(state, id, addState(this.close(targetTbl[id])), typeTbl[id]);
+			}
+		}
+
+		return(result);
+	}
+
+	edgeList: NfaEdge[][] = [];
+	/** Transitions consuming no input. */
+	emptyList: number[][] = [];
+
+}
+
+/** Transition of a deterministic automaton. */
+
+interface Transition {
+	id: number;
+	next: number;
+	/** Index of the child element's type in typeList. */
+	typeNum: number;
+}
+
+/** Compiles content models of complex types into deterministic automata
+  * over element token IDs, for validating element nesting natively. */
+
+export class ContentModel {
+
+	/** @param document Type with the allowed top-level elements. */
+
+	constructor(document: ComplexType) {
+		this.root = this.addType(document);
+
+		// Compile types of child elements until all are found.
+		for(let num = 0; num < this.typeList.length; ++num) {
+			this.startList[num] = this.compileType(this.typeList[num]);
+		}
+	}
+
+	addState(isAccepting: boolean) {
+		this.acceptList.push(isAccepting);
+		this.transitionList.push([]);
+
+		return(this.acceptList.length - 1);
+	}
+
+	addTransition(state: number, id: number, next: number, type?: ComplexType) {
+		this.transitionList[state].push({ id, next, typeNum: this.addType(type) });
+	}
+
+	/** Serialize for ParserConfig.setContentModel in native code. */
+
+	encode() {
+		const stateCount = this.acceptList.length;
+		let len = 2;
+
+		for(let list of this.transitionList) len += 2 + list.length * 3;
+
+		const data = new Uint32Array(len);
+		let pos = 0;
+
+		data[pos++] = stateCount;
+		data[pos++] = this.startList[this.root];
+
+		for(let state = 0; state < stateCount; ++state) {
+			const list = this.transitionList[state].sort((a, b) => a.id - b.id);
+
+			data[pos++] = +this.acceptList[state];
+			data[pos++] = list.length;
+
+			for(let transition of list) {
+				data[pos++] = transition.id;
+				data[pos++] = transition.next;
+				data[pos++] = this.startList[transition.typeNum];
+			}
+		}
+
+		return(data);
+	}
+
+	/** Get the index of a type in typeList, queuing it for compilation.
+	  * Children of simple types have empty content like undefined. */
+
+	private addType(type?: ComplexType) {
+		let num = this.typeList.indexOf(type);
+
+		if(num < 0) {
+			num = this.typeList.length;
+			this.typeList.push(type);
+		}
+
+		return(num);
+	}
+
+	private compileType(type?: ComplexType) {
+		const specList: ElementSpec[] = [];
+
+		// Derived types add members after those of base types.
+		for(let base = type; base; base = base.base) {
+			if(base.elements) specList.unshift(base.elements);
+		}
+
+		if(specList.length == 1 && specList[0].group && specList[0].group!.kind == GroupKind.all) {
+			const result = this.compileAll(specList[0].group!);
+			if(result !== void 0) return(result);
+		}
+
+		const nfa = new Nfa();
+		const start = nfa.addState();
+		let end = start;
+
+		for(let spec of specList) end = nfa.addSpec(spec, end);
+
+		return(nfa.compile(start, end, this));
+	}
+
+	/** Compile an all group directly, tracking which members were seen.
+	  * @return Initial state or undefined if the group is too complex. */
+
+	private compileAll(group: Group) {
+		const specList = group.list;
+		const count = specList.length;
+		const stateCount = 1 << count;
+		let requiredMask = 0;
+
+		if(count > maxAllTracked) return(void 0);
+
+		for(let num = 0; num < count; ++num) {
+			const spec = specList[num];
+
+			if(!spec.meta || spec.meta.token.id === void 0) return(void 0);
+			if(spec.min > 0) requiredMask |= 1 << num;
+		}
+
+		// State for each set of members seen, in order of the bit mask.
+		const start = this.acceptList.length;
+
+		for(let mask = 0; mask < stateCount; ++mask) {
+			this.addState((mask & requiredMask) == requiredMask);
+		}
+
+		for(let mask = 0; mask < stateCount; ++mask) {
+			for(let num = 0; num < count; ++num) {
+				const spec = specList[num];
+				const bit = 1 << num;
+
+				// Members allowed only once cannot repeat.
+				if((mask & bit) && spec.max <= 1) continue;
+
+				this.addTransition(
+					start + mask,
+					spec.meta!.token.id!,
+					start + (mask | bit),
+					spec.meta!.type instanceof ComplexType ? spec.meta!.type : void 0
+				);
+			}
+		}
+
+		return(start);
+	}
+
+	private root: number;
+
+	/** Types with content models, undefined for types without children. */
+	private typeList: (ComplexType | undefined)[] = [];
+	/** Initial state of each type in typeList. */
+	private startList: number[] = [];
+
+	private acceptList: boolean[] = [];
+	private transitionList: Transition[][] = [];
+
+}
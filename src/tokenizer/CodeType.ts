@@ -49,5 +49,60 @@ export const enum CodeType {
 	PARTIAL_ATTRIBUTE_ID,
 	PARTIAL_PREFIX_ID,
 	PARTIAL_URI_ID,
-	PARTIAL_LEN
+	PARTIAL_LEN,
+
+	// End of a document in a batch, with its error code.
+	DOCUMENT_END,
+
+	// End of valid data in a reused input buffer.
+	CHUNK_END,
+
+	// Unrecognized name or attribute value seen before, by interned ID.
+	// Order must match OPEN_ELEMENT_ID, CLOSE_ELEMENT_ID, ATTRIBUTE_ID.
+	INTERNED_OPEN_ELEMENT_ID,
+	INTERNED_CLOSE_ELEMENT_ID,
+	INTERNED_ATTRIBUTE_ID,
+	INTERNED_VALUE_ID,
+
+	// New interned ID for the string in the previous token.
+	INTERN_ID,
+
+	// Previous text or attribute value with entities expanded, ending at
+	// this offset in the entity buffer.
+	EXPANDED_END_OFFSET,
+
+	// Properties of the next text or attribute value, as SpanFlag bits.
+	// Omitted if none apply.
+	SPAN_FLAGS,
+
+	// Element skipped at the split depth, from its name after the opening <
+	// to the end of its closing tag. Prefixes in scope precede the end,
+	// packed like PREFIX_ID.
+	RECORD_START_OFFSET,
+	RECORD_PREFIX_ID,
+	RECORD_END_OFFSET,
+
+	// Text or attribute value decoded as a number list, replacing its
+	// start and end offsets. The start has the NumberListType, and parts
+	// end at byte offsets in the number buffer. Each list starts at the
+	// previous end rounded up to 8 bytes, or at 0 in a new code buffer.
+	NUMBER_LIST_START,
+	NUMBER_LIST_PART_OFFSET,
+	NUMBER_LIST_END_OFFSET,
+
+	// Row and column of a parse error in a batch document, before its
+	// DOCUMENT_END. Omitted if the document was valid.
+	DOCUMENT_ERROR_ROW,
+	DOCUMENT_ERROR_COL
+};
+
+/** Must match SpanFlags in C++ code. */
+export const enum SpanFlag {
+	NON_ASCII = 1,
+	AMPERSAND = 2,
+	CARRIAGE_RETURN = 4,
+	// Not empty and only spaces, tabs and line breaks.
+	WHITESPACE = 8,
+	// Not empty and only decimal digits.
+	DIGITS = 16
 };
@@ -3,5 +3,16 @@ export const enum ErrorType {
 	INVALID_CHAR,
 	PROHIBITED_WHITESPACE,
 	TOO_MANY_PREFIXES,
-	OTHER
+	OTHER,
+	UNSUPPORTED_DTD,
+	INVALID_UTF8,
+	INVALID_COMPRESSED_DATA,
+	/** Not an error. Parsing was suspended in pull mode to read tokens. */
+	BUFFER_FULL,
+	/** Entity expansion exceeded its depth or size limit. */
+	ENTITY_LIMIT,
+	/** Element content does not match its content model in the schema. */
+	INVALID_CONTENT,
+	/** Start tag has two attributes with the same name. */
+	DUPLICATE_ATTRIBUTE
 };
@@ -23,11 +23,19 @@ class Node {
 	}
 }
 
-/** Maximum number of bits per node (number must fit in 1 byte). */
-const MAX_LEN = 255; // Test edge cases by using smaller numbers (>= 8) here!
+/** Maximum number of bits per node (number must fit in 1 byte).
+  * 255 is reserved for flagging the wide format. */
+const MAX_LEN = 254; // Test edge cases by using smaller numbers (>= 8) here!
 
-/** Must equal Patricia :: notFound on C++ side. */
+/** Data value without a token, must equal Patricia :: idMask on C++ side. */
 export const NOT_FOUND = 0x7fffff;
+/** Must equal Patricia :: wideIdMask on C++ side. */
+export const WIDE_NOT_FOUND = 0x7fffffff;
+
+/** First byte of tries in the wide format with 4-byte references,
+  * used if offsets or token IDs do not fit in 3 bytes.
+  * Must equal Patricia :: wideFlag on C++ side. */
+const WIDE_FLAG = 0xff;
 
 class PatriciaCursor {
 	constructor(public node: Node) {
@@ -191,10 +199,16 @@ export class Patricia {
 		}
 	}
 
+	/** Encode a node and its descendants, with references refLen bytes long.
+	  * @return Number of bytes or -1 if references did not fit. */
+
 	private static encodeNode(
 		node: Node,
-		dataList: ArrayType[]
-	) {
+		dataList: ArrayType[],
+		refLen: number
+	): number {
+		const notFound = refLen == 3 ? NOT_FOUND : WIDE_NOT_FOUND;
+		const leafFlag = notFound + 1;
 		let len = node.len;
 		let partLen: number;
 		let byteLen: number;
@@ -207,13 +221,13 @@ export class Patricia {
 			if(partLen > MAX_LEN) partLen = MAX_LEN & ~7;
 
 			// Convert bit to byte length rounding up, add 1 byte for length
-			// header and 3 bytes for reference
+			// header and refLen bytes for reference
 			// (token ID or offset to second child).
 			byteLen = (partLen + 7) >> 3;
-			const data = new ArrayType(byteLen + 4);
+			const data = new ArrayType(byteLen + refLen + 1);
 
 			dataList.push(data);
-			totalByteLen += byteLen + 4;
+			totalByteLen += byteLen + refLen + 1;
 
 			posOut = 0;
 
@@ -223,26 +237,38 @@ export class Patricia {
 			let ref: number;
 
 			if(len > MAX_LEN) {
-				ref = NOT_FOUND;
+				ref = notFound;
 			} else {
 				let nextTotalLen = 0;
-				if(node.first) nextTotalLen += Patricia.encodeNode(node.first, dataList);
+				let childLen: number;
+
+				if(node.first) {
+					childLen = Patricia.encodeNode(node.first, dataList, refLen);
+					if(childLen < 0) return(-1);
+					nextTotalLen += childLen;
+				}
 
 				if(node.second) {
-					ref = nextTotalLen + 3;
-					nextTotalLen += Patricia.encodeNode(node.second, dataList);
+					ref = nextTotalLen + refLen;
+					childLen = Patricia.encodeNode(node.second, dataList, refLen);
+					if(childLen < 0) return(-1);
+					nextTotalLen += childLen;
 				} else {
 					// ref = tokenSet.encode(node.token!) || 0;
 					ref = node.token!.id;
-					if(!node.first) ref |= 0x800000; // See 0x80 in PatriciaCursor.cc
+					if(ref >= notFound) return(-1);
+					if(!node.first) ref += leafFlag; // See 0x80 in PatriciaCursor.cc
 				}
 
+				if(ref >= leafFlag * 2) return(-1);
+
 				totalByteLen += nextTotalLen;
 			}
 
-			data[++posOut] = ref >> 16;
-			data[++posOut] = ref >> 8;
-			data[++posOut] = ref;
+			// Divide instead of shifting, because refs may exceed 31 bits.
+			for(let shift = refLen; shift--;) {
+				data[++posOut] = ref / Math.pow(256, shift);
+			}
 
 			len -= partLen;
 		}
@@ -251,13 +277,23 @@ export class Patricia {
 	}
 
 	encode() {
-		const dataList: ArrayType[] = [];
+		const root = this.root || Patricia.sentinel;
+		let dataList: ArrayType[] = [];
 
 		// Encode trie contents into a buffer.
-		const dataLen = Patricia.encodeNode(
-			this.root || Patricia.sentinel,
-			dataList
-		);
+		let dataLen = Patricia.encodeNode(root, dataList, 3);
+
+		if(dataLen < 0) {
+			// Offsets or token IDs were too large, so flag the trie and
+			// encode it again with wider references.
+			const header = new ArrayType(1);
+			header[0] = WIDE_FLAG;
+
+			dataList = [ header ];
+			dataLen = Patricia.encodeNode(root, dataList, 4) + 1;
+
+			if(!dataLen) throw(new Error('Trie too large to encode'));
+		}
 
 		return(concatArray(dataList, dataLen));
 	}
@@ -11,6 +11,7 @@ export class TokenSet {
 
 			this.tbl = parent.tbl;
 			this.trie = parent.trie;
+			this.isTrieStale = parent.isTrieStale;
 		} else {
 			this.isLinked = false;
 
@@ -33,7 +34,20 @@ export class TokenSet {
 		}
 
 		this.tbl = tbl;
-		this.trie = this.trie.clone();
+		// A stale trie is rebuilt from the table when needed.
+		this.trie = this.isTrieStale ? new Patricia() : this.trie.clone();
+	}
+
+	/** Insert tokens restored from a config image into the trie,
+	  * only once new names are added. */
+	private updateTrie() {
+		if(!this.isTrieStale) return;
+		this.isTrieStale = false;
+
+		for(let key of Object.keys(this.tbl)) {
+			const token = this.tbl[key];
+			if(token.name) this.trie.insertNode(token);
+		}
 	}
 
 	createToken(name: string, ns?: ParserNamespace) {
@@ -44,6 +58,7 @@ export class TokenSet {
 
 			token = this.space.createToken(name, ns);
 
+			this.updateTrie();
 			this.tbl[name] = token;
 			if(token.name) {
 				this.dirty = true;
@@ -56,13 +71,23 @@ export class TokenSet {
 
 	addToken(token: InternalToken) {
 		if(token.name) {
+			this.updateTrie();
 			this.dirty = true;
 			this.tbl[token.name] = token;
 			this.trie.insertNode(token);
 		}
 	}
 
+	/** Add a token from a config image. Native code already has
+	  * the trie, so it is only rebuilt here if more tokens are added. */
+	restoreToken(token: InternalToken) {
+		this.tbl[token.name] = token;
+		this.isTrieStale = true;
+		this.dirty = false;
+	}
+
 	encodeTrie() {
+		this.updateTrie();
 		return(this.trie.encode());
 	}
 
@@ -71,6 +96,8 @@ export class TokenSet {
 
 	private tbl: { [ name: string ]: InternalToken };
 	private trie: Patricia;
+	/** If true, tokens in tbl are missing from trie. */
+	private isTrieStale = false;
 
 	public dirty = true;
 
@@ -40,6 +40,17 @@ export class TokenSpace {
 		return(token);
 	}
 
+	/** Recreate a token with a known ID, when loading a config image. */
+	restoreToken(id: number, name: string, ns?: ParserNamespace) {
+		this.unlink();
+
+		const token = new InternalToken(id, this.kind, name, ns);
+		this.list[id] = token;
+		if(id > this.idLast) this.idLast = id;
+
+		return(token);
+	}
+
 	/** If true, object is a clone sharing data with another object. */
 	private isLinked: boolean;
 	private idLast: number;
@@ -99,6 +99,9 @@ export class JsonWriter extends stream.Transform {
 						break;
 				}
 			} else {
+				// Number lists become JSON arrays.
+				if(typeof(token) == 'object') token = Array.prototype.slice.call(token);
+
 				switch(state) {
 					case State.TEXT:
 
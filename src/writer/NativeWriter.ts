@@ -0,0 +1,76 @@
+import * as stream from 'stream';
+
+import { ArrayType } from '../Buffer';
+import { ParserConfig } from '../parser/ParserConfig';
+import { Parser } from '../parser/Parser';
+import { TokenChunk } from '../parser/TokenChunk';
+import { NativeXmlWriter, NativeJsonWriter } from '../parser/ParserLib';
+import { NativeNames } from '../parser/NativeNames';
+
+const outputBufferSize = 65536;
+
+export interface NativeWriterOptions {
+	/** Output JSON in the same format as JsonWriter instead of XML. */
+	json?: boolean;
+	/** Output Canonical XML 1.0 instead of indented XML. */
+	canonical?: boolean;
+	/** Keep comments in canonical output. */
+	withComments?: boolean;
+}
+
+/** Re-serialize XML input in native code, without creating any tokens.
+  * Output is UTF-8 in the same format as Writer (but keeping original
+  * namespace prefixes and declarations) or JsonWriter. */
+
+export class NativeWriter extends stream.Transform {
+
+	constructor(
+		config: ParserConfig,
+		options: NativeWriterOptions = {},
+		public parser = config.createParser()
+	) {
+		super();
+
+		this.native = options.json ? new NativeJsonWriter() : new NativeXmlWriter(
+			!!options.canonical,
+			!!options.withComments
+		);
+
+		this.names = new NativeNames(this.native);
+
+		this.native.setOutputBuffer(this.outputBuffer, (len: number) => {
+			const part = new ArrayType(len);
+			part.set(this.outputBuffer.subarray(0, len));
+			this.push(part);
+		});
+
+		this.parser.setCodeHandler((codeBuffer: Uint32Array, chunk: ArrayType, isChunkEnd: boolean) => {
+			this.names.update(this.parser.getConfig());
+			this.native.decode(codeBuffer, chunk, isChunkEnd);
+		});
+	}
+
+	_transform(
+		chunk: string | ArrayType,
+		enc: string,
+		flush: (err: any) => void
+	) {
+		this.parser.write(chunk, enc, (err: any, tokens: TokenChunk | null) => {
+			if(tokens) tokens.free();
+			flush(err);
+		});
+	}
+
+	_flush(flush: (err: any) => void) {
+		this.parser.destroy((err: any, tokens: TokenChunk | null) => {
+			if(tokens) tokens.free();
+			if(!err) this.native.end();
+			flush(err);
+		});
+	}
+
+	private native: NativeXmlWriter | NativeJsonWriter;
+	private names: NativeNames;
+	private outputBuffer = new ArrayType(outputBufferSize);
+
+}
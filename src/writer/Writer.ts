@@ -17,7 +17,8 @@ export const enum State {
 	TEXT,
 	AFTER_TEXT,
 	COMMENT,
-	CDATA
+	CDATA,
+	RECORD
 }
 
 export const indentPattern = '\n' + new Array(Indent.MAX_DEPTH).join('\t');
@@ -177,6 +178,11 @@ export class Writer extends stream.Transform {
 						state = State.SGML_TEXT;
 						break;
 
+					case TokenKind.record:
+
+						state = State.RECORD;
+						break;
+
 					case TokenKind.other:
 
 						if(token.serialize) {
@@ -197,6 +203,9 @@ export class Writer extends stream.Transform {
 						break;
 				}
 			} else {
+				// Number lists are written space separated.
+				if(typeof(token) == 'object') token = Array.prototype.join.call(token, ' ');
+
 				switch(state) {
 					case State.TEXT:
 					case State.AFTER_TEXT:
@@ -223,6 +232,13 @@ export class Writer extends stream.Transform {
 						state = State.TEXT;
 						break;
 
+					case State.RECORD:
+
+						// Source of an element passed through unparsed.
+						partList[++partNum] = indent + token;
+						state = State.TEXT;
+						break;
+
 					case State.SGML_TEXT:
 
 						partList[++partNum] = this.sgmlSeparator + '"' + token + '"';
@@ -0,0 +1,85 @@
+import { Patricia } from '../dist/tokenizer/Patricia';
+import { lib } from '../dist/parser/ParserLib';
+
+// Measure encoding and native lookup speed of tries with millions of
+// names, large enough to need the wide format with 4-byte references,
+// looking names up one at a time and in batches.
+
+const countList = process.argv.slice(2).map(Number);
+const roundCount = 3;
+
+function makeName(num: number) {
+	// Scatter names to get a realistic mix of shared prefixes.
+	return('n' + ((num * 2654435761) >>> 0).toString(36) + '_' + num);
+}
+
+function bench(count: number) {
+	const trie = new Patricia();
+	const nameList: string[] = [];
+
+	for(let num = 0; num < count; ++num) {
+		const name = makeName(num);
+
+		nameList.push(name);
+		trie.insertNode({ id: num, name, buf: new Buffer(name) } as any);
+	}
+
+	let start = process.hrtime();
+	const data = trie.encode();
+	let [ sec, nsec ] = process.hrtime(start);
+
+	console.log(
+		count + ' names: ' +
+		(data[0] == 0xff ? 'wide' : 'narrow') + ' format, ' +
+		(data.length / 1e6).toFixed(1) + ' MB encoded in ' +
+		(sec + nsec / 1e9).toFixed(2) + ' s'
+	);
+
+	const native = new lib.Patricia();
+	native.setBuffer(data);
+
+	let best = Infinity;
+
+	for(let round = 0; round < roundCount; ++round) {
+		start = process.hrtime();
+
+		for(let num = 0; num < count; ++num) {
+			if(native.find(nameList[num]) != num) throw(new Error('Wrong ID for ' + nameList[num]));
+		}
+
+		[ sec, nsec ] = process.hrtime(start);
+		best = Math.min(best, sec + nsec / 1e9);
+	}
+
+	// Includes passing each name from JavaScript to native code.
+	console.log('  ' + (best / count * 1e9).toFixed(0) + ' ns per lookup with find');
+
+	const text = new Buffer(nameList.join(''));
+	const ends = new Uint32Array(count);
+	const idList = new Uint32Array(count);
+	let end = 0;
+
+	for(let num = 0; num < count; ++num) ends[num] = (end += nameList[num].length);
+
+	best = Infinity;
+
+	for(let round = 0; round < roundCount; ++round) {
+		start = process.hrtime();
+		native.findMany(text, new Buffer(ends.buffer), new Buffer(idList.buffer));
+		[ sec, nsec ] = process.hrtime(start);
+		best = Math.min(best, sec + nsec / 1e9);
+	}
+
+	for(let num = 0; num < count; ++num) {
+		if(idList[num] != num) throw(new Error('Wrong ID for ' + nameList[num]));
+	}
+
+	console.log('  ' + (best / count * 1e9).toFixed(0) + ' ns per lookup with findMany');
+}
+
+if(!countList.length) {
+	console.log('Usage: node test/bench-trie.js count...');
+	console.log('Example: node --max-old-space-size=8000 test/bench-trie.js 100000 2000000 4000000');
+} else {
+	for(let count of countList) bench(count);
+}
@@ -0,0 +1,62 @@
+import * as fs from 'fs';
+import * as path from 'path';
+import * as childProcess from 'child_process';
+
+// Compare parsing speed of the native addon and the WebAssembly build
+// (npm run wasm) on an XML file. Each runs in a separate process,
+// because the library is chosen when it is first loaded.
+
+const wasmPath = path.resolve(__dirname, '../dist/wasm');
+const xmlPath = process.argv[2];
+const roundCount = 5;
+
+function bench() {
+	const cxml = require('..');
+	const data = fs.readFileSync(xmlPath);
+	const config = new cxml.ParserConfig();
+	let best = Infinity;
+
+	const flush = (err: any, chunk: any) => {
+		if(err) throw(err);
+		if(chunk) chunk.free();
+	};
+
+	for(let round = 0; round < roundCount; ++round) {
+		const parser = config.createParser();
+		const start = process.hrtime();
+
+		parser.write(data, '', flush);
+		parser.destroy(flush);
+
+		const [ sec, nsec ] = process.hrtime(start);
+		best = Math.min(best, sec + nsec / 1e9);
+	}
+
+	console.log((data.length / best / 1e6).toFixed(1) + ' MB/s');
+}
+
+function run(name: string, libPath?: string) {
+	const env: { [key: string]: string | undefined } = {};
+
+	for(let key of Object.keys(process.env)) env[key] = process.env[key];
+	env.CXML_BENCH = '1';
+	if(libPath) env.CXML_LIB = libPath;
+
+	process.stdout.write(name + ': ');
+	childProcess.spawnSync(
+		process.execPath,
+		[ __filename, xmlPath ],
+		{ env, stdio: 'inherit' }
+	);
+}
+
+if(!xmlPath) {
+	console.log('Usage: node test/bench-wasm.js file.xml');
+} else if(process.env.CXML_BENCH) {
+	bench();
+} else {
+	run('native');
+
+	if(fs.existsSync(wasmPath)) run('wasm', wasmPath);
+	else console.log('wasm: not built, run npm run wasm');
+}
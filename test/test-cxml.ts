@@ -0,0 +1,38 @@
+import * as fs from 'fs';
+import * as cxml from '..';
+
+import { ParserStream } from '../dist/parser/ParserStream';
+
+const path = process.argv[2];
+const xml = new ParserStream(new cxml.ParserConfig());
+const file = fs.createReadStream(path);
+const start = process.hrtime();
+let byteCount = 0;
+
+file.on('data', (data: Buffer) => byteCount += data.length);
+
+function report() {
+	const [ sec, nsec ] = process.hrtime(start);
+	const time = sec + nsec / 1e9;
+
+	console.log((byteCount / time / 1e6).toFixed(1) + ' MB/s');
+}
+
+if(/\.gz$/.test(path)) {
+	// Decompress and parse in native code. Speed is of compressed input.
+	const flush = (err: any, chunk: cxml.TokenChunk | null) => {
+		if(err) throw(err);
+		if(chunk) chunk.free();
+	};
+
+	file.on('data', (data: Buffer) => xml.parser.writeCompressed(data, flush));
+	file.on('end', () => {
+		xml.parser.destroy(flush);
+		report();
+	});
+} else {
+	xml.on('data', (chunk: cxml.TokenChunk) => chunk.free());
+	xml.on('end', report);
+
+	file.pipe(xml);
+}
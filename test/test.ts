@@ -1,5 +1,6 @@
 import * as fs from 'fs';
 import * as path from 'path';
+import * as zlib from 'zlib';
 
 import * as nbind from 'nbind';
 import * as cxml from '..';
@@ -9,6 +10,11 @@ import { ParserStream } from '../dist/parser/ParserStream';
 
 import { TokenSpace } from '../dist/tokenizer/TokenSpace';
 import { Patricia } from '../dist/tokenizer/Patricia';
+import { ErrorType } from '../dist/tokenizer/ErrorType';
+import { CodeType } from '../dist/tokenizer/CodeType';
+import { ComplexType } from '../dist/schema/ComplexType';
+import { ElementSpec, ElementMeta } from '../dist/schema/Element';
+import { Group, GroupKind } from '../dist/schema/Group';
 
 const lib = nbind.init<typeof Lib>(path.resolve(__dirname, '..')).lib;
 
@@ -38,6 +44,889 @@ function testPatricia() {
 			process.exit(1);
 		}
 	}
+
+	// Look up all tokens at once, followed by a missing name.
+	const nameList = tokenList.map((token: any) => token.name).concat([ 'foob' ]);
+	const ends = new Uint32Array(nameList.length);
+	const idList = new Uint32Array(nameList.length);
+	let end = 0;
+
+	nameList.forEach((name: string, num: number) => ends[num] = (end += Buffer.byteLength(name)));
+
+	rawTrie.findMany(new Buffer(nameList.join('')), new Buffer(ends.buffer), new Buffer(idList.buffer));
+
+	tokenList.forEach((token: any, num: number) => {
+		if(idList[num] != token.id) {
+			console.error('ERROR in findMany ' + idList[num] + ' ' + token.name);
+			process.exit(1);
+		}
+	});
+
+	if(idList[tokenList.length] != 0xffffffff) {
+		console.error('ERROR in findMany for missing name');
+		process.exit(1);
+	}
+}
+
+/** IDs beyond 3 bytes need the wide trie format. */
+function testWidePatricia() {
+	const trie = new Patricia();
+	const rawTrie = new lib.Patricia();
+	const idBase = 0x800000;
+
+	const tokenList = fs.readFileSync(
+		path.resolve(__dirname, 'words.txt'),
+		{ encoding: 'utf-8' }
+	).split('\n').filter(
+		(name: string) => name.length > 1
+	).map(
+		(name: string, num: number) => ({ id: idBase + num, name, buf: new Buffer(name) }) as any
+	);
+
+	trie.insertList(tokenList);
+
+	const data = trie.encode();
+	if(data[0] != 0xff) {
+		console.error('ERROR trie not in wide format');
+		process.exit(1);
+	}
+
+	rawTrie.setBuffer(data);
+
+	let result: number;
+
+	for(let token of tokenList) {
+		result = rawTrie.find(token.name);
+		if(result != token.id) {
+			console.error('ERROR in ' + result + ' ' + token.name);
+			process.exit(1);
+		}
+	}
+}
+
+/** Describe tokens as a string, for comparing parser output. */
+
+function dumpTokens(buffer: cxml.TokenBuffer, length = buffer.length) {
+	const result: string[] = [];
+
+	for(let num = 0; num < length; ++num) {
+		const token = buffer[num] as any;
+
+		if(token instanceof cxml.Token) {
+			result.push(token.kindString + ':' + (token.name || (token.ns && token.ns.uri) || ''));
+		} else if(token && typeof(token) == 'object') {
+			result.push('[' + Array.prototype.join.call(token, ',') + ']');
+		} else {
+			result.push(JSON.stringify(token));
+		}
+	}
+
+	return(result.join(' '));
+}
+
+/** Parse chunks, appending descriptions of the resulting tokens to a list.
+  * Pass null as a chunk to end the document. */
+
+function parseChunks(parser: cxml.Parser, chunkList: (string | null)[], output: string[]) {
+	const handler = (err: any, chunk: cxml.TokenChunk | null) => {
+		if(err) throw(err);
+
+		if(chunk) {
+			if(chunk.length) output.push(dumpTokens(chunk.buffer, chunk.length));
+			chunk.free();
+		}
+	};
+
+	for(let data of chunkList) {
+		if(data === null) parser.destroy(handler);
+		else parser.write(data, '', handler);
+	}
+
+	return(output);
+}
+
+/** Copy parser options over defaults, without ES2015 Object.assign. */
+
+function extendOptions(defaults: cxml.ParserOptions, options: cxml.ParserOptions) {
+	const result: any = {};
+
+	for(let key of Object.keys(defaults)) result[key] = (defaults as any)[key];
+	for(let key of Object.keys(options)) result[key] = (options as any)[key];
+
+	return(result as cxml.ParserOptions);
+}
+
+function testSnapshot() {
+	const config = new cxml.ParserConfig();
+	const first = '<a x="1"><b>foo</b>';
+	const second = '<c y="2"/>bar</a>';
+
+	const expected = parseChunks(config.createParser(), [ first, second, null ], []);
+
+	const parser = config.createParser();
+	const output = parseChunks(parser, [ first ], []);
+	const data = parser.snapshot();
+
+	if(!data) {
+		console.error('ERROR in snapshot between elements');
+		process.exit(1);
+	}
+
+	// Continue in a fresh parser from the same config.
+	const restored = config.createParser();
+
+	if(!restored.restore(data!)) {
+		console.error('ERROR in restoring snapshot');
+		process.exit(1);
+	}
+
+	parseChunks(restored, [ second, null ], output);
+
+	if(output.join(' ') != expected.join(' ')) {
+		console.error('ERROR in tokens after restoring snapshot');
+		process.exit(1);
+	}
+}
+
+/** Check if parsing emits a known element by token ID,
+  * instead of an unknown name. */
+
+function hasKnownElement(config: cxml.ParserConfig, xml: string, id: number) {
+	const parser = config.createParser();
+	let found = false;
+
+	parser.setCodeHandler((codeBuffer: Uint32Array) => {
+		// Token kind is in the low 6 bits.
+		for(let num = 1; num <= codeBuffer[0]; ++num) {
+			if(codeBuffer[num] == CodeType.OPEN_ELEMENT_ID + id * 64) found = true;
+		}
+	});
+
+	parser.write(xml, '', () => {});
+	parser.destroy(() => {});
+
+	return(found);
+}
+
+function testInterning() {
+	const dtd = '<!DOCTYPE root [<!ENTITY e "expanded">]>';
+	const docList = [
+		// The same unknown local names in different namespaces.
+		'<root xmlns:a="urn:test:intern:a" xmlns:b="urn:test:intern:b">' +
+		'<a:item a:k="1" k="v"/><b:item b:k="1" k="v"/><a:item a:k="2" k="v"/>' +
+		'<b:item b:k="2"/><item k="v"/><a:item b:k="3"/>' +
+		// Prefix declared after the interned name in the same tag.
+		'<c:item xmlns:c="urn:test:intern:c" c:k="4"/><c:item xmlns:c="urn:test:intern:d" c:k="4"/>' +
+		'</root>',
+		// Interned values with entities expanded after them.
+		dtd + '<root><x v="&e;"/><x v="&e;"/><x v="plain"/><x v="plain"/><x v="a&e;"/><x v="a&e;"/></root>'
+	];
+
+	for(let doc of docList) {
+		const split = doc.length >> 1;
+		const chunkLists = [ [ doc, null ], [ doc.substr(0, split), doc.substr(split), null ] ];
+
+		for(let chunkList of chunkLists) {
+			const parse = (options: cxml.ParserOptions) => parseChunks(
+				new cxml.ParserConfig(extendOptions({ expandEntities: true }, options)).createParser(),
+				chunkList,
+				[]
+			).join(' ');
+
+			const expected = parse({ internNames: 0 });
+
+			if(parse({}) != expected || parse({ internValues: 64 }) != expected) {
+				console.error('ERROR in tokens with interning: ' + doc);
+				process.exit(1);
+			}
+		}
+	}
+}
+
+function testConfigImage() {
+	const nsA = new cxml.Namespace('a', 'urn:test:image:a');
+	const nsB = new cxml.Namespace('b', 'urn:test:image:b');
+	const config = new cxml.ParserConfig();
+
+	config.getElementTokens(nsA, 'list');
+	config.getElementTokens(nsA, 'item');
+	config.getAttributeTokens(nsA, 'id');
+	config.getElementTokens(nsB, 'other');
+	config.getAttributeTokens(nsB, 'ref');
+	config.bindNamespace(nsA);
+
+	const image = config.saveImage();
+	const loaded = cxml.ParserConfig.loadImage(image);
+
+	const xml = (
+		'<a:list xmlns:b="urn:test:image:b" id="1">' +
+		'<a:item b:ref="x">text</a:item><b:other/><a:late/><unknown/>' +
+		'</a:list>'
+	);
+
+	const expected = parseChunks(config.createParser(), [ xml, null ], []);
+	const output = parseChunks(loaded.createParser(), [ xml, null ], []);
+
+	if(output.join(' ') != expected.join(' ')) {
+		console.error('ERROR in tokens from loaded config image');
+		process.exit(1);
+	}
+
+	const itemToken = loaded.getElementTokens(nsA, 'item')[cxml.TokenKind.open]!;
+
+	if(!hasKnownElement(loaded, xml, itemToken.id!)) {
+		console.error('ERROR in trie from config image');
+		process.exit(1);
+	}
+
+	// Adding a name must rebuild the trie pointing into the image.
+	const lateToken = loaded.getElementTokens(nsA, 'late')[cxml.TokenKind.open]!;
+	loaded.updateNamespaces();
+
+	if(!hasKnownElement(loaded, xml, lateToken.id!) || !hasKnownElement(loaded, xml, itemToken.id!)) {
+		console.error('ERROR in trie rebuilt after loading config image');
+		process.exit(1);
+	}
+
+	for(let len of [ 8, 20, image.length - 4 ]) {
+		let thrown: any;
+
+		try {
+			cxml.ParserConfig.loadImage(image.subarray(0, len));
+		} catch(err) {
+			thrown = err;
+		}
+
+		if(!thrown) {
+			console.error('ERROR in truncated config image of ' + len + ' bytes');
+			process.exit(1);
+		}
+	}
+}
+
+function testBatch() {
+	const config = new cxml.ParserConfig();
+	const parser = config.createParser();
+
+	const docList = [ '<a x="1">foo</a>', '<b>\n<1/></b>', '<d/>' ];
+	const data = cxml.encodeArray(docList.join(''));
+	const ends = new Uint32Array(docList.length);
+	let end = 0;
+
+	for(let num = 0; num < docList.length; ++num) {
+		end += cxml.encodeArray(docList[num]).length;
+		ends[num] = end;
+	}
+
+	const result = parser.parseBatch(data, ends);
+	const err = result[1];
+	let expectedErr: any;
+
+	try {
+		config.createParser().parseSync(docList[1]);
+	} catch(err) {
+		expectedErr = err;
+	}
+
+	if(
+		result.length != 3 ||
+		!(result[0] instanceof cxml.TokenChunk) ||
+		!(result[2] instanceof cxml.TokenChunk) ||
+		!(err instanceof cxml.ParseError) ||
+		err.code != ErrorType.INVALID_CHAR || err.row != 2 ||
+		!expectedErr || err.row != expectedErr.row || err.col != expectedErr.col
+	) {
+		console.error('ERROR in batch result');
+		process.exit(1);
+	}
+
+	const chunk = result[0] as cxml.TokenChunk;
+	const expected = dumpTokens(config.createParser().parseSync(docList[0]).buffer);
+
+	if(dumpTokens(chunk.buffer, chunk.length) != expected) {
+		console.error('ERROR in batch tokens');
+		process.exit(1);
+	}
+
+	// An offset past the end of data must throw.
+	let thrown: any;
+
+	try {
+		parser.parseBatch(data, new Uint32Array([ ends[0], data.length + 1 ]));
+	} catch(err) {
+		thrown = err;
+	}
+
+	if(!(thrown instanceof cxml.ParseError) || thrown.code != ErrorType.OTHER) {
+		console.error('ERROR in batch with invalid ends');
+		process.exit(1);
+	}
+
+	// The parser must still work afterwards.
+	const again = parser.parseBatch(data, ends);
+
+	if(again.length != 3 || !(again[0] instanceof cxml.TokenChunk)) {
+		console.error('ERROR in batch after invalid ends');
+		process.exit(1);
+	}
+}
+
+/** Repeat a string, without ES2015 String.prototype.repeat. */
+
+function repeat(text: string, count: number) {
+	return(new Array(count + 1).join(text));
+}
+
+function testCompressed() {
+	const itemList: string[] = [];
+
+	// Vary lengths, so strings cross window boundaries at different points.
+	for(let num = 0; num < 2000; ++num) {
+		itemList.push(
+			'<item id="' + num + '" note="' + repeat('n', num % 300) + '">' +
+			repeat('text ', num % 97) +
+			'</item>'
+		);
+	}
+
+	// One text spans several whole windows.
+	const doc = '<root>' + itemList.join('') + '<long>' + repeat('long ', 40000) + '</long></root>';
+	const compressed = zlib.gzipSync(Buffer.from(doc));
+	const expected = parseChunks(new cxml.ParserConfig().createParser(), [ doc, null ], []).join(' ');
+
+	/** Parse parts of compressed input, returning the tokens or an error. */
+	const parse = (partList: Buffer[]) => {
+		const parser = new cxml.ParserConfig().createParser();
+		const output: string[] = [];
+		let result: any = null;
+
+		const handler = (err: any, chunk: cxml.TokenChunk | null) => {
+			if(err && !result) result = err;
+
+			if(chunk) {
+				if(chunk.length) output.push(dumpTokens(chunk.buffer, chunk.length));
+				chunk.free();
+			}
+		};
+
+		for(let part of partList) parser.writeCompressed(part, handler);
+		parser.destroy(handler);
+
+		return(result || output.join(' '));
+	};
+
+	const split = compressed.length >> 1;
+
+	if(
+		parse([ compressed ]) != expected ||
+		parse([ compressed.slice(0, split), compressed.slice(split) ]) != expected
+	) {
+		console.error('ERROR in tokens from compressed input');
+		process.exit(1);
+	}
+
+	const err = parse([ compressed.slice(0, split) ]);
+
+	if(!(err instanceof cxml.ParseError) || err.code != ErrorType.INVALID_COMPRESSED_DATA) {
+		console.error('ERROR in truncated compressed input');
+		process.exit(1);
+	}
+}
+
+function testUtf8() {
+	// Long enough for text to be skipped in bulk without position tracking.
+	const head = '<r>Some text before the byte to check: ';
+
+	/** Parse chunks of bytes given as Latin-1 strings, returning any error. */
+	const parse = (chunkList: string[], options: cxml.ParserOptions) => {
+		const parser = new cxml.ParserConfig(extendOptions({ validateUtf8: true }, options)).createParser();
+		let result: any = null;
+
+		const handler = (err: any, chunk: cxml.TokenChunk | null) => {
+			if(err && !result) result = err;
+			if(chunk) chunk.free();
+		};
+
+		for(let data of chunkList) parser.write(Buffer.from(data, 'latin1'), '', handler);
+		parser.destroy(handler);
+
+		return(result);
+	};
+
+	const check = (chunkList: string[], offset: number | null | undefined, name: string) => {
+		for(let options of [ {}, { trackPosition: false } ]) {
+			const err = parse(chunkList, options);
+
+			if(
+				offset === null ? err : (
+					!(err instanceof cxml.ParseError) ||
+					err.code != ErrorType.INVALID_UTF8 ||
+					err.offset !== offset
+				)
+			) {
+				console.error('ERROR in UTF-8 validation of ' + name + ': ' + (err && err.offset));
+				process.exit(1);
+			}
+		}
+	};
+
+	check([ head + '\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80</r>' ], null, 'valid text');
+	check([ head + '\xc0\xaf</r>' ], head.length, 'overlong form');
+	check([ head + '\xed\xa0\x80</r>' ], head.length + 1, 'surrogate');
+	check([ head + '\xf4\x90\x80\x80</r>' ], head.length + 1, 'code point above U+10FFFF');
+	// Input ends inside a sequence, detected without an offset.
+	check([ head + '\xe2\x82' ], undefined, 'truncated sequence');
+	check([ head + '\xe2', '\x82\xac</r>' ], null, 'sequence split between writes');
+	check([ head + '\xe2', 'A</r>' ], 0, 'invalid sequence split between writes');
+}
+
+function testLargeInput() {
+	const parser = new cxml.ParserConfig().createParser();
+	// The text crosses the first 32 MiB boundary and more follows it.
+	const fill = repeat('x', (1 << 25) - 10);
+	const textList: string[] = [];
+
+	const handler = (err: any, chunk: cxml.TokenChunk | null) => {
+		if(err) throw(err);
+
+		if(chunk) {
+			for(let num = 0; num < chunk.length; ++num) {
+				const token = chunk.buffer[num];
+				if(typeof(token) == 'string') textList.push(token);
+			}
+
+			chunk.free();
+		}
+	};
+
+	parser.write('<r><a>' + fill + 'split</a><b>tail text</b></r>', '', handler);
+	parser.destroy(handler);
+
+	if(textList.join('') != fill + 'splittail text') {
+		console.error('ERROR in text past 32 MiB');
+		process.exit(1);
+	}
+
+	let thrown: any;
+
+	try {
+		new cxml.ParserConfig().createParser().parseBatch(new cxml.ArrayType(1 << 25), new Uint32Array([ 1 << 25 ]));
+	} catch(err) {
+		thrown = err;
+	}
+
+	if(!thrown) {
+		console.error('ERROR in batch too large for tokens');
+		process.exit(1);
+	}
+}
+
+/** Serialize XML using NativeWriter and pass the output to a callback. */
+
+function writeNative(xml: string, options: cxml.NativeWriterOptions, done: (output: string) => void) {
+	const writer = new cxml.NativeWriter(new cxml.ParserConfig(), options);
+	const partList: Buffer[] = [];
+
+	writer.on('data', (part: Buffer) => partList.push(Buffer.from(part)));
+	writer.on('end', () => done(Buffer.concat(partList).toString('utf8')));
+
+	writer.on('error', (err: any) => {
+		console.error('ERROR in native writer: ' + err);
+		process.exit(1);
+	});
+
+	writer.end(xml);
+}
+
+function testEntities() {
+	const dtd = '<!DOCTYPE r [<!ENTITY a "x&b;y"><!ENTITY b "0123456789">]>';
+	const parse = (options: cxml.ParserOptions, xml: string) => {
+		const config = new cxml.ParserConfig(extendOptions({ expandEntities: true }, options));
+
+		try {
+			return(config.parseSync(dtd + xml).buffer);
+		} catch(err) {
+			return(err);
+		}
+	};
+
+	const result = parse({}, '<r>1&a;2</r>');
+
+	if(!(result instanceof Array) || result.indexOf('1x0123456789y2') < 0) {
+		console.error('ERROR in entity expansion');
+		process.exit(1);
+	}
+
+	// Expanding a nests b one level deeper than allowed.
+	const deep = parse({ entityMaxDepth: 1 }, '<r>1&a;2</r>');
+
+	if(!(deep instanceof cxml.ParseError) || deep.code != ErrorType.ENTITY_LIMIT) {
+		console.error('ERROR in entity nesting limit');
+		process.exit(1);
+	}
+
+	// Two expansions of b need 20 bytes.
+	const long = parse({ entityMaxBytes: 16 }, '<r>&b;&b;</r>');
+
+	if(!(long instanceof cxml.ParseError) || long.code != ErrorType.ENTITY_LIMIT) {
+		console.error('ERROR in entity output limit');
+		process.exit(1);
+	}
+}
+
+function testDuplicates() {
+	const parse = (xml: string) => {
+		try {
+			return(new cxml.ParserConfig().parseSync(xml));
+		} catch(err) {
+			return(err);
+		}
+	};
+
+	const rejected = [
+		'<r a="1" a="2"/>',
+		'<r xmlns:a="urn:x" xmlns:a="urn:y"/>',
+		'<r xmlns="urn:x" xmlns="urn:y"/>',
+		// Different prefixes bound to the same URI.
+		'<r xmlns:a="urn:x" xmlns:b="urn:x" a:x="1" b:x="2"/>'
+	];
+
+	for(let xml of rejected) {
+		const err = parse(xml);
+
+		if(!(err instanceof cxml.ParseError) || err.code != ErrorType.DUPLICATE_ATTRIBUTE) {
+			console.error('ERROR in duplicate attribute: ' + xml);
+			process.exit(1);
+		}
+	}
+
+	const accepted = [
+		'<r xmlns:a="urn:x" xmlns:b="urn:y" a:x="1" b:x="2"/>',
+		'<r xmlns:a="urn:x" xmlns="urn:x" a:x="1" x="2"/>',
+		'<r xmlns:a="urn:x"><c xmlns:a="urn:y"/></r>'
+	];
+
+	for(let xml of accepted) {
+		if(parse(xml) instanceof cxml.ParseError) {
+			console.error('ERROR in distinct attributes: ' + xml);
+			process.exit(1);
+		}
+	}
+}
+
+function testContentModel() {
+	const config = new cxml.ParserConfig();
+	const ns = new cxml.Namespace('t', 'urn:test:model');
+
+	/** Create a type whose children must appear in the given order. */
+	const defineSequence = (childList: [ string, ComplexType ][]) => {
+		const type = new ComplexType();
+
+		type.elements = new ElementSpec();
+		type.elements.group = new Group(GroupKind.sequence);
+
+		for(let [ name, childType ] of childList) {
+			const spec = new ElementSpec();
+			const meta = new ElementMeta(config.getElementTokens(ns, name)[cxml.TokenKind.open]!);
+
+			meta.type = childType;
+			spec.meta = meta;
+			type.elements.group.addElement(spec);
+		}
+
+		return(type);
+	};
+
+	const empty = defineSequence([]);
+	const root = defineSequence([ [ 'a', empty ], [ 'b', empty ] ]);
+
+	config.setSchema(defineSequence([ [ 'r', root ] ]));
+
+	const parse = (xml: string) => {
+		try {
+			config.parseSync('<t:r xmlns:t="urn:test:model">' + xml + '</t:r>');
+		} catch(err) {
+			return(err);
+		}
+	};
+
+	if(parse('<t:a/><t:b/>')) {
+		console.error('ERROR in accepted content');
+		process.exit(1);
+	}
+
+	const err = parse('<t:b/><t:a/>');
+
+	if(!(err instanceof cxml.ParseError) || err.code != ErrorType.INVALID_CONTENT) {
+		console.error('ERROR in rejected content');
+		process.exit(1);
+	}
+}
+
+/** Parse documents in a ParserPool, returning descriptions of the tokens
+  * of each document like parseChunks. */
+
+function parsePooled(config: cxml.ParserConfig, docList: string[]) {
+	const pool = new cxml.ParserPool(2);
+	const outputList: string[][] = docList.map(() => [] as string[]);
+
+	pool.parse(config, docList.map((doc: string) => cxml.encodeArray(doc)), (num: number, err: any, chunk: cxml.TokenChunk | null) => {
+		if(err) {
+			console.error('ERROR in pooled document ' + num + ': ' + err);
+			process.exit(1);
+		}
+
+		if(chunk) {
+			if(chunk.length) outputList[num].push(dumpTokens(chunk.buffer, chunk.length));
+			chunk.free();
+		}
+	});
+
+	pool.destroy();
+
+	return(outputList);
+}
+
+function testNumberList() {
+	const ns = new cxml.Namespace('n', 'urn:test:numbers');
+	const start = '<list xmlns="urn:test:numbers">';
+	const end = '</list>';
+
+	const createConfig = (options: cxml.ParserOptions) => {
+		const config = new cxml.ParserConfig(options);
+
+		config.setNumberList(config.getElementTokens(ns, 'list')[cxml.TokenKind.open]!, cxml.NumberListType.FLOAT64);
+		return(config);
+	};
+
+	/** Compare decoded numbers from parsing chunks with parseFloat. */
+	const check = (chunkList: string[], options: cxml.ParserOptions, name: string) => {
+		const text = chunkList.join('').slice(start.length, -end.length);
+		const expected = text.trim().split(/\s+/).map(parseFloat);
+		const valueList: number[] = [];
+
+		const parser = createConfig(options).createParser();
+		const handler = (err: any, chunk: cxml.TokenChunk | null) => {
+			if(err) throw(err);
+
+			if(chunk) {
+				for(let num = 0; num < chunk.length; ++num) {
+					const token = chunk.buffer[num] as any;
+					if(token instanceof Float64Array) valueList.push.apply(valueList, Array.prototype.slice.call(token));
+				}
+
+				chunk.free();
+			}
+		};
+
+		for(let data of chunkList) parser.write(data, '', handler);
+		parser.destroy(handler);
+
+		if(
+			valueList.length != expected.length ||
+			valueList.some((value: number, num: number) => value !== expected[num])
+		) {
+			console.error('ERROR in number list ' + name + ': ' + valueList.join(','));
+			process.exit(1);
+		}
+	};
+
+	// A number split between two writes.
+	check([ start + '1.25 -3', '.5e2 7 0.1', ' 1e-7' + end ], {}, 'split between writes');
+
+	const itemList: string[] = [];
+
+	for(let num = 0; num < 100; ++num) {
+		itemList.push((num * 1.375 - 40).toString() + (num % 3 ? 'e' + (num % 9 - 4) : ''));
+	}
+
+	const long = start + itemList.join(' \n ') + end;
+
+	// The number buffer only fits 2 doubles, so the list continues in parts.
+	check([ long ], { numberBufferSize: 16 }, 'in parts');
+	check([ long.slice(0, 301), long.slice(301) ], { numberBufferSize: 16 }, 'in parts between writes');
+
+	// Pooled parsers suspend instead when the number buffer fills.
+	const expected = '[' + long.slice(start.length, -end.length).split(/\s+/).map(parseFloat).join(',') + ']';
+	const pooled = parsePooled(createConfig({ numberBufferSize: 16 }), [ long ])[0].join(' ');
+
+	if(pooled.indexOf(expected) < 0) {
+		console.error('ERROR in pooled number list');
+		process.exit(1);
+	}
+}
+
+function testPool() {
+	const docList: string[] = [];
+
+	for(let num = 0; num < 6; ++num) {
+		const itemList: string[] = [];
+
+		// Fill several code buffers, so jobs suspend and resume.
+		for(let item = 0; item < 3000 * (num % 3); ++item) {
+			itemList.push('<item n="' + item + '">text ' + num + '</item>');
+		}
+
+		docList.push(
+			'<root xmlns:p="urn:test:pool' + num + '"><p:head/>' +
+			itemList.join('') +
+			'<tail' + num + '/></root>'
+		);
+	}
+
+	const outputList = parsePooled(new cxml.ParserConfig(), docList);
+	const config = new cxml.ParserConfig();
+
+	for(let num = 0; num < docList.length; ++num) {
+		const expected = parseChunks(config.createParser(), [ docList[num], null ], []);
+
+		if(outputList[num].join(' ') != expected.join(' ')) {
+			console.error('ERROR in pooled document ' + num);
+			process.exit(1);
+		}
+	}
+}
+
+function testPoolRecords() {
+	const prefixList: string[] = [];
+	const recordList: string[] = [];
+
+	// More prefixes in scope than the space reserved between suspend checks.
+	for(let num = 0; num < 24; ++num) {
+		prefixList.push(' xmlns:p' + num + '="urn:test:split' + num + '"');
+	}
+
+	// Records end at varying distances from the end of a code buffer.
+	for(let num = 0; num < 2000; ++num) {
+		recordList.push('<rec n="' + num + '"><p3:x/></rec>' + (num % 7 ? '' : 'text'));
+	}
+
+	const doc = '<root' + prefixList.join('') + '>' + recordList.join('') + '</root>';
+	const outputList = parsePooled(new cxml.ParserConfig({ splitDepth: 1 }), [ doc, doc ]);
+	const config = new cxml.ParserConfig({ splitDepth: 1 });
+	const expected = parseChunks(config.createParser(), [ doc, null ], []);
+
+	for(let output of outputList) {
+		if(output.join(' ') != expected.join(' ')) {
+			console.error('ERROR in pooled records with many prefixes');
+			process.exit(1);
+		}
+	}
+}
+
+function testRecordExtractor() {
+	const ns = new cxml.Namespace('r', 'urn:test:rows');
+	const config = new cxml.ParserConfig();
+	const fields: cxml.RecordField[] = [
+		{ token: config.getAttributeTokens(ns, 'a')[cxml.TokenKind.string]!, type: cxml.ColumnType.INT32 },
+		{ token: config.getElementTokens(ns, 'c')[cxml.TokenKind.open]!, type: cxml.ColumnType.FLOAT64 },
+		{ token: config.getElementTokens(ns, 's')[cxml.TokenKind.open]!, type: cxml.ColumnType.STRING }
+	];
+
+	const extractor = new cxml.RecordExtractor(config, config.getElementTokens(ns, 'row')[cxml.TokenKind.open]!, fields);
+	const batchList: cxml.RecordBatch[] = [];
+	const dump = (list: ArrayLike<number> | undefined) => list && JSON.stringify(Array.prototype.slice.call(list));
+
+	extractor.on('data', (batch: cxml.RecordBatch) => batchList.push(batch));
+
+	extractor.on('end', () => {
+		const result = batchList.map((batch: cxml.RecordBatch) => ({
+			rowCount: batch.rowCount,
+			columns: batch.columns.map((column: cxml.RecordColumn) => ({
+				validity: dump(column.validity),
+				nullCount: column.nullCount,
+				data: column.offsets ? Buffer.from(column.data.buffer as ArrayBuffer).toString() : dump(column.data),
+				offsets: dump(column.offsets)
+			}))
+		}));
+
+		// The last record was split between writes, so it comes in a second batch.
+		const expected = [ {
+			rowCount: 3,
+			columns: [
+				{ validity: '[7]', nullCount: 0, data: '[1,2,3]', offsets: undefined },
+				// The second row has no c element.
+				{ validity: '[5]', nullCount: 1, data: '[1.5,0,-2000]', offsets: undefined },
+				{ validity: '[7]', nullCount: 0, data: 'onetwothree', offsets: '[0,3,6,11]' }
+			]
+		}, {
+			rowCount: 1,
+			columns: [
+				{ validity: '[1]', nullCount: 0, data: '[4]', offsets: undefined },
+				{ validity: '[1]', nullCount: 0, data: '[0.25]', offsets: undefined },
+				{ validity: '[1]', nullCount: 0, data: 'four', offsets: '[0,4]' }
+			]
+		} ];
+
+		if(JSON.stringify(result) != JSON.stringify(expected)) {
+			console.error('ERROR in extracted records: ' + JSON.stringify(result));
+			process.exit(1);
+		}
+	});
+
+	extractor.write(
+		'<rows xmlns="urn:test:rows">' +
+		'<row a="1"><c>1.5</c><s>one</s></row>' +
+		'<row a="2"><s>two</s></row>' +
+		'<row a="3"><c>-2e3</c><s>three</s></row>' +
+		'<row a="4"><c>0.2'
+	);
+	extractor.write('5</c><s>four</s></row></rows>');
+	extractor.end();
+}
+
+function testXmlWriter() {
+	writeNative('<r v=\'say "hi"\'>x</r>', {}, (output: string) => {
+		if(output != '<?xml version="1.0" encoding="utf-8"?>\n<r v="say &quot;hi&quot;">x</r>\n') {
+			console.error('ERROR in XML writer escaping: ' + output);
+			process.exit(1);
+		}
+	});
+
+	writeNative('<p:r xmlns:p="urn:p" xmlns="urn:d"><c p:a="1"/></p:r>', {}, (output: string) => {
+		if(output != (
+			'<?xml version="1.0" encoding="utf-8"?>\n' +
+			'<p:r xmlns:p="urn:p" xmlns="urn:d">\n' +
+			'\t<c p:a="1"/>\n' +
+			'</p:r>\n'
+		)) {
+			console.error('ERROR in XML writer namespaces: ' + output);
+			process.exit(1);
+		}
+	});
+
+	// Canonical output sorts declarations and attributes, and re-escapes text.
+	writeNative(
+		'<p:r xmlns:p="urn:p" xmlns="urn:d" p:b="2" a="&lt;1&amp;"><c/>x &gt; "y"</p:r>',
+		{ canonical: true },
+		(output: string) => {
+			if(output != '<p:r xmlns="urn:d" xmlns:p="urn:p" a="&lt;1&amp;" p:b="2"><c></c>x &gt; "y"</p:r>') {
+				console.error('ERROR in canonical XML writer: ' + output);
+				process.exit(1);
+			}
+		}
+	);
+}
+
+function testJsonWriter() {
+	const checkJson = (xml: string, expected: any) => writeNative(xml, { json: true }, (output: string) => {
+		let result: any;
+
+		try {
+			result = JSON.parse(output);
+		} catch(err) {}
+
+		if(JSON.stringify(result) != JSON.stringify(expected)) {
+			console.error('ERROR in JSON writer: ' + output);
+			process.exit(1);
+		}
+	});
+
+	// Quotes, backslashes and control characters must be escaped.
+	checkJson('<r a=\'1"2\\3\'><c/>a\tb</r>', [ 'r', [ '$a', '1"2\\3' ], [ 'c' ], [ '$', 'a\tb' ] ]);
+
+	// Prefixes and namespace declarations are omitted.
+	checkJson('<p:r xmlns:p="urn:p" xmlns="urn:d"><c p:a="1"/></p:r>', [ 'r', [ 'c', [ '$a', '1' ] ] ]);
 }
 
 function testParser() {
@@ -56,4 +945,21 @@ function testParser() {
 }
 
 testPatricia();
+testWidePatricia();
+testSnapshot();
+testInterning();
+testConfigImage();
+testBatch();
+testLargeInput();
+testUtf8();
+testCompressed();
+testEntities();
+testDuplicates();
+testContentModel();
+testPool();
+testPoolRecords();
+testNumberList();
+testRecordExtractor();
+testXmlWriter();
+testJsonWriter();
 testParser();